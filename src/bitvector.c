@@ -0,0 +1,130 @@
+#include "bitvector.h"
+#include "vector_error.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const int kBitsPerWord = 64;
+static const int kDefaultBitAllocation = 256;
+
+/**
+ * Population count and count-trailing-zeros map onto the compiler builtins,
+ * which become single POPCNT/TZCNT instructions whenever the target allows
+ * it (see the VECTOR_NATIVE_ARCH build option).
+ */
+static int WordPopCount(uint64_t word) { return __builtin_popcountll(word); }
+static int WordTrailingZeros(uint64_t word) { return __builtin_ctzll(word); }
+
+static int WordsFor(int bits) { return (bits + kBitsPerWord - 1) / kBitsPerWord; }
+
+static void BitVectorAssertInBounds(const bitvector *bv, int position) {
+  vector_assert(position < 0 || position >= bv->logicalSize, "Index out of bounds.");
+}
+
+static void BitVectorGrow(bitvector *bv, int newCapacity) {
+  bv->words = realloc(bv->words, (size_t)newCapacity * sizeof(uint64_t));
+  vector_assert(bv->words == NULL, "Couldn't reallocate bitvector.");
+  memset(bv->words + bv->capacity, 0, (size_t)(newCapacity - bv->capacity) * sizeof(uint64_t));
+  bv->capacity = newCapacity;
+}
+
+void BitVectorNew(bitvector *bv, int initialAllocation)
+{
+  vector_assert(initialAllocation < 0, "Initial allocation must not be negative.");
+  bv->words = NULL;
+  bv->logicalSize = 0;
+  bv->capacity = 0;
+  BitVectorGrow(bv, WordsFor(initialAllocation > 0 ? initialAllocation : kDefaultBitAllocation));
+}
+
+void BitVectorDispose(bitvector *bv)
+{
+  free(bv->words);
+}
+
+int BitVectorLength(const bitvector *bv)
+{ return bv->logicalSize; }
+
+void BitVectorAppend(bitvector *bv, mybool value)
+{
+  if (bv->logicalSize == bv->capacity * kBitsPerWord) {
+    BitVectorGrow(bv, bv->capacity * 2);
+  }
+  bv->logicalSize++;
+  if (value) BitVectorSet(bv, bv->logicalSize - 1);
+}
+
+mybool BitVectorGet(const bitvector *bv, int position)
+{
+  BitVectorAssertInBounds(bv, position);
+  return (bv->words[position / kBitsPerWord] >> (position % kBitsPerWord)) & 1 ? TRUE : FALSE;
+}
+
+void BitVectorSet(bitvector *bv, int position)
+{
+  BitVectorAssertInBounds(bv, position);
+  bv->words[position / kBitsPerWord] |= (uint64_t)1 << (position % kBitsPerWord);
+}
+
+void BitVectorClear(bitvector *bv, int position)
+{
+  BitVectorAssertInBounds(bv, position);
+  bv->words[position / kBitsPerWord] &= ~((uint64_t)1 << (position % kBitsPerWord));
+}
+
+int BitVectorPopCount(const bitvector *bv)
+{
+  return BitVectorRank(bv, bv->logicalSize);
+}
+
+int BitVectorRank(const bitvector *bv, int position)
+{
+  vector_assert(position < 0 || position > bv->logicalSize, "Index out of bounds.");
+  int fullWords = position / kBitsPerWord;
+  int count = 0;
+  for (int w = 0; w < fullWords; w++) {
+    count += WordPopCount(bv->words[w]);
+  }
+  int remainder = position % kBitsPerWord;
+  if (remainder > 0) {
+    count += WordPopCount(bv->words[fullWords] & (((uint64_t)1 << remainder) - 1));
+  }
+  return count;
+}
+
+static const int kNotFound = -1;
+int BitVectorNextSet(const bitvector *bv, int startIndex)
+{
+  vector_assert(startIndex < 0 || startIndex > bv->logicalSize,
+                "Failed to search, start index out of bounds.");
+  if (startIndex == bv->logicalSize) return kNotFound;
+  int w = startIndex / kBitsPerWord;
+  uint64_t word = bv->words[w] & (~(uint64_t)0 << (startIndex % kBitsPerWord));
+  int numWords = WordsFor(bv->logicalSize);
+  while (word == 0) {
+    if (++w == numWords) return kNotFound;
+    word = bv->words[w];
+  }
+  return w * kBitsPerWord + WordTrailingZeros(word);
+}
+
+static void AssertSameLength(const bitvector *dest, const bitvector *src) {
+  vector_assert(dest->logicalSize != src->logicalSize, "Bitvector lengths differ.");
+}
+
+void BitVectorAnd(bitvector *dest, const bitvector *src)
+{
+  AssertSameLength(dest, src);
+  for (int w = 0; w < WordsFor(dest->logicalSize); w++) dest->words[w] &= src->words[w];
+}
+
+void BitVectorOr(bitvector *dest, const bitvector *src)
+{
+  AssertSameLength(dest, src);
+  for (int w = 0; w < WordsFor(dest->logicalSize); w++) dest->words[w] |= src->words[w];
+}
+
+void BitVectorXor(bitvector *dest, const bitvector *src)
+{
+  AssertSameLength(dest, src);
+  for (int w = 0; w < WordsFor(dest->logicalSize); w++) dest->words[w] ^= src->words[w];
+}
@@ -0,0 +1,134 @@
+/**
+ * File: bitvector.h
+ * -----------------
+ * Defines the interface for the bitvector.
+ *
+ * A bitvector is a growable sequence of boolean flags packed 64 to a machine
+ * word.  A vector of mybool spends four bytes on every flag; the bitvector
+ * spends one bit, so large membership bitmaps stay small enough to live in
+ * cache.  Beyond the usual append/get/set operations it supports the word-at-
+ * a-time queries that packing makes cheap: counting set bits (population
+ * count), rank (how many bits are set before a position), finding the next
+ * set bit, and bulk AND/OR/XOR of two equally long bitvectors.
+ */
+
+#ifndef _bitvector_
+#define _bitvector_
+
+#include "bool.h"
+#include <stdint.h>
+
+/**
+ * Type: bitvector
+ * ---------------
+ * Defines the concrete representation of the bitvector.  Bits live in an
+ * array of 64-bit words, least significant bit first.  Bits at or beyond the
+ * logical length are always kept clear.  As with the vector, the client
+ * should interact with a bitvector only via the functions in this file.
+ */
+
+typedef struct {
+  uint64_t *words;
+  int logicalSize;
+  int capacity;   // in words
+} bitvector;
+
+/**
+ * Function: BitVectorNew
+ * Usage: bitvector seen;
+ *        BitVectorNew(&seen, 1 << 20);
+ * ----------------------
+ * Constructs a raw or previously destroyed bitvector to be empty, with room
+ * for initialAllocation bits before it needs to grow.  If initialAllocation
+ * is 0, a default of the implementation's choosing is used.  An assert is
+ * raised if initialAllocation is less than 0.
+ */
+
+void BitVectorNew(bitvector *bv, int initialAllocation);
+
+/**
+ * Function: BitVectorDispose
+ * --------------------------
+ * Frees all of the memory owned by the bitvector.
+ */
+
+void BitVectorDispose(bitvector *bv);
+
+/**
+ * Function: BitVectorLength
+ * -------------------------
+ * Returns the number of bits in the bitvector.  Runs in constant time.
+ */
+
+int BitVectorLength(const bitvector *bv);
+
+/**
+ * Function: BitVectorAppend
+ * -------------------------
+ * Appends one bit with the specified value to the end of the bitvector.
+ * Runs in amortized constant time.
+ */
+
+void BitVectorAppend(bitvector *bv, mybool value);
+
+/**
+ * Function: BitVectorGet
+ * ----------------------
+ * Returns the value of the bit at the specified position.  An assert is
+ * raised if position is out of bounds.
+ */
+
+mybool BitVectorGet(const bitvector *bv, int position);
+
+/**
+ * Functions: BitVectorSet, BitVectorClear
+ * ---------------------------------------
+ * Sets or clears the bit at the specified position.  An assert is raised if
+ * position is out of bounds.
+ */
+
+void BitVectorSet(bitvector *bv, int position);
+void BitVectorClear(bitvector *bv, int position);
+
+/**
+ * Function: BitVectorPopCount
+ * ---------------------------
+ * Returns the number of set bits, counted a word at a time.
+ */
+
+int BitVectorPopCount(const bitvector *bv);
+
+/**
+ * Function: BitVectorRank
+ * -----------------------
+ * Returns the number of set bits strictly before the specified position.
+ * Position may equal the length, in which case the result is the same as
+ * BitVectorPopCount.  An assert is raised if position is out of range.
+ */
+
+int BitVectorRank(const bitvector *bv, int position);
+
+/**
+ * Function: BitVectorNextSet
+ * --------------------------
+ * Returns the position of the first set bit at or after startIndex, or -1
+ * if there is none.  Whole runs of zero words are skipped without looking
+ * at individual bits.  As with VectorSearch, startIndex may equal the length
+ * (which never finds anything); an assert is raised if it is less than 0 or
+ * greater than the length.
+ */
+
+int BitVectorNextSet(const bitvector *bv, int startIndex);
+
+/**
+ * Functions: BitVectorAnd, BitVectorOr, BitVectorXor
+ * --------------------------------------------------
+ * Combines src into dest bit by bit (dest = dest op src), a word at a time.
+ * An assert is raised unless both bitvectors have the same length.
+ */
+
+void BitVectorAnd(bitvector *dest, const bitvector *src);
+void BitVectorOr(bitvector *dest, const bitvector *src);
+void BitVectorXor(bitvector *dest, const bitvector *src);
+
+#endif
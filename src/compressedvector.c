@@ -0,0 +1,231 @@
+#include "compressedvector.h"
+#include "vector_error.h"
+#include <stdint.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * Packed layout
+ * -------------
+ * A packed block of width w occupies 4 * w 32-bit words arranged as four
+ * interleaved lanes: value i belongs to lane i % 4 and is the (i / 4)th value
+ * packed into that lane, and word k of lane l lives at index 4 * k + l.  All
+ * four lanes therefore have the same bit offsets, which is what lets the SSE2
+ * path unpack four values with each shift-and-mask.
+ */
+
+static const int kLanes = 4;
+static const int kRawWidth = 64;
+
+static int BitsNeeded(unsigned long value) {
+  return value == 0 ? 0 : (int)(sizeof(unsigned long) * 8) - __builtin_clzl(value);
+}
+
+static uint32_t WidthMask(int width) {
+  return width >= 32 ? 0xffffffffu : ((uint32_t)1 << width) - 1;
+}
+
+static uint32_t ExtractPacked(const uint32_t *words, int width, int index) {
+  int lane = index % kLanes;
+  int bitPos = (index / kLanes) * width;
+  int k = bitPos / 32, shift = bitPos % 32;
+  uint32_t value = words[kLanes * k + lane] >> shift;
+  if (shift + width > 32) value |= words[kLanes * (k + 1) + lane] << (32 - shift);
+  return value & WidthMask(width);
+}
+
+static void PackBlock(const uint32_t *values, int width, uint32_t *words) {
+  memset(words, 0, (size_t)kLanes * width * sizeof(uint32_t));
+  for (int i = 0; i < kCompressedBlockLength; i++) {
+    int lane = i % kLanes;
+    int bitPos = (i / kLanes) * width;
+    int k = bitPos / 32, shift = bitPos % 32;
+    words[kLanes * k + lane] |= values[i] << shift;
+    if (shift + width > 32) words[kLanes * (k + 1) + lane] |= values[i] >> (32 - shift);
+  }
+}
+
+static void UnpackBlock(const uint32_t *words, int width, uint32_t *values) {
+  if (width == 0) {
+    memset(values, 0, kCompressedBlockLength * sizeof(uint32_t));
+    return;
+  }
+#ifdef __SSE2__
+  const __m128i mask = _mm_set1_epi32((int)WidthMask(width));
+  for (int j = 0; j < kCompressedBlockLength / kLanes; j++) {
+    int bitPos = j * width;
+    int k = bitPos / 32, shift = bitPos % 32;
+    __m128i lanes = _mm_srl_epi32(_mm_loadu_si128((const __m128i *)(words + kLanes * k)),
+                                  _mm_cvtsi32_si128(shift));
+    if (shift + width > 32) {
+      __m128i next = _mm_loadu_si128((const __m128i *)(words + kLanes * (k + 1)));
+      lanes = _mm_or_si128(lanes, _mm_sll_epi32(next, _mm_cvtsi32_si128(32 - shift)));
+    }
+    _mm_storeu_si128((__m128i *)(values + kLanes * j), _mm_and_si128(lanes, mask));
+  }
+#else
+  for (int i = 0; i < kCompressedBlockLength; i++) {
+    values[i] = ExtractPacked(words, width, i);
+  }
+#endif
+}
+
+static int NumSealedBlocks(const compressedvector *cv) {
+  return VectorLength(&cv->blocks);
+}
+
+static const uint32_t *BlockWords(const compressedvector *cv, const CompressedBlock *block) {
+  return VectorNth(&cv->packed, block->offset);
+}
+
+static void AppendWords(compressedvector *cv, const uint32_t *words, int count) {
+  for (int i = 0; i < count; i++) {
+    VectorAppend(&cv->packed, &words[i]);
+  }
+}
+
+/**
+ * Encodes the (full) pending block and appends it to the packed storage and
+ * the skip index, choosing delta encoding when the block is non-decreasing
+ * and its deltas pack narrower than its frame-of-reference offsets.
+ */
+static void SealBlock(compressedvector *cv) {
+  const long *values = cv->tail;
+  long min = values[0], max = values[0];
+  mybool sorted = TRUE;
+  unsigned long maxDelta = 0;
+  for (int i = 1; i < kCompressedBlockLength; i++) {
+    if (values[i] < min) min = values[i];
+    if (values[i] > max) max = values[i];
+    if (values[i] < values[i - 1]) sorted = FALSE;
+    else if ((unsigned long)values[i] - (unsigned long)values[i - 1] > maxDelta)
+      maxDelta = (unsigned long)values[i] - (unsigned long)values[i - 1];
+  }
+
+  CompressedBlock block;
+  block.offset = VectorLength(&cv->packed);
+  uint32_t packed[kCompressedBlockLength * 2];
+  uint32_t residuals[kCompressedBlockLength];
+  int forWidth = BitsNeeded((unsigned long)max - (unsigned long)min);
+  int deltaWidth = BitsNeeded(maxDelta);
+
+  // Residuals are packed 32 bits at most, so a block with a wider gap
+  // falls through to the raw encoding even if it is sorted.
+  if (sorted && deltaWidth < forWidth && deltaWidth <= 32) {
+    block.encoding = kBlockDelta;
+    block.width = deltaWidth;
+    block.base = values[0];
+    residuals[0] = 0;
+    for (int i = 1; i < kCompressedBlockLength; i++)
+      residuals[i] = (uint32_t)((unsigned long)values[i] - (unsigned long)values[i - 1]);
+  } else if (forWidth <= 32) {
+    block.encoding = kBlockFrameOfReference;
+    block.width = forWidth;
+    block.base = min;
+    for (int i = 0; i < kCompressedBlockLength; i++)
+      residuals[i] = (uint32_t)((unsigned long)values[i] - (unsigned long)min);
+  } else {
+    block.encoding = kBlockRaw;
+    block.width = kRawWidth;
+    block.base = 0;
+    for (int i = 0; i < kCompressedBlockLength; i++) {
+      uint64_t raw = (uint64_t)values[i];
+      packed[2 * i] = (uint32_t)raw;
+      packed[2 * i + 1] = (uint32_t)(raw >> 32);
+    }
+    AppendWords(cv, packed, 2 * kCompressedBlockLength);
+  }
+
+  if (block.encoding != kBlockRaw) {
+    PackBlock(residuals, block.width, packed);
+    AppendWords(cv, packed, kLanes * block.width);
+  }
+  VectorAppend(&cv->blocks, &block);
+  cv->tailLength = 0;
+}
+
+void CompressedVectorNew(compressedvector *cv)
+{
+  VectorNewUntraced(&cv->blocks, sizeof(CompressedBlock), NULL, 16);
+  VectorNewUntraced(&cv->packed, sizeof(uint32_t), NULL, 256);
+  cv->tailLength = 0;
+}
+
+void CompressedVectorDispose(compressedvector *cv)
+{
+  VectorDispose(&cv->blocks);
+  VectorDispose(&cv->packed);
+}
+
+int CompressedVectorLength(const compressedvector *cv)
+{ return NumSealedBlocks(cv) * kCompressedBlockLength + cv->tailLength; }
+
+void CompressedVectorAppend(compressedvector *cv, long value)
+{
+  cv->tail[cv->tailLength++] = value;
+  if (cv->tailLength == kCompressedBlockLength) SealBlock(cv);
+}
+
+long CompressedVectorNth(const compressedvector *cv, int position)
+{
+  vector_assert(position < 0 || position >= CompressedVectorLength(cv), "Index out of bounds.");
+  int blockIndex = position / kCompressedBlockLength;
+  int index = position % kCompressedBlockLength;
+  if (blockIndex == NumSealedBlocks(cv)) return cv->tail[index];
+
+  const CompressedBlock *block = VectorNth(&cv->blocks, blockIndex);
+  if (block->width == 0) return block->base;
+  const uint32_t *words = BlockWords(cv, block);
+  switch (block->encoding) {
+    case kBlockRaw:
+      return (long)((uint64_t)words[2 * index] | ((uint64_t)words[2 * index + 1] << 32));
+    case kBlockFrameOfReference:
+      return (long)((unsigned long)block->base + ExtractPacked(words, block->width, index));
+    default: {
+      unsigned long value = (unsigned long)block->base;
+      for (int i = 1; i <= index; i++) value += ExtractPacked(words, block->width, i);
+      return (long)value;
+    }
+  }
+}
+
+int CompressedVectorNumBlocks(const compressedvector *cv)
+{ return NumSealedBlocks(cv) + (cv->tailLength > 0 ? 1 : 0); }
+
+int CompressedVectorDecodeBlock(const compressedvector *cv, int blockIndex, long *out)
+{
+  vector_assert(blockIndex < 0 || blockIndex >= CompressedVectorNumBlocks(cv), "Block out of bounds.");
+  if (blockIndex == NumSealedBlocks(cv)) {
+    memcpy(out, cv->tail, cv->tailLength * sizeof(long));
+    return cv->tailLength;
+  }
+
+  const CompressedBlock *block = VectorNth(&cv->blocks, blockIndex);
+  if (block->encoding == kBlockRaw) {
+    const uint32_t *words = BlockWords(cv, block);
+    for (int i = 0; i < kCompressedBlockLength; i++)
+      out[i] = (long)((uint64_t)words[2 * i] | ((uint64_t)words[2 * i + 1] << 32));
+    return kCompressedBlockLength;
+  }
+
+  uint32_t residuals[kCompressedBlockLength];
+  UnpackBlock(block->width == 0 ? NULL : BlockWords(cv, block), block->width, residuals);
+  unsigned long base = (unsigned long)block->base;
+  if (block->encoding == kBlockFrameOfReference) {
+    for (int i = 0; i < kCompressedBlockLength; i++) out[i] = (long)(base + residuals[i]);
+  } else {
+    for (int i = 0; i < kCompressedBlockLength; i++) {
+      base += residuals[i];
+      out[i] = (long)base;
+    }
+  }
+  return kCompressedBlockLength;
+}
+
+size_t CompressedVectorBytesUsed(const compressedvector *cv)
+{
+  return (size_t)VectorLength(&cv->packed) * sizeof(uint32_t) +
+         (size_t)VectorLength(&cv->blocks) * sizeof(CompressedBlock);
+}
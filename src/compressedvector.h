@@ -0,0 +1,150 @@
+/**
+ * File: compressedvector.h
+ * ------------------------
+ * Defines the interface for the compressedvector, a read-mostly sequence of
+ * long integers stored in compressed form.
+ *
+ * Values are grouped into blocks of 128.  Each full block is encoded once,
+ * when its last value arrives, in whichever of these forms is smallest:
+ *
+ *   - frame of reference: the block minimum is stored once and every value
+ *     is stored as its (unsigned) offset from that minimum;
+ *   - delta: for non-decreasing blocks (sorted ID lists), each value is
+ *     stored as its difference from the previous one;
+ *   - raw: if the offsets need more than 32 bits, the values are stored as is.
+ *
+ * Offsets and deltas are bit-packed at the smallest width that holds the
+ * block's largest one, so a sorted list of IDs that fit in 20 bits costs a
+ * few bits per entry instead of eight bytes.  A per-block skip index records
+ * where each block starts, how it is encoded, and its base value, which
+ * makes random access a matter of locating one bit field.  Whole blocks are
+ * decoded with an SSE2 unpack loop where available.
+ *
+ * The last, partially filled block is kept uncompressed until it fills.
+ */
+
+#ifndef _compressedvector_
+#define _compressedvector_
+
+#include "vector.h"
+#include <stddef.h>
+
+/**
+ * Constant: kCompressedBlockLength
+ * --------------------------------
+ * The number of values per block, and so the largest number of values
+ * CompressedVectorDecodeBlock ever writes.
+ */
+
+enum { kCompressedBlockLength = 128 };
+
+/**
+ * Type: CompressedBlock
+ * ---------------------
+ * One entry of the skip index: the block's base value, the index of its first
+ * packed 32-bit word, its encoding and the bit width of each packed value.
+ */
+
+typedef enum {
+  kBlockFrameOfReference, kBlockDelta, kBlockRaw
+} CompressedBlockEncoding;
+
+typedef struct {
+  long base;
+  int offset;
+  unsigned char width;
+  unsigned char encoding;
+} CompressedBlock;
+
+/**
+ * Type: compressedvector
+ * ----------------------
+ * Defines the concrete representation of the compressedvector.  The skip
+ * index and the packed words are both kept in ordinary vectors.  The client
+ * should interact with a compressedvector only via the functions below.
+ */
+
+typedef struct {
+  vector blocks;     // of CompressedBlock
+  vector packed;     // of uint32_t
+  long tail[kCompressedBlockLength];
+  int tailLength;
+} compressedvector;
+
+/**
+ * Function: CompressedVectorNew
+ * -----------------------------
+ * Constructs a raw or previously destroyed compressedvector to be empty.
+ */
+
+void CompressedVectorNew(compressedvector *cv);
+
+/**
+ * Function: CompressedVectorDispose
+ * ---------------------------------
+ * Frees all of the memory owned by the compressedvector.
+ */
+
+void CompressedVectorDispose(compressedvector *cv);
+
+/**
+ * Function: CompressedVectorLength
+ * --------------------------------
+ * Returns the number of values stored.  Runs in constant time.
+ */
+
+int CompressedVectorLength(const compressedvector *cv);
+
+/**
+ * Function: CompressedVectorAppend
+ * --------------------------------
+ * Appends a value.  Every 128th append seals the pending block, encoding it
+ * into the packed storage; the others just store the value in the pending
+ * block.
+ */
+
+void CompressedVectorAppend(compressedvector *cv, long value);
+
+/**
+ * Function: CompressedVectorNth
+ * -----------------------------
+ * Returns the value at the specified position.  Frame-of-reference and raw
+ * blocks answer in constant time.  Delta blocks store no intermediate values,
+ * so Nth unpacks and sums every delta before the position within its block:
+ * up to kCompressedBlockLength - 1 of them, against one for the other
+ * encodings.  Walking a delta-coded vector with Nth is therefore quadratic in
+ * the block length; decode whole blocks with CompressedVectorDecodeBlock
+ * instead.  An assert is raised if position is out of bounds.
+ */
+
+long CompressedVectorNth(const compressedvector *cv, int position);
+
+/**
+ * Function: CompressedVectorNumBlocks
+ * -----------------------------------
+ * Returns the number of blocks, counting a partially filled last block.
+ */
+
+int CompressedVectorNumBlocks(const compressedvector *cv);
+
+/**
+ * Function: CompressedVectorDecodeBlock
+ * -------------------------------------
+ * Decodes every value of the specified block into out, which must have room
+ * for kCompressedBlockLength values, and returns the number of values
+ * written (128 for all but possibly the last block).  This is the fast path
+ * for scans.  An assert is raised if block is out of bounds.
+ */
+
+int CompressedVectorDecodeBlock(const compressedvector *cv, int block, long *out);
+
+/**
+ * Function: CompressedVectorBytesUsed
+ * -----------------------------------
+ * Returns the number of bytes of compressed payload and skip index in use,
+ * not counting the pending block or unused capacity.
+ */
+
+size_t CompressedVectorBytesUsed(const compressedvector *cv);
+
+#endif
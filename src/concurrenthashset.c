@@ -0,0 +1,155 @@
+#include "concurrenthashset.h"
+#include "vector_error.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const size_t kCacheLineSize = 64;
+
+/**
+ * Type: ConcurrentHashSetShard
+ * ----------------------------
+ * One shard: its lock and its table, padded out to whole cache lines so
+ * that threads working on neighbouring shards don't share a line.
+ */
+
+typedef struct {
+  pthread_rwlock_t lock;
+  hashset set;
+} ConcurrentHashSetShard;
+
+static size_t ShardStride(void) {
+  return (sizeof(ConcurrentHashSetShard) + kCacheLineSize - 1) / kCacheLineSize * kCacheLineSize;
+}
+
+static ConcurrentHashSetShard *ShardAt(const concurrenthashset *h, int shard) {
+  return (ConcurrentHashSetShard *)((char *)h->shards + shard * ShardStride());
+}
+
+/**
+ * The shard's own table places elements by the top 32 bits of the hash
+ * code, so the shard is chosen from the bits beneath them; taking it from
+ * the same bits would leave every element of a shard wanting the same small
+ * corner of its table.
+ */
+static ConcurrentHashSetShard *ShardFor(const concurrenthashset *h, const void *elemAddr) {
+  uint32_t low = (uint32_t)h->hashfn(elemAddr);
+  return ShardAt(h, h->numShards > 1 ? (int)(low >> h->shardShift) : 0);
+}
+
+static void LockShard(ConcurrentHashSetShard *shard, mybool exclusive) {
+  int failed = exclusive ? pthread_rwlock_wrlock(&shard->lock) : pthread_rwlock_rdlock(&shard->lock);
+  vector_assert(failed != 0, "Couldn't lock hashset shard.");
+}
+
+static void UnlockShard(ConcurrentHashSetShard *shard) {
+  pthread_rwlock_unlock(&shard->lock);
+}
+
+void ConcurrentHashSetNew(concurrenthashset *h, int elemSize, int numBuckets, int numShards,
+                          HashSetHash64Function hashfn, HashSetCompareFunction comparefn,
+                          HashSetFreeFunction freefn)
+{
+  vector_assert(numShards <= 0 || numShards > (1 << 16), "Number of shards is out of range.");
+  vector_assert(numBuckets <= 0, "Number of buckets must be greater than zero.");
+  int rounded = 1, shardBits = 0;
+  while (rounded < numShards) {
+    rounded *= 2;
+    shardBits++;
+  }
+  h->numShards = rounded;
+  h->shardShift = 32 - shardBits;
+  h->elemSize = elemSize;
+  h->hashfn = hashfn;
+  h->shards = aligned_alloc(kCacheLineSize, rounded * ShardStride());
+  vector_assert(h->shards == NULL, "Couldn't allocate hashset.");
+  int shardBuckets = numBuckets / rounded > 0 ? numBuckets / rounded : 1;
+  for (int s = 0; s < rounded; s++) {
+    ConcurrentHashSetShard *shard = ShardAt(h, s);
+    vector_assert(pthread_rwlock_init(&shard->lock, NULL) != 0, "Couldn't allocate hashset.");
+    HashSetNewWithHash64(&shard->set, elemSize, shardBuckets, hashfn, comparefn, freefn);
+  }
+}
+
+void ConcurrentHashSetDispose(concurrenthashset *h)
+{
+  for (int s = 0; s < h->numShards; s++) {
+    ConcurrentHashSetShard *shard = ShardAt(h, s);
+    HashSetDispose(&shard->set);
+    pthread_rwlock_destroy(&shard->lock);
+  }
+  free(h->shards);
+  h->shards = NULL;
+}
+
+int ConcurrentHashSetCount(const concurrenthashset *h)
+{
+  int count = 0;
+  for (int s = 0; s < h->numShards; s++) {
+    ConcurrentHashSetShard *shard = ShardAt(h, s);
+    LockShard(shard, FALSE);
+    count += HashSetCount(&shard->set);
+    UnlockShard(shard);
+  }
+  return count;
+}
+
+void ConcurrentHashSetEnter(concurrenthashset *h, const void *elemAddr)
+{
+  vector_assert(elemAddr == NULL, "Element address is NULL.");
+  ConcurrentHashSetShard *shard = ShardFor(h, elemAddr);
+  LockShard(shard, TRUE);
+  HashSetEnter(&shard->set, elemAddr);
+  UnlockShard(shard);
+}
+
+mybool ConcurrentHashSetEnterIfAbsent(concurrenthashset *h, const void *elemAddr)
+{
+  return ConcurrentHashSetFindOrEnter(h, elemAddr, NULL, NULL);
+}
+
+mybool ConcurrentHashSetFindOrEnter(concurrenthashset *h, const void *elemAddr,
+                                    HashSetMapFunction updatefn, void *auxData)
+{
+  vector_assert(elemAddr == NULL, "Element address is NULL.");
+  ConcurrentHashSetShard *shard = ShardFor(h, elemAddr);
+  LockShard(shard, TRUE);
+  mybool inserted;
+  void *stored = HashSetFindOrEnter(&shard->set, elemAddr, &inserted);
+  if (updatefn != NULL) updatefn(stored, auxData);
+  UnlockShard(shard);
+  return inserted;
+}
+
+mybool ConcurrentHashSetRemove(concurrenthashset *h, const void *elemAddr)
+{
+  vector_assert(elemAddr == NULL, "Element address is NULL.");
+  ConcurrentHashSetShard *shard = ShardFor(h, elemAddr);
+  LockShard(shard, TRUE);
+  mybool removed = HashSetRemove(&shard->set, elemAddr);
+  UnlockShard(shard);
+  return removed;
+}
+
+mybool ConcurrentHashSetLookup(const concurrenthashset *h, const void *keyAddr, void *foundAddr)
+{
+  vector_assert(keyAddr == NULL, "Element address is NULL.");
+  ConcurrentHashSetShard *shard = ShardFor(h, keyAddr);
+  LockShard(shard, FALSE);
+  const void *found = HashSetLookup(&shard->set, keyAddr);
+  if (found != NULL && foundAddr != NULL) memcpy(foundAddr, found, h->elemSize);
+  UnlockShard(shard);
+  return found != NULL ? TRUE : FALSE;
+}
+
+void ConcurrentHashSetMap(concurrenthashset *h, HashSetMapFunction mapfn, void *auxData)
+{
+  vector_assert(mapfn == NULL, "Map function was not provided.");
+  for (int s = 0; s < h->numShards; s++) {
+    ConcurrentHashSetShard *shard = ShardAt(h, s);
+    LockShard(shard, TRUE);
+    HashSetMap(&shard->set, mapfn, auxData);
+    UnlockShard(shard);
+  }
+}
@@ -0,0 +1,161 @@
+#ifndef _concurrenthashset_
+#define _concurrenthashset_
+#include "hashset.h"
+#include "bool.h"
+
+/* File: concurrenthashset.h
+ * -------------------------
+ * Defines a hashset that any number of threads may enter into, remove from
+ * and look up in at the same time.
+ *
+ * The set is split into shards, each an ordinary hashset behind its own
+ * reader-writer lock.  An element's hash code decides which shard it lives
+ * in, so threads working on different shards never contend, and lookups in
+ * the same shard proceed in parallel; only an enter or a removal holds a
+ * shard exclusively.  Each shard sits on its own cache lines, so locking one
+ * does not disturb its neighbours.  With enough shards (a small multiple of the
+ * thread count), throughput on a mixed workload grows with the number of
+ * cores.
+ *
+ * Because another thread may move or replace an element the moment a
+ * shard's lock is released, the concurrenthashset never hands out the
+ * addresses of its elements: lookups copy the element out instead.
+ *
+ * As with the vector and the hashset, a trace (see containertrace.h) can
+ * only be recorded from one thread at a time.
+ */
+
+/**
+ * Type: concurrenthashset
+ * -----------------------
+ * The concrete representation of the concurrenthashset.  The client is
+ * required to go through the functions below.
+ */
+
+typedef struct {
+  void *shards;           // numShards ConcurrentHashSetShards, defined in concurrenthashset.c
+  int numShards;          // a power of two
+  int shardShift;         // shard = low 32 hash bits >> shardShift
+  int elemSize;
+  HashSetHash64Function hashfn;
+} concurrenthashset;
+
+/**
+ * Function: ConcurrentHashSetNew
+ * Usage: ConcurrentHashSetNew(&sessions, sizeof(session), 1 << 16, 64,
+ *                             SessionHash, SessionCompare, NULL);
+ * ------------------------------
+ * Initializes the concurrenthashset to be empty, with numShards shards
+ * (rounded up to a power of two) sharing numBuckets initial slots between
+ * them.  Each shard grows by itself, as a hashset does.  The hash function
+ * returns a full 64-bit hash code as for HashSetNewWithHash64: its top 32
+ * bits place the element within its shard and the bits just below them
+ * choose the shard, so all of them need to be well mixed.  The functions
+ * are called from whichever threads use the set and must be safe to call
+ * concurrently.
+ *
+ * An assert is raised unless elemSize, numBuckets and numShards are
+ * positive and hashfn and comparefn are non-NULL.  This function is not
+ * itself thread-safe: the set must be created before it is shared.
+ */
+
+void ConcurrentHashSetNew(concurrenthashset *h, int elemSize, int numBuckets, int numShards,
+                          HashSetHash64Function hashfn, HashSetCompareFunction comparefn,
+                          HashSetFreeFunction freefn);
+
+/**
+ * Function: ConcurrentHashSetDispose
+ * ----------------------------------
+ * Frees every element (with the free function, if any) and the shards.  No
+ * other thread may be using the set.
+ */
+
+void ConcurrentHashSetDispose(concurrenthashset *h);
+
+/**
+ * Function: ConcurrentHashSetCount
+ * --------------------------------
+ * Returns the number of elements, adding up the shards one at a time.  If
+ * other threads are entering elements meanwhile, the result is not a
+ * snapshot of any single moment.
+ */
+
+int ConcurrentHashSetCount(const concurrenthashset *h);
+
+/**
+ * Function: ConcurrentHashSetEnter
+ * --------------------------------
+ * Inserts the element, replacing (and freeing) a stored element that
+ * compares equal to it, just as HashSetEnter does.  An assert is raised if
+ * elemAddr is NULL.
+ */
+
+void ConcurrentHashSetEnter(concurrenthashset *h, const void *elemAddr);
+
+/**
+ * Function: ConcurrentHashSetEnterIfAbsent
+ * ----------------------------------------
+ * Inserts the element only if no equal element is stored, as one atomic
+ * step: of any number of threads racing to enter equal elements, exactly
+ * one succeeds.  Returns TRUE if the element was entered and FALSE if an
+ * equal one was already there, which is left untouched.  An assert is
+ * raised if elemAddr is NULL.
+ */
+
+mybool ConcurrentHashSetEnterIfAbsent(concurrenthashset *h, const void *elemAddr);
+
+/**
+ * Function: ConcurrentHashSetFindOrEnter
+ * Usage: ConcurrentHashSetFindOrEnter(&counts, &word, IncrementCount, NULL);
+ * --------------------------------------
+ * The concurrenthashset's HashSetFindOrEnter.  Since it can't hand out an
+ * element's address, the update is passed in instead: the element matching
+ * elemAddr is found, or a copy of elemAddr is entered if there is none, and
+ * then updatefn is applied to the stored element with auxData, all in one
+ * probe under the shard's exclusive lock.  Concurrent updates to the same
+ * element therefore never interleave.  updatefn may be NULL, which makes
+ * this ConcurrentHashSetEnterIfAbsent.  Returns TRUE if the element was
+ * entered.  updatefn must not change how the element hashes or compares,
+ * nor call back into the set.  An assert is raised if elemAddr is NULL.
+ */
+
+mybool ConcurrentHashSetFindOrEnter(concurrenthashset *h, const void *elemAddr,
+                                    HashSetMapFunction updatefn, void *auxData);
+
+/**
+ * Function: ConcurrentHashSetRemove
+ * ---------------------------------
+ * Removes the element matching elemAddr, freeing it as HashSetRemove does,
+ * and returns TRUE; returns FALSE if there was no match.  Of any number of
+ * threads racing to remove the same element, exactly one gets TRUE.  An
+ * assert is raised if elemAddr is NULL.
+ */
+
+mybool ConcurrentHashSetRemove(concurrenthashset *h, const void *elemAddr);
+
+/**
+ * Function: ConcurrentHashSetLookup
+ * Usage: session current;
+ *        if (ConcurrentHashSetLookup(&sessions, &key, &current)) ...
+ * ---------------------------------
+ * Looks for an element matching the one at keyAddr.  If there is one, it is
+ * copied to foundAddr (unless foundAddr is NULL, for a plain membership
+ * test) and TRUE is returned; otherwise FALSE is returned.  The copy is
+ * made under the shard's lock, so it is never torn by a concurrent enter.
+ * An assert is raised if keyAddr is NULL.
+ */
+
+mybool ConcurrentHashSetLookup(const concurrenthashset *h, const void *keyAddr, void *foundAddr);
+
+/**
+ * Function: ConcurrentHashSetMap
+ * ------------------------------
+ * Applies mapfn to every element, one shard at a time, holding each shard
+ * exclusively while its elements are visited.  Elements entered into other
+ * shards during the walk may or may not be seen.  mapfn must not call back
+ * into the set.  An assert is raised if mapfn is NULL.
+ */
+
+void ConcurrentHashSetMap(concurrenthashset *h, HashSetMapFunction mapfn, void *auxData);
+
+#endif
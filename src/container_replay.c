@@ -0,0 +1,430 @@
+#include "containertrace.h"
+#include "vector.h"
+#include "hashset.h"
+#include "swisshashset.h"
+#include "orderedhashset.h"
+#include "concurrenthashset.h"
+#include "bool.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * File: container_replay.c
+ * ------------------------
+ * Replays a trace captured by the container trace recorder against a chosen
+ * backend and reports the latency distribution of each kind of operation.
+ *
+ *   container_replay <trace-file> [vector | aligned | hugepages]
+ *                                 [hashset | swiss | ordered | concurrent]
+ *
+ * Element contents are not part of a trace, so replayed elements are filled
+ * with a pattern derived from the logged index.  Searches replay as a scan
+ * for a key that is absent (the worst case), and calls whose index no longer
+ * fits the replayed container are skipped and counted.  Hashset elements are
+ * filled the same way from the logged hash code, so keys that repeated in
+ * the trace repeat in the replay.  The optional arguments, in either order,
+ * pick how replayed vectors are allocated and which hashset implementation
+ * the hashset records are replayed against; the defaults are a plain vector
+ * and the hashset.
+ */
+
+typedef enum {
+  kBackendVector,
+  kBackendAligned,
+  kBackendHugePages
+} ReplayBackend;
+
+typedef enum {
+  kSetBackendHashSet,
+  kSetBackendSwiss,
+  kSetBackendOrdered,
+  kSetBackendConcurrent
+} ReplaySetBackend;
+
+typedef struct {
+  uint64_t address;
+  mybool live;
+  mybool isHashSet;
+  ReplaySetBackend setBackend;
+  vector elems;
+  hashset set;
+  swisshashset swiss;
+  orderedhashset ordered;
+  concurrenthashset concurrent;
+} ReplayContainer;
+
+static const char *const kOpNames[kTraceNumOps] = {
+  "VectorNew", "VectorDispose", "VectorAppend", "VectorInsert", "VectorReplace",
+  "VectorDelete", "VectorNth", "VectorSearch", "VectorSort",
+  "HashSetNew", "HashSetDispose", "HashSetEnter", "HashSetLookup",
+  "HashSetFindOrEnter", "HashSetRemove"
+};
+
+static const int kReplayAlignment = 64;
+static const int kAdoptedHashSetBuckets = 64;
+static const int kReplayShards = 16;
+static int replayElemSize;
+
+static uint64_t NowNanos(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * CompareBytes
+ * ------------
+ * Comparator used for replayed sorts and searches; compares the raw bytes of
+ * two elements of the size currently being replayed.
+ */
+
+static int CompareBytes(const void *elemA, const void *elemB) {
+  return memcmp(elemA, elemB, replayElemSize);
+}
+
+/**
+ * ReplayHash
+ * ----------
+ * Hash function for replayed hashsets.  Replayed elements carry their logged
+ * hash code in their leading bytes, so that is what gets mixed.
+ */
+
+static int ReplayHash(const void *elemAddr, int numBuckets) {
+  uint32_t key = 0;
+  memcpy(&key, elemAddr, replayElemSize < (int)sizeof(key) ? replayElemSize : (int)sizeof(key));
+  return (int)((key * 2654435761u) % (uint32_t)numBuckets);
+}
+
+/**
+ * ReplayHash64
+ * ------------
+ * The same hash widened to 64 bits for the concurrenthashset, which takes
+ * its shard and slot from the high bits.
+ */
+
+static uint64_t ReplayHash64(const void *elemAddr) {
+  uint32_t key = 0;
+  memcpy(&key, elemAddr, replayElemSize < (int)sizeof(key) ? replayElemSize : (int)sizeof(key));
+  return key * 0x9e3779b97f4a7c15ULL;
+}
+
+static int CompareNanos(const void *elemA, const void *elemB) {
+  uint64_t a = *(const uint64_t *)elemA, b = *(const uint64_t *)elemB;
+  return (a > b) - (a < b);
+}
+
+static void FillElement(unsigned char *elem, int elemSize, int32_t index) {
+  for (int i = 0; i < elemSize; i++) {
+    elem[i] = (unsigned char)(index >> (8 * (i % 4)));
+  }
+}
+
+static void NewContainer(ReplayContainer *c, uint64_t address, int elemSize,
+                         int initialAllocation, ReplayBackend backend) {
+  c->address = address;
+  c->live = TRUE;
+  c->isHashSet = FALSE;
+  if (backend == kBackendVector) {
+    VectorNew(&c->elems, elemSize, NULL, initialAllocation);
+  } else {
+    VectorNewAligned(&c->elems, elemSize, NULL, initialAllocation, kReplayAlignment,
+                     backend == kBackendHugePages ? TRUE : FALSE);
+  }
+}
+
+static void NewHashSetContainer(ReplayContainer *c, uint64_t address, int elemSize,
+                                int numBuckets, ReplaySetBackend setBackend) {
+  c->address = address;
+  c->live = TRUE;
+  c->isHashSet = TRUE;
+  c->setBackend = setBackend;
+  if (numBuckets <= 0) numBuckets = 1;
+  switch (setBackend) {
+    case kSetBackendHashSet:
+      HashSetNew(&c->set, elemSize, numBuckets, ReplayHash, CompareBytes, NULL);
+      break;
+    case kSetBackendSwiss:
+      SwissHashSetNew(&c->swiss, elemSize, numBuckets, ReplayHash, CompareBytes, NULL);
+      break;
+    case kSetBackendOrdered:
+      OrderedHashSetNew(&c->ordered, elemSize, numBuckets, ReplayHash, CompareBytes, NULL);
+      break;
+    case kSetBackendConcurrent:
+      ConcurrentHashSetNew(&c->concurrent, elemSize, numBuckets, kReplayShards,
+                           ReplayHash64, CompareBytes, NULL);
+      break;
+  }
+}
+
+static void DisposeContainer(ReplayContainer *c) {
+  if (!c->isHashSet) {
+    VectorDispose(&c->elems);
+  } else {
+    switch (c->setBackend) {
+      case kSetBackendHashSet: HashSetDispose(&c->set); break;
+      case kSetBackendSwiss: SwissHashSetDispose(&c->swiss); break;
+      case kSetBackendOrdered: OrderedHashSetDispose(&c->ordered); break;
+      case kSetBackendConcurrent: ConcurrentHashSetDispose(&c->concurrent); break;
+    }
+  }
+  c->live = FALSE;
+}
+
+/**
+ * Functions: SetEnter, SetLookup, SetFindOrEnter, SetRemove
+ * ---------------------------------------------------------
+ * Forward one hashset operation to whichever implementation the replayed
+ * set was created with.
+ */
+
+static void SetEnter(ReplayContainer *c, const void *elem) {
+  switch (c->setBackend) {
+    case kSetBackendHashSet: HashSetEnter(&c->set, elem); break;
+    case kSetBackendSwiss: SwissHashSetEnter(&c->swiss, elem); break;
+    case kSetBackendOrdered: OrderedHashSetEnter(&c->ordered, elem); break;
+    case kSetBackendConcurrent: ConcurrentHashSetEnter(&c->concurrent, elem); break;
+  }
+}
+
+static void SetLookup(ReplayContainer *c, const void *elem) {
+  switch (c->setBackend) {
+    case kSetBackendHashSet: HashSetLookup(&c->set, elem); break;
+    case kSetBackendSwiss: SwissHashSetLookup(&c->swiss, elem); break;
+    case kSetBackendOrdered: OrderedHashSetLookup(&c->ordered, elem); break;
+    case kSetBackendConcurrent: ConcurrentHashSetLookup(&c->concurrent, elem, NULL); break;
+  }
+}
+
+static void SetFindOrEnter(ReplayContainer *c, const void *elem) {
+  switch (c->setBackend) {
+    case kSetBackendHashSet: HashSetFindOrEnter(&c->set, elem, NULL); break;
+    case kSetBackendSwiss: SwissHashSetFindOrEnter(&c->swiss, elem, NULL); break;
+    case kSetBackendOrdered: OrderedHashSetFindOrEnter(&c->ordered, elem, NULL); break;
+    case kSetBackendConcurrent: ConcurrentHashSetFindOrEnter(&c->concurrent, elem, NULL, NULL); break;
+  }
+}
+
+static void SetRemove(ReplayContainer *c, const void *elem) {
+  switch (c->setBackend) {
+    case kSetBackendHashSet: HashSetRemove(&c->set, elem); break;
+    case kSetBackendSwiss: SwissHashSetRemove(&c->swiss, elem); break;
+    case kSetBackendOrdered: OrderedHashSetRemove(&c->ordered, elem); break;
+    case kSetBackendConcurrent: ConcurrentHashSetRemove(&c->concurrent, elem); break;
+  }
+}
+
+/**
+ * Function: FindContainer
+ * -----------------------
+ * Returns the live replayed vector or hashset at the traced address, or
+ * NULL.  The scan runs from the most recently created container, which is
+ * almost always the one being asked for.
+ */
+
+static ReplayContainer *FindContainer(vector *containers, uint64_t address, mybool isHashSet) {
+  for (int i = VectorLength(containers) - 1; i >= 0; i--) {
+    ReplayContainer *c = VectorNth(containers, i);
+    if (c->live && c->address == address && c->isHashSet == isHashSet) return c;
+  }
+  return NULL;
+}
+
+/**
+ * Function: ReplayVectorOp
+ * ------------------------
+ * Performs one traced vector call against its replayed container and returns
+ * the time it took in nanoseconds, or -1 if the call had to be skipped.
+ */
+
+static int64_t ReplayVectorOp(vector *containers, const ContainerTraceRecord *record,
+                              unsigned char *elem, ReplayBackend backend) {
+  ReplayContainer *c = FindContainer(containers, record->container, FALSE);
+  if (c == NULL && record->op != kTraceVectorNew) {
+    // The trace began after this container was created; adopt it empty.
+    ReplayContainer adopted;
+    NewContainer(&adopted, record->container, record->elemSize, 0, backend);
+    VectorAppend(containers, &adopted);
+    c = FindContainer(containers, record->container, FALSE);
+  }
+  vector *v = c != NULL ? &c->elems : NULL;
+  int length = v != NULL ? VectorLength(v) : 0;
+  int index = record->index;
+  replayElemSize = record->elemSize;
+  FillElement(elem, record->elemSize, index);
+
+  mybool positional = record->op == kTraceVectorNth || record->op == kTraceVectorReplace ||
+                      record->op == kTraceVectorDelete || record->op == kTraceVectorSearch;
+  if (positional && (index < 0 || index >= length)) return -1;
+  if (record->op == kTraceVectorInsert && (index < 0 || index > length)) return -1;
+  if (record->op == kTraceVectorSearch) memset(elem, 0xff, record->elemSize);
+
+  uint64_t start = NowNanos();
+  switch (record->op) {
+    case kTraceVectorNew: {
+      if (c != NULL) DisposeContainer(c);
+      ReplayContainer fresh;
+      NewContainer(&fresh, record->container, record->elemSize, index, backend);
+      VectorAppend(containers, &fresh);
+      break;
+    }
+    case kTraceVectorDispose: DisposeContainer(c); break;
+    case kTraceVectorAppend: VectorAppend(v, elem); break;
+    case kTraceVectorInsert: VectorInsert(v, elem, index); break;
+    case kTraceVectorReplace: VectorReplace(v, elem, index); break;
+    case kTraceVectorDelete: VectorDelete(v, index); break;
+    case kTraceVectorNth: VectorNth(v, index); break;
+    case kTraceVectorSearch: VectorSearch(v, elem, CompareBytes, index, FALSE); break;
+    case kTraceVectorSort: VectorSort(v, CompareBytes); break;
+  }
+  return (int64_t)(NowNanos() - start);
+}
+
+/**
+ * Function: ReplayHashSetOp
+ * -------------------------
+ * Performs one traced hashset call against its replayed set, built with the
+ * chosen implementation, and returns the time it took in nanoseconds.
+ */
+
+static int64_t ReplayHashSetOp(vector *containers, const ContainerTraceRecord *record,
+                               unsigned char *elem, ReplaySetBackend setBackend) {
+  ReplayContainer *c = FindContainer(containers, record->container, TRUE);
+  if (c == NULL && record->op != kTraceHashSetNew) {
+    ReplayContainer adopted;
+    NewHashSetContainer(&adopted, record->container, record->elemSize, kAdoptedHashSetBuckets,
+                        setBackend);
+    VectorAppend(containers, &adopted);
+    c = FindContainer(containers, record->container, TRUE);
+  }
+  replayElemSize = record->elemSize;
+  FillElement(elem, record->elemSize, record->index);
+
+  uint64_t start = NowNanos();
+  switch (record->op) {
+    case kTraceHashSetNew: {
+      if (c != NULL) DisposeContainer(c);
+      ReplayContainer fresh;
+      NewHashSetContainer(&fresh, record->container, record->elemSize, record->index, setBackend);
+      VectorAppend(containers, &fresh);
+      break;
+    }
+    case kTraceHashSetDispose: DisposeContainer(c); break;
+    case kTraceHashSetEnter: SetEnter(c, elem); break;
+    case kTraceHashSetLookup: SetLookup(c, elem); break;
+    case kTraceHashSetFindOrEnter: SetFindOrEnter(c, elem); break;
+    case kTraceHashSetRemove: SetRemove(c, elem); break;
+  }
+  return (int64_t)(NowNanos() - start);
+}
+
+static uint64_t Percentile(const vector *sorted, double fraction) {
+  int rank = (int)(fraction * (VectorLength(sorted) - 1) + 0.5);
+  return *(const uint64_t *)VectorNth(sorted, rank);
+}
+
+/**
+ * Function: PrintLatencies
+ * ------------------------
+ * Sorts each operation's latency samples and prints one line per operation
+ * that occurred, giving the count and the p50/p90/p99/p99.9/max latencies.
+ */
+
+static void PrintLatencies(vector latencies[]) {
+  printf("%-18s %10s %8s %8s %8s %8s %10s\n", "operation", "count",
+         "p50 ns", "p90 ns", "p99 ns", "p99.9 ns", "max ns");
+  for (int op = 0; op < kTraceNumOps; op++) {
+    vector *samples = &latencies[op];
+    if (VectorLength(samples) == 0) continue;
+    VectorSort(samples, CompareNanos);
+    printf("%-18s %10d %8llu %8llu %8llu %8llu %10llu\n", kOpNames[op], VectorLength(samples),
+           (unsigned long long)Percentile(samples, 0.5),
+           (unsigned long long)Percentile(samples, 0.9),
+           (unsigned long long)Percentile(samples, 0.99),
+           (unsigned long long)Percentile(samples, 0.999),
+           (unsigned long long)Percentile(samples, 1.0));
+  }
+}
+
+/**
+ * Function: ParseBackends
+ * -----------------------
+ * Reads the optional backend arguments, at most one vector backend and one
+ * hashset backend in either order.  Returns FALSE on anything else.
+ */
+
+static mybool ParseBackends(int argc, char **argv, ReplayBackend *backend,
+                            ReplaySetBackend *setBackend) {
+  static const char *const kBackendNames[] = { "vector", "aligned", "hugepages" };
+  static const char *const kSetBackendNames[] = { "hashset", "swiss", "ordered", "concurrent" };
+  mybool sawBackend = FALSE, sawSetBackend = FALSE;
+  for (int arg = 0; arg < argc; arg++) {
+    mybool known = FALSE;
+    for (int b = 0; b < 3 && !known; b++) {
+      if (strcmp(argv[arg], kBackendNames[b]) != 0) continue;
+      if (sawBackend) return FALSE;
+      *backend = (ReplayBackend)b;
+      sawBackend = known = TRUE;
+    }
+    for (int b = 0; b < 4 && !known; b++) {
+      if (strcmp(argv[arg], kSetBackendNames[b]) != 0) continue;
+      if (sawSetBackend) return FALSE;
+      *setBackend = (ReplaySetBackend)b;
+      sawSetBackend = known = TRUE;
+    }
+    if (!known) return FALSE;
+  }
+  return TRUE;
+}
+
+int main(int argc, char **argv) {
+  ReplayBackend backend = kBackendVector;
+  ReplaySetBackend setBackend = kSetBackendHashSet;
+  if (argc < 2 || !ParseBackends(argc - 2, argv + 2, &backend, &setBackend)) {
+    fprintf(stderr, "usage: %s <trace-file> [vector | aligned | hugepages] "
+            "[hashset | swiss | ordered | concurrent]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  vector records;
+  VectorNew(&records, sizeof(ContainerTraceRecord), NULL, 1024);
+  ContainerTraceLoad(argv[1], &records);
+
+  vector containers, latencies[kTraceNumOps];
+  VectorNew(&containers, sizeof(ReplayContainer), NULL, 16);
+  for (int op = 0; op < kTraceNumOps; op++) {
+    VectorNew(&latencies[op], sizeof(uint64_t), NULL, 64);
+  }
+  unsigned char *elem = malloc(UINT16_MAX + 1);
+  int skipped = 0;
+  uint64_t replayStart = NowNanos();
+  for (int i = 0; i < VectorLength(&records); i++) {
+    const ContainerTraceRecord *record = VectorNth(&records, i);
+    int64_t nanos = record->op >= kTraceHashSetNew
+                        ? ReplayHashSetOp(&containers, record, elem, setBackend)
+                        : ReplayVectorOp(&containers, record, elem, backend);
+    if (nanos < 0) {
+      skipped++;
+    } else {
+      uint64_t sample = (uint64_t)nanos;
+      VectorAppend(&latencies[record->op], &sample);
+    }
+  }
+  uint64_t replayNanos = NowNanos() - replayStart;
+
+  printf("Replayed %d of %d operations in %.3f ms (%d skipped)\n",
+         VectorLength(&records) - skipped, VectorLength(&records), replayNanos / 1e6, skipped);
+  PrintLatencies(latencies);
+
+  for (int i = 0; i < VectorLength(&containers); i++) {
+    ReplayContainer *c = VectorNth(&containers, i);
+    if (c->live) DisposeContainer(c);
+  }
+  for (int op = 0; op < kTraceNumOps; op++) VectorDispose(&latencies[op]);
+  VectorDispose(&containers);
+  VectorDispose(&records);
+  free(elem);
+  return 0;
+}
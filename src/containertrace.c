@@ -0,0 +1,78 @@
+#include "containertrace.h"
+#include "vector_error.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static const char kTraceMagic[4] = { 'C', 'T', 'R', 'C' };
+static const uint32_t kTraceVersion = 1;
+enum { kTraceBufferRecords = 4096 };
+
+static FILE *traceFile = NULL;
+static ContainerTraceRecord traceBuffer[kTraceBufferRecords];
+static int traceBuffered = 0;
+
+static uint64_t MonotonicNanos(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+static void FlushTraceBuffer(void) {
+  size_t written = fwrite(traceBuffer, sizeof(ContainerTraceRecord), traceBuffered, traceFile);
+  vector_assert(written != (size_t)traceBuffered, "Couldn't write trace.");
+  traceBuffered = 0;
+}
+
+void ContainerTraceStart(const char *path)
+{
+  ContainerTraceStop();
+  traceFile = fopen(path, "wb");
+  vector_assert(traceFile == NULL, "Couldn't open trace file.");
+  vector_assert(fwrite(kTraceMagic, sizeof(kTraceMagic), 1, traceFile) != 1 ||
+                fwrite(&kTraceVersion, sizeof(kTraceVersion), 1, traceFile) != 1,
+                "Couldn't write trace.");
+}
+
+void ContainerTraceStop(void)
+{
+  if (traceFile == NULL) return;
+  FlushTraceBuffer();
+  vector_assert(fclose(traceFile) != 0, "Couldn't write trace.");
+  traceFile = NULL;
+}
+
+mybool ContainerTraceIsRunning(void)
+{ return traceFile != NULL ? TRUE : FALSE; }
+
+void ContainerTraceLog(ContainerTraceOp op, const void *container, int index, int elemSize)
+{
+  if (traceFile == NULL) return;
+  ContainerTraceRecord *record = &traceBuffer[traceBuffered];
+  record->timestamp = MonotonicNanos();
+  record->container = (uint64_t)(uintptr_t)container;
+  record->index = index;
+  record->elemSize = (uint16_t)elemSize;
+  record->op = (uint8_t)op;
+  record->reserved = 0;
+  if (++traceBuffered == kTraceBufferRecords) FlushTraceBuffer();
+}
+
+void ContainerTraceLoad(const char *path, vector *records)
+{
+  FILE *fp = fopen(path, "rb");
+  vector_assert(fp == NULL, "Couldn't open trace file.");
+  char magic[sizeof(kTraceMagic)];
+  uint32_t version;
+  vector_assert(fread(magic, sizeof(magic), 1, fp) != 1 ||
+                memcmp(magic, kTraceMagic, sizeof(magic)) != 0 ||
+                fread(&version, sizeof(version), 1, fp) != 1 ||
+                version != kTraceVersion, "Not a container trace.");
+  ContainerTraceRecord record;
+  while (fread(&record, sizeof(record), 1, fp) == 1) {
+    vector_assert(record.op >= kTraceNumOps, "Not a container trace.");
+    VectorAppend(records, &record);
+  }
+  vector_assert(ferror(fp), "Couldn't read trace.");
+  fclose(fp);
+}
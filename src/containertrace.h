@@ -0,0 +1,142 @@
+/**
+ * File: containertrace.h
+ * ----------------------
+ * Defines the operation trace recorder shared by the vector and the hashset.
+ *
+ * When the library is built with the VECTOR_TRACE option, every public
+ * vector and hashset call reports itself here, and while a trace is running
+ * each call is appended to a compact binary log: one fixed-size record per
+ * operation giving what was done, to which container, at what index, with
+ * what element size and when.  Built without the option the hooks compile
+ * away entirely.  The vectors other containers in the library keep inside
+ * themselves (a stringvector's spans, an orderedhashset's elements and so
+ * on) are made with VectorNewUntraced and never appear in a trace, so a
+ * trace holds just the calls the client made.  A captured log can be loaded back with ContainerTraceLoad
+ * and replayed against any backend by the container_replay tool.
+ *
+ * The recorder keeps one global log and is not thread-safe; trace a single
+ * thread at a time.
+ */
+
+#ifndef _containertrace_
+#define _containertrace_
+
+#include "bool.h"
+#include "vector.h"
+#include <stdint.h>
+
+/**
+ * Type: ContainerTraceOp
+ * ----------------------
+ * Identifies the traced operation.  The values are part of the log format,
+ * so new operations are only ever added at the end.
+ */
+
+typedef enum {
+  kTraceVectorNew,
+  kTraceVectorDispose,
+  kTraceVectorAppend,
+  kTraceVectorInsert,
+  kTraceVectorReplace,
+  kTraceVectorDelete,
+  kTraceVectorNth,
+  kTraceVectorSearch,
+  kTraceVectorSort,
+  kTraceHashSetNew,
+  kTraceHashSetDispose,
+  kTraceHashSetEnter,
+  kTraceHashSetLookup,
+  kTraceHashSetFindOrEnter,
+  kTraceHashSetRemove,
+  kTraceNumOps
+} ContainerTraceOp;
+
+/**
+ * Type: ContainerTraceRecord
+ * --------------------------
+ * One logged operation.  The container is identified by its address, which
+ * is unique among live containers; a replay treats a New on an address as
+ * the start of a fresh container.  The index is the position for positional
+ * vector calls, the initial allocation for VectorNew, the start index for
+ * VectorSearch, the bucket count for HashSetNew and, for the other hashset
+ * calls, the element's hash code from the set's own hash function over
+ * 2^31 - 1 buckets, so a replay can reproduce which keys repeat.
+ * Timestamps are monotonic nanoseconds.
+ */
+
+typedef struct {
+  uint64_t timestamp;
+  uint64_t container;
+  int32_t index;
+  uint16_t elemSize;
+  uint8_t op;
+  uint8_t reserved;
+} ContainerTraceRecord;
+
+/**
+ * Function: ContainerTraceStart
+ * Usage: ContainerTraceStart("run.trace");
+ * -----------------------------
+ * Begins logging to the file at path, which is created or truncated.  Any
+ * trace already running is stopped first.  An assert is raised if the file
+ * cannot be opened.
+ */
+
+void ContainerTraceStart(const char *path);
+
+/**
+ * Function: ContainerTraceStop
+ * ----------------------------
+ * Flushes and closes the running trace.  Does nothing if no trace is running.
+ */
+
+void ContainerTraceStop(void);
+
+/**
+ * Function: ContainerTraceIsRunning
+ * ---------------------------------
+ * Returns TRUE while a trace is being recorded.
+ */
+
+mybool ContainerTraceIsRunning(void);
+
+/**
+ * Function: ContainerTraceLog
+ * ---------------------------
+ * Appends one operation to the running trace, stamping it with the current
+ * time.  Records are buffered and written in large blocks.  Does nothing if
+ * no trace is running, so the container hooks may call it unconditionally.
+ */
+
+void ContainerTraceLog(ContainerTraceOp op, const void *container, int index, int elemSize);
+
+/**
+ * Function: ContainerTraceLoad
+ * ----------------------------
+ * Reads the trace at path into records, which must be a vector of
+ * ContainerTraceRecord constructed by the caller.  An assert is raised if
+ * the file cannot be opened or is not a trace.
+ */
+
+void ContainerTraceLoad(const char *path, vector *records);
+
+/**
+ * Macro: CONTAINER_TRACE
+ * ----------------------
+ * The hook placed at the top of each traced container call.  It expands to
+ * a ContainerTraceLog call only when the library is built with VECTOR_TRACE,
+ * and even then evaluates its arguments only while a trace is running, so
+ * a traced build that is not recording pays one test per call rather than,
+ * say, the extra hash a hashset computes for its records.
+ */
+
+#ifdef VECTOR_TRACE
+#define CONTAINER_TRACE(op, container, index, elemSize) \
+  do { \
+    if (ContainerTraceIsRunning()) ContainerTraceLog((op), (container), (index), (elemSize)); \
+  } while (0)
+#else
+#define CONTAINER_TRACE(op, container, index, elemSize) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,239 @@
+#include "externalsort.h"
+#include "vector_error.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const size_t kMinMergeBuffer = 64 * 1024;
+
+/**
+ * Type: SortedRun
+ * ---------------
+ * Locates one sorted run within a spill file.  All runs of a pass share a
+ * single temporary file, so the number of runs is not bounded by the number
+ * of files the process may hold open.
+ */
+
+typedef struct {
+  long offset;      // in bytes
+  size_t length;    // in records
+} SortedRun;
+
+/**
+ * Type: RunReader
+ * ---------------
+ * A sorted run being merged, together with a buffer of its records filled
+ * by one large sequential read at a time.
+ */
+
+typedef struct {
+  long position;
+  size_t remaining;
+  char *buffer;
+  size_t capacity;  // in records
+  size_t count;
+  size_t next;
+  mybool exhausted;
+} RunReader;
+
+typedef struct {
+  FILE *fp;
+  RunReader *runs;
+  int numRuns;
+  int *tree;        // tree[0] is the overall winner, tree[1..k-1] the losers
+  int elemSize;
+  VectorCompareFunction compare;
+} LoserTree;
+
+static void RefillRun(LoserTree *lt, RunReader *run) {
+  run->next = 0;
+  run->count = run->remaining < run->capacity ? run->remaining : run->capacity;
+  run->exhausted = run->count == 0 ? TRUE : FALSE;
+  if (run->exhausted) return;
+  vector_assert(fseek(lt->fp, run->position, SEEK_SET) != 0 ||
+                fread(run->buffer, lt->elemSize, run->count, lt->fp) != run->count,
+                "Couldn't read sorted run.");
+  run->position += (long)(run->count * lt->elemSize);
+  run->remaining -= run->count;
+}
+
+static const void *RunHead(const LoserTree *lt, int run) {
+  const RunReader *reader = &lt->runs[run];
+  return reader->buffer + reader->next * lt->elemSize;
+}
+
+/**
+ * Returns TRUE if run a's head should be output before run b's.  Exhausted
+ * runs lose to everything, and ties go to the lower-numbered run.
+ */
+static mybool Beats(const LoserTree *lt, int a, int b) {
+  if (lt->runs[a].exhausted) return FALSE;
+  if (lt->runs[b].exhausted) return TRUE;
+  int cmp = lt->compare(RunHead(lt, a), RunHead(lt, b));
+  return cmp < 0 || (cmp == 0 && a < b) ? TRUE : FALSE;
+}
+
+static int BuildLoserTree(LoserTree *lt, int node) {
+  if (node >= lt->numRuns) return node - lt->numRuns;
+  int left = BuildLoserTree(lt, 2 * node);
+  int right = BuildLoserTree(lt, 2 * node + 1);
+  if (Beats(lt, left, right)) {
+    lt->tree[node] = right;
+    return left;
+  }
+  lt->tree[node] = left;
+  return right;
+}
+
+static void ReplayLoserTree(LoserTree *lt, int winner) {
+  for (int node = (winner + lt->numRuns) / 2; node > 0; node /= 2) {
+    if (Beats(lt, lt->tree[node], winner)) {
+      int loser = winner;
+      winner = lt->tree[node];
+      lt->tree[node] = loser;
+    }
+  }
+  lt->tree[0] = winner;
+}
+
+static void WriteRecords(FILE *out, const void *records, size_t count, int elemSize) {
+  vector_assert(fwrite(records, elemSize, count, out) != count, "Couldn't write sorted output.");
+}
+
+/**
+ * Merges runs[0..numRuns) of the spill file into out, splitting bufferBytes
+ * evenly between one read buffer per run and the output buffer.
+ */
+static void MergeRuns(FILE *spill, const SortedRun *runs, int numRuns, FILE *out,
+                      int elemSize, VectorCompareFunction compare, size_t bufferBytes) {
+  size_t recordsPerBuffer = bufferBytes / (numRuns + 1) / elemSize;
+  if (recordsPerBuffer == 0) recordsPerBuffer = 1;
+  LoserTree lt = { spill, NULL, numRuns, NULL, elemSize, compare };
+  lt.runs = malloc(numRuns * sizeof(RunReader));
+  lt.tree = malloc((numRuns + 1) * sizeof(int));
+  char *outBuffer = malloc(recordsPerBuffer * elemSize);
+  vector_assert(lt.runs == NULL || lt.tree == NULL || outBuffer == NULL,
+                "Couldn't allocate merge buffers.");
+  for (int r = 0; r < numRuns; r++) {
+    RunReader *run = &lt.runs[r];
+    run->position = runs[r].offset;
+    run->remaining = runs[r].length;
+    run->capacity = recordsPerBuffer;
+    run->buffer = malloc(recordsPerBuffer * elemSize);
+    vector_assert(run->buffer == NULL, "Couldn't allocate merge buffers.");
+    RefillRun(&lt, run);
+  }
+
+  lt.tree[0] = numRuns == 1 ? 0 : BuildLoserTree(&lt, 1);
+  size_t buffered = 0;
+  while (!lt.runs[lt.tree[0]].exhausted) {
+    int winner = lt.tree[0];
+    RunReader *run = &lt.runs[winner];
+    memcpy(outBuffer + buffered * elemSize, RunHead(&lt, winner), elemSize);
+    if (++buffered == recordsPerBuffer) {
+      WriteRecords(out, outBuffer, buffered, elemSize);
+      buffered = 0;
+    }
+    if (++run->next == run->count) RefillRun(&lt, run);
+    ReplayLoserTree(&lt, winner);
+  }
+  WriteRecords(out, outBuffer, buffered, elemSize);
+
+  for (int r = 0; r < numRuns; r++) free(lt.runs[r].buffer);
+  free(lt.runs);
+  free(lt.tree);
+  free(outBuffer);
+}
+
+/**
+ * Reads the input a run at a time into a vector, sorts it and appends it to
+ * the spill file, recording where each run landed in runs.
+ */
+static void SpillSortedRuns(FILE *in, FILE *spill, vector *runs, int elemSize,
+                            VectorCompareFunction compare, int recordsPerRun) {
+  char *record = malloc(elemSize);
+  vector_assert(record == NULL, "Couldn't allocate record buffer.");
+  mybool done = FALSE;
+  while (!done) {
+    vector run;
+    VectorNewUntraced(&run, elemSize, NULL, recordsPerRun);
+    while (VectorLength(&run) < recordsPerRun) {
+      size_t got = fread(record, 1, elemSize, in);
+      vector_assert(got != 0 && got != (size_t)elemSize, "Input is not a whole number of records.");
+      if (got == 0) {
+        done = TRUE;
+        break;
+      }
+      VectorAppend(&run, record);
+    }
+    vector_assert(ferror(in), "Couldn't read input file.");
+    if (VectorLength(&run) > 0) {
+      VectorSort(&run, compare);
+      SortedRun sorted = { ftell(spill), VectorLength(&run) };
+      WriteRecords(spill, VectorNth(&run, 0), sorted.length, elemSize);
+      VectorAppend(runs, &sorted);
+    }
+    VectorDispose(&run);
+  }
+  free(record);
+}
+
+static FILE *OpenSpillFile(void) {
+  FILE *spill = tmpfile();
+  vector_assert(spill == NULL, "Couldn't create temporary run file.");
+  setvbuf(spill, NULL, _IOFBF, kMinMergeBuffer);
+  return spill;
+}
+
+void VectorExternalSort(const char *inputPath, const char *outputPath, int elemSize,
+                        VectorCompareFunction compare, size_t memoryBudget)
+{
+  vector_assert(elemSize <= 0, "Element size must be greater than zero.");
+  vector_assert(compare == NULL, "Failed sort, no compare function provided");
+  vector_assert(memoryBudget < (size_t)elemSize, "Memory budget cannot hold a single record.");
+  size_t recordsPerRun = memoryBudget / elemSize;
+  if (recordsPerRun > 0x7fffffff) recordsPerRun = 0x7fffffff;
+
+  FILE *in = fopen(inputPath, "rb");
+  vector_assert(in == NULL, "Couldn't open input file.");
+  setvbuf(in, NULL, _IOFBF, kMinMergeBuffer);
+  FILE *spill = OpenSpillFile();
+  vector runs;
+  VectorNewUntraced(&runs, sizeof(SortedRun), NULL, 16);
+  SpillSortedRuns(in, spill, &runs, elemSize, compare, (int)recordsPerRun);
+  fclose(in);
+
+  // Each merge gives every input run and the output at least kMinMergeBuffer
+  // bytes (or one record), so the fan-in is bounded by the budget.
+  size_t minBuffer = kMinMergeBuffer > (size_t)elemSize ? kMinMergeBuffer : (size_t)elemSize;
+  int fanIn = (int)(memoryBudget / minBuffer) - 1;
+  if (fanIn < 2) fanIn = 2;
+  while (VectorLength(&runs) > fanIn) {
+    FILE *nextSpill = OpenSpillFile();
+    vector merged;
+    VectorNewUntraced(&merged, sizeof(SortedRun), NULL, VectorLength(&runs) / fanIn + 1);
+    for (int first = 0; first < VectorLength(&runs); first += fanIn) {
+      int count = VectorLength(&runs) - first < fanIn ? VectorLength(&runs) - first : fanIn;
+      SortedRun combined = { ftell(nextSpill), 0 };
+      for (int r = first; r < first + count; r++) {
+        combined.length += ((SortedRun *)VectorNth(&runs, r))->length;
+      }
+      MergeRuns(spill, VectorNth(&runs, first), count, nextSpill, elemSize, compare, memoryBudget);
+      VectorAppend(&merged, &combined);
+    }
+    fclose(spill);
+    spill = nextSpill;
+    VectorDispose(&runs);
+    runs = merged;
+  }
+
+  FILE *out = fopen(outputPath, "wb");
+  vector_assert(out == NULL, "Couldn't open output file.");
+  setvbuf(out, NULL, _IOFBF, kMinMergeBuffer);
+  if (VectorLength(&runs) > 0) {
+    MergeRuns(spill, VectorNth(&runs, 0), VectorLength(&runs), out, elemSize, compare, memoryBudget);
+  }
+  vector_assert(fclose(out) != 0, "Couldn't write sorted output.");
+  fclose(spill);
+  VectorDispose(&runs);
+}
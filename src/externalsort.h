@@ -0,0 +1,44 @@
+/**
+ * File: externalsort.h
+ * --------------------
+ * Defines an external merge sort for files of fixed-size records that are
+ * too large to sort in memory with VectorSort.
+ */
+
+#ifndef _externalsort_
+#define _externalsort_
+
+#include "vector.h"
+#include <stddef.h>
+
+/**
+ * Function: VectorExternalSort
+ * Usage: VectorExternalSort("ids.bin", "ids.sorted.bin", sizeof(long),
+ *                           LongCompare, 256 << 20);
+ * ----------------------------
+ * Sorts the file at inputPath, understood to be a packed array of records of
+ * elemSize bytes each, into ascending order according to comparefn, and
+ * writes the result to outputPath (which is created or truncated).
+ *
+ * The sort never holds more than roughly memoryBudget bytes of records at
+ * once.  It reads the input a budget's worth at a time into a vector, sorts
+ * each run with VectorSort and appends it to an anonymous temporary file.  The
+ * runs are then combined by k-way merges driven by a loser tree, each run
+ * read and the output written through large sequential buffers carved out of
+ * the same budget.  If there are more runs than the budget can buffer at
+ * once, the runs are merged in several passes.
+ *
+ * The sort is not stable.  VectorSort is built on qsort, so records that
+ * compare equal may be reordered within a run; the merges break ties in
+ * favor of the earlier run, so equal records from different runs do keep
+ * their input order.
+ *
+ * An assert is raised if elemSize is not positive, the comparator is NULL,
+ * the budget cannot hold at least one record, the input size is not a
+ * multiple of elemSize, or any file cannot be opened, read or written.
+ */
+
+void VectorExternalSort(const char *inputPath, const char *outputPath, int elemSize,
+                        VectorCompareFunction comparefn, size_t memoryBudget);
+
+#endif
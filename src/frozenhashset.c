@@ -0,0 +1,282 @@
+#include "frozenhashset.h"
+#include "vector_error.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const int kPrimeBucketsA = 2147483647;   // 2^31 - 1
+static const int kPrimeBucketsB = 2147483629;   // 2^31 - 19
+static const int kElementsPerGroup = 4;
+static const uint64_t kGoldenRatio = 0x9e3779b97f4a7c15ULL;
+
+/**
+ * The splitmix64 finalizer: every input bit affects every output bit.
+ */
+static uint64_t Mix64(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+/**
+ * Maps the top 32 bits of a mixed hash evenly onto [0, range).
+ */
+static int Reduce(uint64_t mixed, int range) {
+  return (int)(((mixed >> 32) * (uint64_t)range) >> 32);
+}
+
+static int CheckedHash(HashSetHashFunction hashfn, const void *elemAddr, int numBuckets) {
+  int code = hashfn(elemAddr, numBuckets);
+  vector_assert(code < 0 || code >= numBuckets, "Hash code out of range.");
+  return code;
+}
+
+/**
+ * The 64-bit hash code the perfect hash is built on; see HashSetFreeze.
+ */
+static uint64_t RawHash(HashSetHashFunction hashfn, HashSetHash64Function hash64fn,
+                        const void *elemAddr) {
+  if (hash64fn != NULL) return hash64fn(elemAddr);
+  return (uint64_t)CheckedHash(hashfn, elemAddr, kPrimeBucketsA) * (uint64_t)kPrimeBucketsB +
+         (uint64_t)CheckedHash(hashfn, elemAddr, kPrimeBucketsB);
+}
+
+static int GroupOf(const frozenhashset *f, uint64_t mixed) {
+  return Reduce(mixed, f->numGroups);
+}
+
+static int SlotOf(const frozenhashset *f, uint64_t mixed, uint32_t pilot) {
+  return Reduce(Mix64(mixed ^ (pilot * kGoldenRatio)), f->numSlots);
+}
+
+static char *ElemAt(const frozenhashset *f, int slot) {
+  return f->elems + (size_t)slot * f->elemSize;
+}
+
+/**
+ * Type: FreezeKey
+ * ---------------
+ * One element being frozen: its hash code (raw, then mixed with the seed)
+ * and where it currently lives in the hashset.
+ */
+
+typedef struct {
+  uint64_t raw;
+  uint64_t mixed;
+  const char *elem;
+} FreezeKey;
+
+static void CollectKey(void *elemAddr, void *auxData) {
+  FreezeKey **next = auxData;
+  (*next)->elem = elemAddr;
+  (*next)++;
+}
+
+static int CompareRawHashes(const void *elemAddr1, const void *elemAddr2) {
+  uint64_t a = ((const FreezeKey *)elemAddr1)->raw, b = ((const FreezeKey *)elemAddr2)->raw;
+  return (a > b) - (a < b);
+}
+
+/**
+ * Fills byGroup with the key indices ordered by group, and groupStart (of
+ * numGroups + 1 entries) with where each group's run begins.  Returns the
+ * size of the largest group.
+ */
+static int SortKeysByGroup(const frozenhashset *f, const FreezeKey *keys, int *byGroup, int *groupStart) {
+  memset(groupStart, 0, (f->numGroups + 1) * sizeof(int));
+  for (int k = 0; k < f->numSlots; k++) groupStart[GroupOf(f, keys[k].mixed) + 1]++;
+  int maxGroupSize = 0;
+  for (int g = 0; g < f->numGroups; g++) {
+    if (groupStart[g + 1] > maxGroupSize) maxGroupSize = groupStart[g + 1];
+    groupStart[g + 1] += groupStart[g];
+  }
+  int *fill = malloc(f->numGroups * sizeof(int));
+  vector_assert(fill == NULL, "Couldn't allocate frozen hashset.");
+  memcpy(fill, groupStart, f->numGroups * sizeof(int));
+  for (int k = 0; k < f->numSlots; k++) byGroup[fill[GroupOf(f, keys[k].mixed)]++] = k;
+  free(fill);
+  return maxGroupSize;
+}
+
+/**
+ * Fills groupOrder with the groups from largest to smallest.
+ */
+static void OrderGroupsBySize(const frozenhashset *f, const int *groupStart, int maxGroupSize,
+                              int *groupOrder) {
+  int *sizeStart = calloc(maxGroupSize + 2, sizeof(int));
+  vector_assert(sizeStart == NULL, "Couldn't allocate frozen hashset.");
+  for (int g = 0; g < f->numGroups; g++) {
+    sizeStart[maxGroupSize - (groupStart[g + 1] - groupStart[g]) + 1]++;
+  }
+  for (int s = 0; s <= maxGroupSize; s++) sizeStart[s + 1] += sizeStart[s];
+  for (int g = 0; g < f->numGroups; g++) {
+    groupOrder[sizeStart[maxGroupSize - (groupStart[g + 1] - groupStart[g])]++] = g;
+  }
+  free(sizeStart);
+}
+
+/**
+ * Tries to find a pilot for every group under the current seed, placing the
+ * largest groups first while the table is emptiest.  A group's pilot is the
+ * first value that sends each of its keys to a distinct untaken slot.
+ * Returns FALSE if some group exhausts maxPilot, in which case the caller
+ * picks another seed.  On success slotOf holds each key's slot.
+ */
+static mybool FindPilots(frozenhashset *f, const FreezeKey *keys, int *slotOf, uint32_t maxPilot) {
+  int *groupStart = malloc((f->numGroups + 1) * sizeof(int));
+  int *byGroup = malloc((f->numSlots > 0 ? f->numSlots : 1) * sizeof(int));
+  int *groupOrder = malloc(f->numGroups * sizeof(int));
+  unsigned char *taken = calloc(f->numSlots > 0 ? f->numSlots : 1, 1);
+  vector_assert(groupStart == NULL || byGroup == NULL || groupOrder == NULL || taken == NULL,
+                "Couldn't allocate frozen hashset.");
+  int maxGroupSize = SortKeysByGroup(f, keys, byGroup, groupStart);
+  OrderGroupsBySize(f, groupStart, maxGroupSize, groupOrder);
+
+  mybool placed = TRUE;
+  for (int o = 0; o < f->numGroups && placed; o++) {
+    int g = groupOrder[o];
+    int first = groupStart[g], size = groupStart[g + 1] - first;
+    f->pilots[g] = 0;
+    if (size == 0) continue;
+    for (uint32_t pilot = 0; ; pilot++) {
+      if (pilot > maxPilot) {
+        placed = FALSE;
+        break;
+      }
+      int i = 0;
+      for (; i < size; i++) {
+        int k = byGroup[first + i];
+        int slot = SlotOf(f, keys[k].mixed, pilot);
+        if (taken[slot]) break;
+        taken[slot] = 1;     // claimed tentatively, which also catches clashes within the group
+        slotOf[k] = slot;
+      }
+      if (i == size) {
+        f->pilots[g] = pilot;
+        break;
+      }
+      while (--i >= 0) taken[slotOf[byGroup[first + i]]] = 0;
+    }
+  }
+  free(groupStart);
+  free(byGroup);
+  free(groupOrder);
+  free(taken);
+  return placed;
+}
+
+void HashSetFreeze(hashset *h, frozenhashset *f)
+{
+  int numKeys = HashSetCount(h);
+  f->elemSize = h->elemSize;
+  f->hashfn = h->hashfn;
+  f->hash64fn = h->hash64fn;
+  f->comparefn = h->comparefn;
+  f->freefn = h->freefn;
+  VectorNewUntraced(&f->overflow, h->elemSize, NULL, 4);
+
+  FreezeKey *keys = malloc((numKeys > 0 ? numKeys : 1) * sizeof(FreezeKey));
+  vector_assert(keys == NULL, "Couldn't allocate frozen hashset.");
+  FreezeKey *next = keys;
+  HashSetMap(h, CollectKey, &next);
+  for (int k = 0; k < numKeys; k++) keys[k].raw = RawHash(f->hashfn, f->hash64fn, keys[k].elem);
+
+  // Elements that share a hash code with one already kept can't be slotted.
+  // Sorting first leaves the overflow in hash code order too.
+  qsort(keys, numKeys, sizeof(FreezeKey), CompareRawHashes);
+  f->overflowHashes = malloc((numKeys > 0 ? numKeys : 1) * sizeof(uint64_t));
+  vector_assert(f->overflowHashes == NULL, "Couldn't allocate frozen hashset.");
+  int numUnique = 0;
+  for (int k = 0; k < numKeys; k++) {
+    if (numUnique > 0 && keys[k].raw == keys[numUnique - 1].raw) {
+      f->overflowHashes[VectorLength(&f->overflow)] = keys[k].raw;
+      VectorAppend(&f->overflow, keys[k].elem);
+    } else {
+      keys[numUnique++] = keys[k];
+    }
+  }
+
+  f->numSlots = numUnique;
+  f->numGroups = numUnique / kElementsPerGroup + 1;
+  f->pilots = malloc(f->numGroups * sizeof(uint32_t));
+  f->elems = malloc((size_t)(numUnique > 0 ? numUnique : 1) * f->elemSize);
+  int *slotOf = malloc((numUnique > 0 ? numUnique : 1) * sizeof(int));
+  vector_assert(f->pilots == NULL || f->elems == NULL || slotOf == NULL,
+                "Couldn't allocate frozen hashset.");
+  // The last few keys into a nearly full table may need on the order of
+  // numSlots tries; a budget well beyond that almost never runs out.
+  uint32_t maxPilot = numUnique < (1 << 27) ? (uint32_t)numUnique * 16 + 1024 : UINT32_MAX - 1;
+  for (uint64_t attempt = 1; ; attempt++) {
+    f->seed = Mix64(attempt * kGoldenRatio);
+    for (int k = 0; k < numUnique; k++) keys[k].mixed = Mix64(keys[k].raw ^ f->seed);
+    if (FindPilots(f, keys, slotOf, maxPilot)) break;
+  }
+  for (int k = 0; k < numUnique; k++) memcpy(ElemAt(f, slotOf[k]), keys[k].elem, f->elemSize);
+  free(slotOf);
+  free(keys);
+
+  // The elements have all been copied out, so h must not free them.
+  h->freefn = NULL;
+  HashSetDispose(h);
+}
+
+void FrozenHashSetDispose(frozenhashset *f)
+{
+  if (f->freefn != NULL) {
+    for (int slot = 0; slot < f->numSlots; slot++) f->freefn(ElemAt(f, slot));
+    for (int i = 0; i < VectorLength(&f->overflow); i++) f->freefn(VectorNth(&f->overflow, i));
+  }
+  VectorDispose(&f->overflow);
+  free(f->overflowHashes);
+  free(f->elems);
+  free(f->pilots);
+  f->overflowHashes = NULL;
+  f->elems = NULL;
+  f->pilots = NULL;
+}
+
+int FrozenHashSetCount(const frozenhashset *f)
+{ return f->numSlots + VectorLength(&f->overflow); }
+
+/**
+ * Returns the overflow element matching elemAddr, whose raw hash code is
+ * raw, or NULL.  Only the run of elements sharing that code is compared.
+ */
+static void *FindInOverflow(const frozenhashset *f, const void *elemAddr, uint64_t raw) {
+  int lo = 0, hi = VectorLength(&f->overflow);
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (f->overflowHashes[mid] < raw) lo = mid + 1;
+    else hi = mid;
+  }
+  for (; lo < VectorLength(&f->overflow) && f->overflowHashes[lo] == raw; lo++) {
+    void *candidate = VectorNth(&f->overflow, lo);
+    if (f->comparefn(candidate, elemAddr) == 0) return candidate;
+  }
+  return NULL;
+}
+
+void *FrozenHashSetLookup(const frozenhashset *f, const void *elemAddr)
+{
+  vector_assert(elemAddr == NULL, "Element address is NULL.");
+  if (f->numSlots == 0) return NULL;
+  uint64_t raw = RawHash(f->hashfn, f->hash64fn, elemAddr);
+  uint64_t mixed = Mix64(raw ^ f->seed);
+  char *elem = ElemAt(f, SlotOf(f, mixed, f->pilots[GroupOf(f, mixed)]));
+  if (f->comparefn(elem, elemAddr) == 0) return elem;
+  return FindInOverflow(f, elemAddr, raw);
+}
+
+void FrozenHashSetMap(frozenhashset *f, HashSetMapFunction mapfn, void *auxData)
+{
+  vector_assert(mapfn == NULL, "Map function was not provided.");
+  for (int slot = 0; slot < f->numSlots; slot++) mapfn(ElemAt(f, slot), auxData);
+  VectorMap(&f->overflow, mapfn, auxData);
+}
+
+size_t FrozenHashSetBytesUsed(const frozenhashset *f)
+{
+  return (size_t)f->numSlots * f->elemSize + (size_t)f->numGroups * sizeof(uint32_t) +
+         (size_t)VectorLength(&f->overflow) * (f->elemSize + sizeof(uint64_t));
+}
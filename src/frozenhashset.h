@@ -0,0 +1,127 @@
+#ifndef _frozenhashset_
+#define _frozenhashset_
+#include "hashset.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/* File: frozenhashset.h
+ * ---------------------
+ * Defines a read-only hashset for data that is loaded once and only
+ * queried from then on.
+ *
+ * A populated hashset is frozen into a frozenhashset with HashSetFreeze,
+ * which builds a minimal perfect hash function for exactly the elements it
+ * holds, in the style of CHD ("hash, displace and compress").  The elements
+ * are hashed into small groups of about four, and for each group a number,
+ * its pilot, is searched for that sends every element in the group to a
+ * slot no earlier group has taken.  With n elements there are exactly n
+ * slots, and each element sits in the one slot its hash and its group's
+ * pilot pick out.
+ *
+ * A lookup therefore computes one slot and makes one comparison, whether
+ * the key is there or not: no probe sequence, no empty slots, no distances
+ * or control bytes.  The elements are packed end to end and the pilots take
+ * about a byte per element, so a frozen set is usually much smaller than
+ * the hashset it came from.
+ */
+
+/**
+ * Type: frozenhashset
+ * -------------------
+ * The concrete representation of the frozenhashset.  The client is
+ * required to go through the functions below.
+ */
+
+typedef struct {
+  char *elems;            // numSlots elements, each in the slot its perfect hash picks
+  uint32_t *pilots;       // one per group
+  int numSlots;
+  int numGroups;
+  int elemSize;
+  uint64_t seed;          // mixed into every hash; rechosen if no pilots are found
+  vector overflow;        // elements whose hash codes equal a slotted element's
+  uint64_t *overflowHashes; // their raw hash codes, in ascending order
+  HashSetHashFunction hashfn;
+  HashSetHash64Function hash64fn;
+  HashSetCompareFunction comparefn;
+  HashSetFreeFunction freefn;
+} frozenhashset;
+
+/**
+ * Function: HashSetFreeze
+ * Usage: frozenhashset frozen;
+ *        HashSetFreeze(&thesaurus, &frozen);
+ * -----------------------
+ * Moves every element of h into the frozenhashset f and disposes of h.  The
+ * elements are not freed; f now owns them and will apply h's free function
+ * to them when it is disposed of.  h must not be used again except to pass
+ * it to HashSetNew.
+ *
+ * The perfect hash is built from 64-bit hash codes.  For a set created
+ * with HashSetNewWithHash64 those come straight from its hash function.
+ * Otherwise the hash function is called with two different numBuckets, the
+ * primes 2^31 - 1 and 2^31 - 19, and the two results are combined.  A
+ * function of the usual "hashcode % numBuckets" form then yields about 62
+ * bits of its underlying hash code.
+ *
+ * Elements that compare unequal but get identical hash codes cannot be
+ * told apart by any hash function built on those codes, so all but one of
+ * each such group go into an overflow list, kept in order of hash code.
+ * When the one probe fails, a lookup binary searches the list's hash codes
+ * and compares the key only against the elements whose code matches its
+ * own, so a key that isn't there costs no extra comparisons.  The list is
+ * empty unless the hash function collides (a case-insensitive string hash
+ * over keys that differ only in case, say).
+ *
+ * Freezing takes time roughly proportional to the number of elements.
+ */
+
+void HashSetFreeze(hashset *h, frozenhashset *f);
+
+/**
+ * Function: FrozenHashSetDispose
+ * ------------------------------
+ * Applies the free function, if any, to every element and releases the
+ * frozenhashset.
+ */
+
+void FrozenHashSetDispose(frozenhashset *f);
+
+/**
+ * Function: FrozenHashSetCount
+ * ----------------------------
+ * Returns the number of elements in the frozenhashset.
+ */
+
+int FrozenHashSetCount(const frozenhashset *f);
+
+/**
+ * Function: FrozenHashSetLookup
+ * -----------------------------
+ * Returns the address of the element matching elemAddr, or NULL.  The
+ * address stays good until the set is disposed of.  An assert is raised if
+ * elemAddr is NULL or the hash function returns a code out of range.
+ */
+
+void *FrozenHashSetLookup(const frozenhashset *f, const void *elemAddr);
+
+/**
+ * Function: FrozenHashSetMap
+ * --------------------------
+ * Applies mapfn to every element.  The mapping function may modify the
+ * elements, but not in any way that changes how they hash or compare.  An
+ * assert is raised if mapfn is NULL.
+ */
+
+void FrozenHashSetMap(frozenhashset *f, HashSetMapFunction mapfn, void *auxData);
+
+/**
+ * Function: FrozenHashSetBytesUsed
+ * --------------------------------
+ * Returns the number of bytes taken by the elements, the pilots and the
+ * overflow list.
+ */
+
+size_t FrozenHashSetBytesUsed(const frozenhashset *f);
+
+#endif
@@ -1,23 +1,473 @@
 #include "hashset.h"
-#include <assert.h>
+#include "vector_error.h"
+#include "containertrace.h"
+#include <limits.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+static const double kDefaultMaxLoadFactor = 0.875;
+enum { kLookupBatchWindow = 16 };           // keys hashed and prefetched ahead of the probes
+static const int kMaxSlotAlignment = 16;
+enum { kTraceHashBuckets = 0x7fffffff };   // the traced identity of an element
+
+/**
+ * Type: SlotTable
+ * ---------------
+ * One slot array and its size.  A hashset normally has just the one, but
+ * while an incremental rehash is under way it also has the array it is
+ * growing out of, so the helpers below are handed the array to work on.
+ */
+
+typedef struct {
+  char *slots;
+  int numBuckets;
+} SlotTable;
+
+static SlotTable CurrentTable(const hashset *h) {
+  SlotTable t = { h->slots, h->numBuckets };
+  return t;
+}
+
+static SlotTable OldTable(const hashset *h) {
+  SlotTable t = { h->oldSlots, h->oldNumBuckets };
+  return t;
+}
+
+/**
+ * Slots are laid out as the element followed by its 32-bit probe distance
+ * and, for a set built with HashSetNewWithHash64, the element's 32-bit hash
+ * tag, padded so that consecutive elements keep the alignment their size
+ * implies (up to 16 bytes).  The stored distance is one more than the
+ * number of steps the element sits past its home slot, so that zero can
+ * mark an empty slot.
+ */
+static void ComputeSlotLayout(hashset *h) {
+  int alignment = h->elemSize & -h->elemSize;
+  if (alignment > kMaxSlotAlignment) alignment = kMaxSlotAlignment;
+  if (alignment < (int)sizeof(uint32_t)) alignment = sizeof(uint32_t);
+  h->distanceOffset = (h->elemSize + 3) & ~3;
+  h->tagOffset = h->distanceOffset + sizeof(uint32_t);
+  int bytes = h->tagOffset + (h->hash64fn != NULL ? sizeof(uint32_t) : 0);
+  h->slotSize = (bytes + alignment - 1) / alignment * alignment;
+}
+
+static char *SlotAt(const hashset *h, SlotTable t, int slot) {
+  return t.slots + (size_t)slot * h->slotSize;
+}
+
+static uint32_t *DistanceAt(const hashset *h, SlotTable t, int slot) {
+  return (uint32_t *)(SlotAt(h, t, slot) + h->distanceOffset);
+}
+
+static uint32_t *TagAt(const hashset *h, SlotTable t, int slot) {
+  return (uint32_t *)(SlotAt(h, t, slot) + h->tagOffset);
+}
+
+static int NextSlot(SlotTable t, int slot) {
+  return slot + 1 == t.numBuckets ? 0 : slot + 1;
+}
+
+/**
+ * A 64-bit hash is kept as its top 32 bits, the tag.  The tag maps onto a
+ * home slot by multiplying and keeping the high half, which needs no
+ * division and spreads the tags evenly over any slot count.  Since the home
+ * depends only on the tag, a tagged set can rehash from its stored tags.
+ */
+static uint32_t TagOf(const hashset *h, const void *elemAddr) {
+  return h->hash64fn != NULL ? (uint32_t)(h->hash64fn(elemAddr) >> 32) : 0;
+}
+
+static int TagHome(SlotTable t, uint32_t tag) {
+  return (int)(((uint64_t)tag * (uint32_t)t.numBuckets) >> 32);
+}
+
+static int HomeSlot(const hashset *h, SlotTable t, const void *elemAddr, uint32_t tag) {
+  if (h->hash64fn != NULL) return TagHome(t, tag);
+  int home = h->hashfn(elemAddr, t.numBuckets);
+  vector_assert(home < 0 || home >= t.numBuckets, "Hash code out of range.");
+  return home;
+}
+
+/**
+ * What trace records store as an element's identity: its hash over
+ * kTraceHashBuckets buckets.
+ */
+static inline int TraceHash(const hashset *h, const void *elemAddr) {
+  if (h->hash64fn != NULL) return (int)(h->hash64fn(elemAddr) % kTraceHashBuckets);
+  return h->hashfn(elemAddr, kTraceHashBuckets);
+}
+
+/**
+ * Type: ProbeStop
+ * ---------------
+ * Where a probe for an absent key ended: the slot, and the distance the key
+ * would have there.  That is exactly where Robin Hood insertion would place
+ * the key, so an enter can pick up from it rather than probing again.
+ */
+
+typedef struct {
+  int slot;
+  uint32_t distance;
+} ProbeStop;
+
+static ProbeStop HomeStop(int home) {
+  ProbeStop stop = { home, 1 };
+  return stop;
+}
+
+static void AllocateSlots(hashset *h, int numBuckets) {
+  h->slots = calloc(numBuckets, h->slotSize);
+  vector_assert(h->slots == NULL, "Couldn't allocate hashset.");
+  h->numBuckets = numBuckets;
+}
+
+/**
+ * Returns the slot of t holding an element equal to elemAddr, whose home
+ * slot is home and whose tag is tag, or -1.  Only an element that shares the
+ * key's home can sit at exactly the key's probe distance, and in a tagged
+ * set it must share the key's tag as well, so the comparator runs just for
+ * those.  The scan stops at an empty slot or at one whose element is closer
+ * to home than the key would be, since Robin Hood insertion would have
+ * placed the key before it.  If stop is not NULL it is set to where a
+ * failed scan ended.
+ */
+static int FindSlot(const hashset *h, SlotTable t, const void *elemAddr, int home, uint32_t tag,
+                    ProbeStop *stop) {
+  mybool tagged = h->hash64fn != NULL;
+  int slot = home;
+  for (uint32_t distance = 1; ; distance++) {
+    uint32_t stored = *DistanceAt(h, t, slot);
+    if (stored < distance) {
+      if (stop != NULL) {
+        stop->slot = slot;
+        stop->distance = distance;
+      }
+      return -1;
+    }
+    if (stored == distance && (!tagged || *TagAt(h, t, slot) == tag) &&
+        h->comparefn(SlotAt(h, t, slot), elemAddr) == 0) return slot;
+    slot = NextSlot(t, slot);
+  }
+}
+
+/**
+ * Places an element known not to be in t, starting the walk at from (its
+ * home, or where a failed probe for it stopped).  The entering element takes
+ * over the first slot that is empty or whose occupant sits closer to its own
+ * home, and a displaced occupant carries on the walk.  Returns the slot the
+ * entering element ended up in.
+ */
+static int InsertAbsent(hashset *h, SlotTable t, const void *elemAddr, ProbeStop from, uint32_t tag) {
+  mybool tagged = h->hash64fn != NULL;
+  char *carry = h->scratch;
+  char *swap = carry + h->elemSize;
+  memcpy(carry, elemAddr, h->elemSize);
+  int slot = from.slot, placed = -1;
+  for (uint32_t distance = from.distance; ; distance++) {
+    uint32_t *stored = DistanceAt(h, t, slot);
+    if (*stored == 0) {
+      memcpy(SlotAt(h, t, slot), carry, h->elemSize);
+      *stored = distance;
+      if (tagged) *TagAt(h, t, slot) = tag;
+      return placed >= 0 ? placed : slot;
+    }
+    if (*stored < distance) {
+      if (placed < 0) placed = slot;
+      memcpy(swap, SlotAt(h, t, slot), h->elemSize);
+      memcpy(SlotAt(h, t, slot), carry, h->elemSize);
+      memcpy(carry, swap, h->elemSize);
+      uint32_t displaced = *stored;
+      *stored = distance;
+      distance = displaced;
+      if (tagged) {
+        uint32_t displacedTag = *TagAt(h, t, slot);
+        *TagAt(h, t, slot) = tag;
+        tag = displacedTag;
+      }
+    }
+    slot = NextSlot(t, slot);
+  }
+}
+
+/**
+ * Empties a slot of t by backward shifting: each following element that sits
+ * past its home moves back one slot, a step closer to home, until an empty
+ * slot or an element already at home ends the run.  That leaves the table
+ * just as if the removed element had never been entered, with no tombstones
+ * to lengthen later probes.
+ */
+static void RemoveAt(hashset *h, SlotTable t, int slot) {
+  mybool tagged = h->hash64fn != NULL;
+  for (int next = NextSlot(t, slot); *DistanceAt(h, t, next) > 1; next = NextSlot(t, next)) {
+    memcpy(SlotAt(h, t, slot), SlotAt(h, t, next), h->elemSize);
+    *DistanceAt(h, t, slot) = *DistanceAt(h, t, next) - 1;
+    if (tagged) *TagAt(h, t, slot) = *TagAt(h, t, next);
+    slot = next;
+  }
+  *DistanceAt(h, t, slot) = 0;
+}
+
+/**
+ * Old slots below rehashCursor have already been copied into the current
+ * table, and what is left in them is stale.  Slots are never cleared as they
+ * are migrated, so probe sequences through the old table stay intact.
+ */
+static mybool IsLiveOldSlot(const hashset *h, int slot) {
+  return slot >= h->rehashCursor && *DistanceAt(h, OldTable(h), slot) != 0;
+}
+
+/**
+ * Copies up to numSlots more old slots into the current table, and releases
+ * the old table once the last one has been moved.  A tagged set places each
+ * element by its stored tag without calling back into the client.
+ */
+static void MigrateSlots(hashset *h, int numSlots) {
+  SlotTable old = OldTable(h), current = CurrentTable(h);
+  int end = h->oldNumBuckets - h->rehashCursor > numSlots ? h->rehashCursor + numSlots
+                                                          : h->oldNumBuckets;
+  for (int slot = h->rehashCursor; slot < end; slot++) {
+    if (*DistanceAt(h, old, slot) == 0) continue;
+    char *elem = SlotAt(h, old, slot);
+    uint32_t tag = h->hash64fn != NULL ? *TagAt(h, old, slot) : 0;
+    InsertAbsent(h, current, elem, HomeStop(HomeSlot(h, current, elem, tag)), tag);
+  }
+  h->rehashCursor = end;
+  if (end == h->oldNumBuckets) {
+    free(h->oldSlots);
+    h->oldSlots = NULL;
+    h->oldNumBuckets = 0;
+    h->rehashCursor = 0;
+  }
+}
+
+/**
+ * Doubles the slot count.  Every element is re-entered under the new count
+ * right away, unless incremental rehashing is on, in which case the old
+ * slots are kept and migrated a few at a time by later calls to Enter.  An
+ * unfinished migration is completed first.
+ */
+static void Grow(hashset *h) {
+  if (h->oldSlots != NULL) MigrateSlots(h, INT_MAX);
+  vector_assert(h->numBuckets > INT32_MAX / 2, "Hashset is too large to grow.");
+  h->oldSlots = h->slots;
+  h->oldNumBuckets = h->numBuckets;
+  h->rehashCursor = 0;
+  AllocateSlots(h, h->oldNumBuckets * 2);
+  MigrateSlots(h, h->rehashStep > 0 ? h->rehashStep : INT_MAX);
+}
+
+static mybool IsOverloaded(const hashset *h, int count) {
+  return count > h->numBuckets * h->maxLoadFactor;
+}
+
+/**
+ * Returns the address of the stored element equal to elemAddr, whose tag is
+ * tag, in whichever table holds it, or NULL.  If stop is not NULL and the
+ * element isn't there, stop is set to where the probe of the current table
+ * ended.
+ */
+static char *FindElement(const hashset *h, const void *elemAddr, uint32_t tag, ProbeStop *stop) {
+  if (h->oldSlots != NULL) {
+    SlotTable old = OldTable(h);
+    int slot = FindSlot(h, old, elemAddr, HomeSlot(h, old, elemAddr, tag), tag, NULL);
+    if (slot >= h->rehashCursor) return SlotAt(h, old, slot);
+  }
+  SlotTable current = CurrentTable(h);
+  int slot = FindSlot(h, current, elemAddr, HomeSlot(h, current, elemAddr, tag), tag, stop);
+  return slot >= 0 ? SlotAt(h, current, slot) : NULL;
+}
+
+/**
+ * Enters an element that FindElement has just failed to find, continuing
+ * from where its probe stopped unless the table has to grow first.  Returns
+ * the element's new address.
+ */
+static char *EnterAbsent(hashset *h, const void *elemAddr, uint32_t tag, ProbeStop stop) {
+  if (IsOverloaded(h, h->count + 1)) {
+    Grow(h);
+    stop = HomeStop(HomeSlot(h, CurrentTable(h), elemAddr, tag));
+  }
+  int slot = InsertAbsent(h, CurrentTable(h), elemAddr, stop, tag);
+  h->count++;
+  return SlotAt(h, CurrentTable(h), slot);
+}
+
+/**
+ * The construction shared by both flavours of hashset.  Exactly one of
+ * hashfn and hash64fn is set.
+ */
+static void InitHashSet(hashset *h, int elemSize, int numBuckets, HashSetHashFunction hashfn,
+                        HashSetHash64Function hash64fn, HashSetCompareFunction comparefn,
+                        HashSetFreeFunction freefn) {
+  CONTAINER_TRACE(kTraceHashSetNew, h, numBuckets, elemSize);
+  vector_assert(elemSize <= 0, "Element size must be greater than zero.");
+  vector_assert(numBuckets <= 0, "Number of buckets must be greater than zero.");
+  vector_assert((hashfn == NULL && hash64fn == NULL) || comparefn == NULL,
+                "Failed to create hashset, no hash or compare function provided.");
+  h->elemSize = elemSize;
+  h->count = 0;
+  h->hashfn = hashfn;
+  h->hash64fn = hash64fn;
+  h->comparefn = comparefn;
+  h->freefn = freefn;
+  h->maxLoadFactor = kDefaultMaxLoadFactor;
+  h->rehashStep = 0;
+  h->oldSlots = NULL;
+  h->oldNumBuckets = 0;
+  h->rehashCursor = 0;
+  ComputeSlotLayout(h);
+  AllocateSlots(h, numBuckets);
+  h->scratch = malloc(2 * (size_t)elemSize);
+  vector_assert(h->scratch == NULL, "Couldn't allocate hashset.");
+}
+
 void HashSetNew(hashset *h, int elemSize, int numBuckets,
 		HashSetHashFunction hashfn, HashSetCompareFunction comparefn, HashSetFreeFunction freefn)
-{}
+{
+  InitHashSet(h, elemSize, numBuckets, hashfn, NULL, comparefn, freefn);
+}
+
+void HashSetNewWithHash64(hashset *h, int elemSize, int numBuckets, HashSetHash64Function hashfn,
+                          HashSetCompareFunction comparefn, HashSetFreeFunction freefn)
+{
+  InitHashSet(h, elemSize, numBuckets, NULL, hashfn, comparefn, freefn);
+}
 
 void HashSetDispose(hashset *h)
-{}
+{
+  CONTAINER_TRACE(kTraceHashSetDispose, h, 0, h->elemSize);
+  if (h->freefn != NULL) {
+    for (int slot = 0; slot < h->oldNumBuckets; slot++) {
+      if (IsLiveOldSlot(h, slot)) h->freefn(SlotAt(h, OldTable(h), slot));
+    }
+    for (int slot = 0; slot < h->numBuckets; slot++) {
+      if (*DistanceAt(h, CurrentTable(h), slot) != 0) h->freefn(SlotAt(h, CurrentTable(h), slot));
+    }
+  }
+  free(h->oldSlots);
+  free(h->slots);
+  free(h->scratch);
+  h->oldSlots = NULL;
+  h->slots = NULL;
+  h->scratch = NULL;
+}
+
+void HashSetSetMaxLoadFactor(hashset *h, double maxLoadFactor)
+{
+  vector_assert(!(maxLoadFactor > 0 && maxLoadFactor < 1),
+                "Load factor must be between 0 and 1.");
+  h->maxLoadFactor = maxLoadFactor;
+  while (IsOverloaded(h, h->count)) Grow(h);
+  if (h->oldSlots != NULL) MigrateSlots(h, INT_MAX);
+}
+
+void HashSetEnableIncrementalRehash(hashset *h, int slotsPerStep)
+{
+  vector_assert(slotsPerStep <= 0, "Rehash step must be greater than zero.");
+  h->rehashStep = slotsPerStep;
+}
 
 int HashSetCount(const hashset *h)
-{ return 0; }
+{ return h->count; }
 
 void HashSetMap(hashset *h, HashSetMapFunction mapfn, void *auxData)
-{}
+{
+  vector_assert(mapfn == NULL, "Map function was not provided.");
+  for (int slot = 0; slot < h->oldNumBuckets; slot++) {
+    if (IsLiveOldSlot(h, slot)) mapfn(SlotAt(h, OldTable(h), slot), auxData);
+  }
+  for (int slot = 0; slot < h->numBuckets; slot++) {
+    if (*DistanceAt(h, CurrentTable(h), slot) != 0) mapfn(SlotAt(h, CurrentTable(h), slot), auxData);
+  }
+}
 
 void HashSetEnter(hashset *h, const void *elemAddr)
-{}
+{
+  vector_assert(elemAddr == NULL, "Element address is NULL.");
+  CONTAINER_TRACE(kTraceHashSetEnter, h, TraceHash(h, elemAddr), h->elemSize);
+  if (h->oldSlots != NULL) MigrateSlots(h, h->rehashStep);
+  uint32_t tag = TagOf(h, elemAddr);
+  ProbeStop stop;
+  char *found = FindElement(h, elemAddr, tag, &stop);
+  if (found != NULL) {
+    if (h->freefn != NULL) h->freefn(found);
+    memcpy(found, elemAddr, h->elemSize);
+    return;
+  }
+  EnterAbsent(h, elemAddr, tag, stop);
+}
+
+void *HashSetFindOrEnter(hashset *h, const void *elemAddr, mybool *inserted)
+{
+  vector_assert(elemAddr == NULL, "Element address is NULL.");
+  CONTAINER_TRACE(kTraceHashSetFindOrEnter, h, TraceHash(h, elemAddr), h->elemSize);
+  if (h->oldSlots != NULL) MigrateSlots(h, h->rehashStep);
+  uint32_t tag = TagOf(h, elemAddr);
+  ProbeStop stop;
+  char *found = FindElement(h, elemAddr, tag, &stop);
+  if (inserted != NULL) *inserted = found == NULL ? TRUE : FALSE;
+  return found != NULL ? found : EnterAbsent(h, elemAddr, tag, stop);
+}
+
+mybool HashSetRemove(hashset *h, const void *elemAddr)
+{
+  vector_assert(elemAddr == NULL, "Element address is NULL.");
+  CONTAINER_TRACE(kTraceHashSetRemove, h, TraceHash(h, elemAddr), h->elemSize);
+  uint32_t tag = TagOf(h, elemAddr);
+  char *found = FindElement(h, elemAddr, tag, NULL);
+  if (found == NULL) return FALSE;
+  if (h->oldSlots != NULL && found >= h->oldSlots &&
+      found < h->oldSlots + (size_t)h->oldNumBuckets * h->slotSize) {
+    // Shifting within the old table could pull an already migrated element
+    // back into the live range, so the element is moved across first.
+    MigrateSlots(h, INT_MAX);
+    found = FindElement(h, elemAddr, tag, NULL);
+  }
+  if (h->freefn != NULL) h->freefn(found);
+  SlotTable current = CurrentTable(h);
+  RemoveAt(h, current, (int)((found - current.slots) / h->slotSize));
+  h->count--;
+  return TRUE;
+}
 
 void *HashSetLookup(const hashset *h, const void *elemAddr)
-{ return NULL; }
+{
+  vector_assert(elemAddr == NULL, "Element address is NULL.");
+  CONTAINER_TRACE(kTraceHashSetLookup, h, TraceHash(h, elemAddr), h->elemSize);
+  return FindElement(h, elemAddr, TagOf(h, elemAddr), NULL);
+}
+
+void HashSetLookupBatch(const hashset *h, const void *keys, int numKeys, void **results)
+{
+  vector_assert(keys == NULL || results == NULL, "Element address is NULL.");
+  vector_assert(numKeys < 0, "Number of keys must not be negative.");
+  const char *key = keys;
+  if (h->oldSlots != NULL) {
+    // Mid-rehash a key may be in either table; not worth batching.
+    for (int i = 0; i < numKeys; i++, key += h->elemSize) {
+      CONTAINER_TRACE(kTraceHashSetLookup, h, TraceHash(h, key), h->elemSize);
+      results[i] = FindElement(h, key, TagOf(h, key), NULL);
+    }
+    return;
+  }
+  SlotTable t = CurrentTable(h);
+  int homes[kLookupBatchWindow];
+  uint32_t tags[kLookupBatchWindow];
+  for (int first = 0; first < numKeys; first += kLookupBatchWindow) {
+    int window = numKeys - first < kLookupBatchWindow ? numKeys - first : kLookupBatchWindow;
+    const char *windowKeys = key + (size_t)first * h->elemSize;
+    for (int i = 0; i < window; i++) {
+      const char *k = windowKeys + (size_t)i * h->elemSize;
+      CONTAINER_TRACE(kTraceHashSetLookup, h, TraceHash(h, k), h->elemSize);
+      tags[i] = TagOf(h, k);
+      homes[i] = HomeSlot(h, t, k, tags[i]);
+      __builtin_prefetch(SlotAt(h, t, homes[i]));
+    }
+    for (int i = 0; i < window; i++) {
+      const char *k = windowKeys + (size_t)i * h->elemSize;
+      int slot = FindSlot(h, t, k, homes[i], tags[i], NULL);
+      results[first + i] = slot >= 0 ? SlotAt(h, t, slot) : NULL;
+    }
+  }
+}
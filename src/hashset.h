@@ -1,10 +1,20 @@
 #ifndef _hashset_
 #define _hashset_
 #include "vector.h"
+#include <stdint.h>
 
 /* File: hashtable.h
  * ------------------
  * Defines the interface for the hashset.
+ *
+ * The hashset is a flat open-addressing table.  Elements are stored inline,
+ * each in a slot alongside its probe distance, so there are no per-bucket
+ * lists to chase: a lookup hashes to a home slot and scans forward through
+ * neighbouring slots, usually within a single cache line.  Collisions are
+ * resolved with Robin Hood displacement, where an entering element takes the
+ * slot of any element that sits closer to its own home.  This keeps probe
+ * sequences short and even, and lets an unsuccessful lookup stop as soon as
+ * it reaches an element nearer its home than the key would be.
  */
 
 /**
@@ -21,6 +31,18 @@
 
 typedef int (*HashSetHashFunction)(const void *elemAddr, int numBuckets);
 
+/**
+ * Type: HashSetHash64Function
+ * ---------------------------
+ * The hash function of a set built with HashSetNewWithHash64.  Rather than
+ * reducing to a bucket, it returns the element's full 64-bit hash code and
+ * leaves the reduction to the hashset.  The same stability requirement
+ * applies, and since the set relies on the high 32 bits, those in particular
+ * should be well mixed.
+ */
+
+typedef uint64_t (*HashSetHash64Function)(const void *elemAddr);
+
 /**
  * Type: HashSetCompareFunction
  * ----------------------------
@@ -73,7 +95,23 @@ typedef void (*HashSetFreeFunction)(void *elemAddr);
  */
 
 typedef struct {
-  // to be filled in by you
+  char *slots;            // numBuckets slots of slotSize bytes
+  int slotSize;
+  int distanceOffset;     // where a slot's probe distance follows its element
+  int elemSize;
+  int numBuckets;         // number of slots; what the hash function is passed
+  int count;
+  HashSetHashFunction hashfn;
+  HashSetHash64Function hash64fn; // set instead of hashfn by HashSetNewWithHash64
+  int tagOffset;          // where a slot's hash tag follows its distance, when hash64fn is set
+  HashSetCompareFunction comparefn;
+  HashSetFreeFunction freefn;
+  void *scratch;          // room for two elements, used when displacing
+  double maxLoadFactor;   // the table grows before count exceeds this share of numBuckets
+  int rehashStep;         // old slots migrated per Enter, or 0 to rehash all at once
+  char *oldSlots;         // the table being grown out of, during an incremental rehash
+  int oldNumBuckets;
+  int rehashCursor;       // old slots below this have been migrated
 } hashset;
 
 /**
@@ -88,10 +126,14 @@ typedef struct {
  * Binky, you would pass sizeof(Binky) as this parameter. An assert is
  * raised if this size is less than or equal to 0.
  *
- * The numBuckets parameter specifies the number of buckets that the elements
- * will be partitioned into.  Once a hashset is created, this number does
- * not change.  The numBuckets parameter must be in sync with the behavior of
- * the hashfn, which must return a hash code between 0 and numBuckets - 1.   
+ * The numBuckets parameter specifies the number of slots the table starts
+ * with.  Each slot holds at most one element, so the table doubles its slot
+ * count (and rehashes every element) whenever an entry would take it past
+ * its maximum load factor, 0.875 unless HashSetSetMaxLoadFactor says
+ * otherwise.  numBuckets is therefore only a starting size, and a good guess
+ * just saves some early doublings.  The hash function is passed whichever
+ * slot count it is hashing for and must return a hash code between 0 and
+ * that count - 1.
  * The hashfn parameter specifies the function that is called to retrieve the
  * hash code for a given element.  See the type declaration of HashSetHashFunction
  * above for more information.  An assert is raised if numBuckets is less than or
@@ -101,7 +143,8 @@ typedef struct {
  * type declaration for HashSetCompareFunction above for more information.
  *
  * The freefn is the function that will be called on an element that is
- * about to be overwritten (by a new entry in HashSetEnter) or on each element 
+ * about to be overwritten (by a new entry in HashSetEnter) or removed (by
+ * HashSetRemove), or on each element 
  * in the table when the entire table is being freed (using HashSetDispose).  This 
  * function is your chance to do any deallocation/cleanup required,
  * (such as freeing any pointers contained in the element). The client can pass 
@@ -118,6 +161,30 @@ typedef struct {
 void HashSetNew(hashset *h, int elemSize, int numBuckets, 
 		HashSetHashFunction hashfn, HashSetCompareFunction comparefn, HashSetFreeFunction freefn);
 
+/**
+ * Function: HashSetNewWithHash64
+ * Usage: HashSetNewWithHash64(&thesaurus, sizeof(thesaurusEntry), 1024,
+ *                             StringHash64, StringCompare, ThesEntryFree);
+ * ------------------------------
+ * Initializes the hashset just like HashSetNew, except that hashfn returns
+ * a full 64-bit hash code rather than a bucket number.  The set keeps the
+ * upper 32 bits of each element's hash code in its slot and derives the
+ * element's home slot from them.  That has two payoffs:
+ *
+ *   - A probe only calls comparefn on an element whose stored hash bits
+ *     match the key's, so lookups of absent keys almost never compare.
+ *   - Growing the table places every element by its stored bits and never
+ *     calls hashfn again, which matters when hashing is expensive (long
+ *     strings, say).
+ *
+ * Each element costs 4 more bytes, which often fit in padding the slot had
+ * anyway.  Every other hashset function works the same on either kind of
+ * set.  The same asserts as HashSetNew are raised.
+ */
+
+void HashSetNewWithHash64(hashset *h, int elemSize, int numBuckets, HashSetHash64Function hashfn,
+                          HashSetCompareFunction comparefn, HashSetFreeFunction freefn);
+
 /**
  * Function: HashSetDispose
  * ------------------------
@@ -136,6 +203,35 @@ void HashSetNew(hashset *h, int elemSize, int numBuckets,
 
 void HashSetDispose(hashset *h);
 
+/**
+ * Function: HashSetSetMaxLoadFactor
+ * Usage: HashSetSetMaxLoadFactor(&thesaurus, 0.5);
+ * ---------------------------------
+ * Sets the fraction of the slots that may be occupied before the table
+ * doubles.  A lower load factor keeps probe sequences shorter at the cost
+ * of memory.  If the table is already fuller than the new limit it grows
+ * right away.  An assert is raised unless maxLoadFactor lies strictly
+ * between 0 and 1.
+ */
+
+void HashSetSetMaxLoadFactor(hashset *h, double maxLoadFactor);
+
+/**
+ * Function: HashSetEnableIncrementalRehash
+ * Usage: HashSetEnableIncrementalRehash(&sessions, 64);
+ * ----------------------------------------
+ * Spreads the cost of growing the table over subsequent calls instead of
+ * paying it in the HashSetEnter that triggers it.  When the table doubles,
+ * the old slot array is kept alongside the new one, and each HashSetEnter
+ * moves the contents of the next slotsPerStep old slots across before doing
+ * its own work; lookups consult both arrays until the move is complete.  A
+ * growth that comes due before the previous one has finished completes it
+ * in one go; a slotsPerStep of at least 1 / maxLoadFactor always keeps up.
+ * An assert is raised if slotsPerStep is not positive.
+ */
+
+void HashSetEnableIncrementalRehash(hashset *h, int slotsPerStep);
+
 /**
  * Function: HashSetCount
  * ----------------------
@@ -161,6 +257,44 @@ int HashSetCount(const hashset *h);
 
 void HashSetEnter(hashset *h, const void *elemAddr);
 
+/**
+ * Function: HashSetFindOrEnter
+ * Usage: frequency *entry = HashSetFindOrEnter(&counts, &localFreq, &inserted);
+ *        if (!inserted) entry->occurrences++;
+ * ----------------------------
+ * Returns the address of the stored element matching elemAddr.  If there
+ * isn't one, the element at elemAddr is entered first and the address of
+ * the new copy is returned.  Unlike HashSetEnter, an existing match is left
+ * as it is, so the caller can update it in place.  If inserted is not NULL,
+ * it is set to TRUE when the element was entered and FALSE when it was
+ * already there.  Only one probe is made either way, where a HashSetLookup
+ * followed by a HashSetEnter makes two.  The returned address is good until
+ * the next call that enters or removes an element.
+ *
+ * The caller must not change the element in a way that alters how it hashes
+ * or compares.  The same asserts as HashSetEnter are raised.
+ */
+
+void *HashSetFindOrEnter(hashset *h, const void *elemAddr, mybool *inserted);
+
+/**
+ * Function: HashSetRemove
+ * -----------------------
+ * Removes the element matching elemAddr, first applying the free function
+ * (if any) to it, and returns TRUE; returns FALSE if there was no match.
+ * The elements after it in its probe run are shifted back a slot to close
+ * the gap, so no tombstones are left behind and lookups stay as short
+ * under a long stream of enters and removals as in a freshly built table.
+ * The table does not shrink.  If the element is still in the old table of
+ * an incremental rehash, the rest of the rehash is finished first.
+ *
+ * An assert is raised if the specified address is NULL, or
+ * if the embedded hash function somehow computes a hash code
+ * for the element that is out of the [0, numBuckets) range.
+ */
+
+mybool HashSetRemove(hashset *h, const void *elemAddr);
+
 /**
  * Function: HashSetLookup
  * -----------------------
@@ -170,7 +304,9 @@ void HashSetEnter(hashset *h, const void *elemAddr);
  * If no match is found, then NULL is returned as a sentinel.
  * Understand that the key (residing at elemAddr) only needs
  * to match a stored element as far as the hash and compare
- * functions are concerned.
+ * functions are concerned.  Entering elements moves others
+ * around, so the returned address is only good until the
+ * next call to HashSetEnter, HashSetFindOrEnter or HashSetRemove.
  *
  * An assert is raised if the specified address is NULL, or
  * if the embedded hash function somehow computes a hash code
@@ -179,6 +315,26 @@ void HashSetEnter(hashset *h, const void *elemAddr);
 
 void *HashSetLookup(const hashset *h, const void *elemAddr);
 
+/**
+ * Function: HashSetLookupBatch
+ * Usage: void *found[kNumQueries];
+ *        HashSetLookupBatch(&counts, queries, kNumQueries, found);
+ * ----------------------------
+ * Looks up numKeys keys, laid out one after another at keys like the
+ * elements of an array, and sets results[i] to what HashSetLookup would
+ * return for the ith key.  On a table too big for the cache, each
+ * HashSetLookup waits out its own cache miss before the next can start.
+ * The batch instead hashes a window of keys and prefetches all of their
+ * home slots first, then probes them, so the misses overlap.  While an
+ * incremental rehash is under way the keys are simply looked up one at a
+ * time.  Either way a trace records one HashSetLookup per key, just as for
+ * the equivalent loop of HashSetLookup calls.  The same asserts as
+ * HashSetLookup are raised, and one is raised if keys or results is NULL or
+ * numKeys is negative.
+ */
+
+void HashSetLookupBatch(const hashset *h, const void *keys, int numKeys, void **results);
+
 /**
  * Function: HashSetMap
  * --------------------
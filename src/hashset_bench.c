@@ -0,0 +1,732 @@
+#include "hashset.h"
+#include "concurrenthashset.h"
+#include "frozenhashset.h"
+#include "orderedhashset.h"
+#include "swisshashset.h"
+#include "vector.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * File: hashset_bench.c
+ * ---------------------
+ * Benchmarks the open-addressing hashset, with and without stored hash
+ * tags, against a chained baseline, the classic layout of an array of
+ * buckets where each bucket is a vector of the elements that hash to it.
+ * All are driven through the same hash and compare functions and given the
+ * same initial bucket count; the figures are nanoseconds per enter
+ * (including building the empty table), per successful lookup and per
+ * failed lookup.  A last table gives the distribution of single-enter
+ * latencies while a table grows, with and without incremental rehashing,
+ * another compares lookups against the swisshashset across load factors,
+ * another measures concurrenthashset throughput as threads are added,
+ * another compares a hashset with its frozen, perfectly hashed copy,
+ * another times batched lookups against single ones, another times a
+ * counting workload with and without FindOrEnter, another compares
+ * lookups before and after a long run of removals and enters, and the last
+ * times full maps over sparse and full tables against the orderedhashset.
+ * Naming a section runs just that one.
+ *
+ *   hashset_bench [number-of-elements
+ *                  [tables|latency|load|concurrent|frozen|batch|count|churn|map]]
+ */
+
+static const int kDefaultElements = 1 << 20;
+static const int kRepetitions = 3;
+
+typedef struct {
+  long key;
+  long payload[2];
+} record;
+
+typedef struct {
+  vector *buckets;
+  int numBuckets;
+  int count;
+  HashSetHashFunction hashfn;
+  HashSetCompareFunction comparefn;
+} chainedset;
+
+static double NowSeconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static int HashRecord(const void *elemAddr, int numBuckets) {
+  uint64_t key = (uint64_t)((const record *)elemAddr)->key;
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  return (int)(key % (uint64_t)numBuckets);
+}
+
+static uint64_t HashRecord64(const void *elemAddr) {
+  uint64_t key = (uint64_t)((const record *)elemAddr)->key;
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  return key ^ (key >> 33);
+}
+
+static int CompareRecords(const void *elemAddr1, const void *elemAddr2) {
+  long a = ((const record *)elemAddr1)->key, b = ((const record *)elemAddr2)->key;
+  return (a > b) - (a < b);
+}
+
+/**
+ * The chained baseline.  Each bucket's vector starts small and is searched
+ * linearly, exactly as a vector-of-vectors hashset would do it.
+ */
+
+static void ChainedNew(chainedset *c, int numBuckets, HashSetHashFunction hashfn,
+                       HashSetCompareFunction comparefn) {
+  c->buckets = malloc(numBuckets * sizeof(vector));
+  for (int b = 0; b < numBuckets; b++) VectorNew(&c->buckets[b], sizeof(record), NULL, 4);
+  c->numBuckets = numBuckets;
+  c->count = 0;
+  c->hashfn = hashfn;
+  c->comparefn = comparefn;
+}
+
+static void ChainedDispose(chainedset *c) {
+  for (int b = 0; b < c->numBuckets; b++) VectorDispose(&c->buckets[b]);
+  free(c->buckets);
+}
+
+static void *ChainedLookup(const chainedset *c, const void *elemAddr) {
+  vector *bucket = &c->buckets[c->hashfn(elemAddr, c->numBuckets)];
+  if (VectorLength(bucket) == 0) return NULL;
+  int found = VectorSearch(bucket, elemAddr, c->comparefn, 0, FALSE);
+  return found >= 0 ? VectorNth(bucket, found) : NULL;
+}
+
+static void ChainedEnter(chainedset *c, const void *elemAddr) {
+  vector *bucket = &c->buckets[c->hashfn(elemAddr, c->numBuckets)];
+  int found = VectorLength(bucket) > 0 ? VectorSearch(bucket, elemAddr, c->comparefn, 0, FALSE) : -1;
+  if (found >= 0) {
+    VectorReplace(bucket, elemAddr, found);
+  } else {
+    VectorAppend(bucket, elemAddr);
+    c->count++;
+  }
+}
+
+/**
+ * Keys are a random permutation-like walk so neither table sees them in
+ * hash order; misses use keys from a disjoint range.
+ */
+static long KeyAt(int i) {
+  return (long)((uint64_t)i * 0x9e3779b97f4a7c15ULL >> 1);
+}
+
+static void PrintRow(const char *name, double enter, double hit, double miss) {
+  printf("%-10s %10.1f %10.1f %10.1f\n", name, enter, hit, miss);
+}
+
+static void KeepBest(double best[3], const double t[4], int n) {
+  for (int k = 0; k < 3; k++) {
+    double nanos = (t[k + 1] - t[k]) * 1e9 / n;
+    if (nanos < best[k]) best[k] = nanos;
+  }
+}
+
+/**
+ * Function: TimeHashSet
+ * ---------------------
+ * One run against a hashset built with HashSetNew or, if tagged,
+ * HashSetNewWithHash64: enter n records, look every one of them up, then
+ * look up n keys that are absent.
+ */
+
+static void TimeHashSet(int n, int numBuckets, mybool tagged, double best[3], long *sink) {
+  hashset set;
+  record r = { 0, { 1, 2 } };
+  double t[4];
+  t[0] = NowSeconds();
+  if (tagged) {
+    HashSetNewWithHash64(&set, sizeof(record), numBuckets, HashRecord64, CompareRecords, NULL);
+  } else {
+    HashSetNew(&set, sizeof(record), numBuckets, HashRecord, CompareRecords, NULL);
+  }
+  for (int i = 0; i < n; i++) { r.key = KeyAt(i); HashSetEnter(&set, &r); }
+  t[1] = NowSeconds();
+  for (int i = 0; i < n; i++) { r.key = KeyAt(i); *sink += HashSetLookup(&set, &r) != NULL; }
+  t[2] = NowSeconds();
+  for (int i = 0; i < n; i++) { r.key = KeyAt(n + i); *sink += HashSetLookup(&set, &r) != NULL; }
+  t[3] = NowSeconds();
+  KeepBest(best, t, n);
+  HashSetDispose(&set);
+}
+
+/**
+ * Function: BenchTables
+ * ---------------------
+ * Runs the same enter, hit and miss workload against the chained baseline
+ * and both kinds of hashset, keeping the best of kRepetitions runs.
+ */
+
+static void BenchTables(int n, int numBuckets) {
+  double best[3][3] = { { 1e9, 1e9, 1e9 }, { 1e9, 1e9, 1e9 }, { 1e9, 1e9, 1e9 } };
+  long sink = 0;
+  for (int rep = 0; rep < kRepetitions; rep++) {
+    chainedset chained;
+    record r = { 0, { 1, 2 } };
+    double t[4];
+    t[0] = NowSeconds();
+    ChainedNew(&chained, numBuckets, HashRecord, CompareRecords);
+    for (int i = 0; i < n; i++) { r.key = KeyAt(i); ChainedEnter(&chained, &r); }
+    t[1] = NowSeconds();
+    for (int i = 0; i < n; i++) { r.key = KeyAt(i); sink += ChainedLookup(&chained, &r) != NULL; }
+    t[2] = NowSeconds();
+    for (int i = 0; i < n; i++) { r.key = KeyAt(n + i); sink += ChainedLookup(&chained, &r) != NULL; }
+    t[3] = NowSeconds();
+    KeepBest(best[0], t, n);
+    ChainedDispose(&chained);
+
+    TimeHashSet(n, numBuckets, FALSE, best[1], &sink);
+    TimeHashSet(n, numBuckets, TRUE, best[2], &sink);
+  }
+  if (sink != 3L * n * kRepetitions) fprintf(stderr, "lookup count mismatch\n");
+  printf("%d records of %d bytes, %d initial buckets\n", n, (int)sizeof(record), numBuckets);
+  printf("%-10s %10s %10s %10s\n", "ns/op", "enter", "hit", "miss");
+  PrintRow("chained", best[0][0], best[0][1], best[0][2]);
+  PrintRow("open", best[1][0], best[1][1], best[1][2]);
+  PrintRow("tagged", best[2][0], best[2][1], best[2][2]);
+  printf("\n");
+}
+
+typedef enum { kOpenTable, kTaggedTable, kSwissTable, kNumLookupTables } LookupTable;
+
+/**
+ * Function: TimeLookups
+ * ---------------------
+ * Fills one kind of table to numElements records without letting it grow,
+ * then returns the best time per lookup over the queries.
+ */
+
+static double TimeLookups(LookupTable kind, int numBuckets, int numElements,
+                          const long *queries, int numQueries, long *sink) {
+  hashset set;
+  swisshashset swiss;
+  if (kind == kSwissTable) {
+    SwissHashSetNew(&swiss, sizeof(record), numBuckets, HashRecord, CompareRecords, NULL);
+  } else if (kind == kTaggedTable) {
+    HashSetNewWithHash64(&set, sizeof(record), numBuckets, HashRecord64, CompareRecords, NULL);
+  } else {
+    HashSetNew(&set, sizeof(record), numBuckets, HashRecord, CompareRecords, NULL);
+  }
+  record r = { 0, { 1, 2 } };
+  for (int i = 0; i < numElements; i++) {
+    r.key = KeyAt(i);
+    if (kind == kSwissTable) SwissHashSetEnter(&swiss, &r); else HashSetEnter(&set, &r);
+  }
+  double best = 1e9;
+  for (int rep = 0; rep < kRepetitions; rep++) {
+    double start = NowSeconds();
+    if (kind == kSwissTable) {
+      for (int q = 0; q < numQueries; q++) {
+        r.key = queries[q];
+        *sink += SwissHashSetLookup(&swiss, &r) != NULL;
+      }
+    } else {
+      for (int q = 0; q < numQueries; q++) {
+        r.key = queries[q];
+        *sink += HashSetLookup(&set, &r) != NULL;
+      }
+    }
+    double nanos = (NowSeconds() - start) * 1e9 / numQueries;
+    if (nanos < best) best = nanos;
+  }
+  if (kind == kSwissTable) SwissHashSetDispose(&swiss); else HashSetDispose(&set);
+  return best;
+}
+
+/**
+ * Function: BenchLoadFactors
+ * --------------------------
+ * Compares lookups in the Robin Hood hashset, untagged and tagged, with the
+ * group-probing swisshashset, on tables of the same power-of-two slot count
+ * filled to load factors from 0.5 to 0.875.  Each load is measured with a
+ * hit-heavy query mix (90% of keys present) and a miss-heavy one (10%).
+ */
+
+static void BenchLoadFactors(int n) {
+  static const double kLoads[] = { 0.5, 0.625, 0.75, 0.875 };
+  static const double kHitFractions[] = { 0.9, 0.1 };
+  int numBuckets = 16;
+  while (numBuckets < n) numBuckets *= 2;
+  long *queries = malloc(numBuckets * sizeof(long));
+  long sink = 0;
+  printf("%d slots, ns/lookup\n", numBuckets);
+  printf("%6s %6s %10s %10s %10s\n", "load", "hits", "open", "tagged", "swiss");
+  for (size_t l = 0; l < sizeof(kLoads) / sizeof(kLoads[0]); l++) {
+    int numElements = (int)(kLoads[l] * numBuckets);
+    for (size_t m = 0; m < sizeof(kHitFractions) / sizeof(kHitFractions[0]); m++) {
+      srand(17);
+      for (int q = 0; q < numBuckets; q++) {
+        mybool hit = rand() < kHitFractions[m] * RAND_MAX;
+        queries[q] = hit ? KeyAt(rand() % numElements) : KeyAt(numBuckets + rand() % numBuckets);
+      }
+      double nanos[kNumLookupTables];
+      for (int kind = 0; kind < kNumLookupTables; kind++) {
+        nanos[kind] = TimeLookups(kind, numBuckets, numElements, queries, numBuckets, &sink);
+      }
+      printf("%6.3f %5.0f%% %10.1f %10.1f %10.1f\n", kLoads[l], kHitFractions[m] * 100,
+             nanos[kOpenTable], nanos[kTaggedTable], nanos[kSwissTable]);
+    }
+  }
+  printf("%s\n", sink == 1 ? " " : "");
+  free(queries);
+}
+
+/**
+ * Type: ConcurrentWorker
+ * ----------------------
+ * One thread of the concurrent benchmark: the shared set, the seed of the
+ * thread's own random key sequence and how many operations to run.
+ */
+
+typedef struct {
+  concurrenthashset *set;
+  uint64_t seed;
+  int numKeys;
+  int numOps;
+  long hits;
+} ConcurrentWorker;
+
+static void *RunConcurrentWorker(void *workerAddr) {
+  ConcurrentWorker *worker = workerAddr;
+  record r = { 0, { 1, 2 } };
+  uint64_t state = worker->seed;
+  for (int op = 0; op < worker->numOps; op++) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    r.key = KeyAt((int)((state >> 33) % (uint64_t)worker->numKeys));
+    if ((state >> 20) % 10 == 0) {
+      ConcurrentHashSetEnter(worker->set, &r);
+    } else {
+      worker->hits += ConcurrentHashSetLookup(worker->set, &r, NULL);
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Function: BenchConcurrent
+ * -------------------------
+ * Runs a 90% lookup, 10% enter mix against one concurrenthashset from 1, 2,
+ * 4 and 8 threads, every thread doing the same number of operations on
+ * random keys from the whole key space, and reports the combined throughput.  The set starts
+ * with half the keys present.
+ */
+
+static void BenchConcurrent(int n) {
+  static const int kThreadCounts[] = { 1, 2, 4, 8 };
+  const int kOpsPerThread = 1 << 20;
+  printf("%-8s %12s\n", "threads", "Mops/s");
+  for (size_t c = 0; c < sizeof(kThreadCounts) / sizeof(kThreadCounts[0]); c++) {
+    int numThreads = kThreadCounts[c];
+    concurrenthashset set;
+    ConcurrentHashSetNew(&set, sizeof(record), n, 64, HashRecord64, CompareRecords, NULL);
+    record r = { 0, { 1, 2 } };
+    for (int i = 0; i < n; i += 2) { r.key = KeyAt(i); ConcurrentHashSetEnter(&set, &r); }
+    ConcurrentWorker workers[8];
+    pthread_t threads[8];
+    double start = NowSeconds();
+    for (int t = 0; t < numThreads; t++) {
+      ConcurrentWorker worker = { &set, (uint64_t)t * 2654435761u + 1, n, kOpsPerThread, 0 };
+      workers[t] = worker;
+      pthread_create(&threads[t], NULL, RunConcurrentWorker, &workers[t]);
+    }
+    for (int t = 0; t < numThreads; t++) pthread_join(threads[t], NULL);
+    double elapsed = NowSeconds() - start;
+    printf("%-8d %12.2f\n", numThreads, (double)numThreads * kOpsPerThread / elapsed / 1e6);
+    ConcurrentHashSetDispose(&set);
+  }
+  printf("\n");
+}
+
+/**
+ * Function: BenchFrozen
+ * ---------------------
+ * Builds a tagged hashset of n records, times hits and misses against it,
+ * freezes it and times the same lookups against the frozenhashset, and
+ * compares the memory each takes.
+ */
+
+static void BenchFrozen(int n) {
+  hashset set;
+  HashSetNewWithHash64(&set, sizeof(record), n, HashRecord64, CompareRecords, NULL);
+  record r = { 0, { 1, 2 } };
+  for (int i = 0; i < n; i++) { r.key = KeyAt(i); HashSetEnter(&set, &r); }
+  size_t setBytes = (size_t)set.numBuckets * set.slotSize;
+  double best[2][2] = { { 1e9, 1e9 }, { 1e9, 1e9 } };
+  long sink = 0;
+  for (int rep = 0; rep < kRepetitions; rep++) {
+    double t[3];
+    t[0] = NowSeconds();
+    for (int i = 0; i < n; i++) { r.key = KeyAt(i); sink += HashSetLookup(&set, &r) != NULL; }
+    t[1] = NowSeconds();
+    for (int i = 0; i < n; i++) { r.key = KeyAt(n + i); sink += HashSetLookup(&set, &r) != NULL; }
+    t[2] = NowSeconds();
+    for (int k = 0; k < 2; k++) {
+      double nanos = (t[k + 1] - t[k]) * 1e9 / n;
+      if (nanos < best[0][k]) best[0][k] = nanos;
+    }
+  }
+  frozenhashset frozen;
+  double freezeStart = NowSeconds();
+  HashSetFreeze(&set, &frozen);
+  double freezeNanos = (NowSeconds() - freezeStart) * 1e9 / n;
+  for (int rep = 0; rep < kRepetitions; rep++) {
+    double t[3];
+    t[0] = NowSeconds();
+    for (int i = 0; i < n; i++) { r.key = KeyAt(i); sink += FrozenHashSetLookup(&frozen, &r) != NULL; }
+    t[1] = NowSeconds();
+    for (int i = 0; i < n; i++) { r.key = KeyAt(n + i); sink += FrozenHashSetLookup(&frozen, &r) != NULL; }
+    t[2] = NowSeconds();
+    for (int k = 0; k < 2; k++) {
+      double nanos = (t[k + 1] - t[k]) * 1e9 / n;
+      if (nanos < best[1][k]) best[1][k] = nanos;
+    }
+  }
+  if (sink != 2L * n * kRepetitions) fprintf(stderr, "lookup count mismatch\n");
+  printf("frozen: %d records, freezing took %.0f ns per record\n", n, freezeNanos);
+  printf("%-10s %10s %10s %12s\n", "ns/op", "hit", "miss", "bytes");
+  printf("%-10s %10.1f %10.1f %12zu\n", "tagged", best[0][0], best[0][1], setBytes);
+  printf("%-10s %10.1f %10.1f %12zu\n", "frozen", best[1][0], best[1][1],
+         FrozenHashSetBytesUsed(&frozen));
+  printf("\n");
+  FrozenHashSetDispose(&frozen);
+}
+
+/**
+ * Function: BenchLookupBatch
+ * --------------------------
+ * Times random lookups into a hashset of n records one HashSetLookup at a
+ * time and kQueriesPerBatch at a time through HashSetLookupBatch, for an
+ * all-hit and an all-miss query stream.  The prefetching only pays off once
+ * the table is bigger than the last-level cache.
+ */
+
+static void BenchLookupBatch(int n) {
+  enum { kQueriesPerBatch = 256 };
+  hashset set;
+  HashSetNew(&set, sizeof(record), n, HashRecord, CompareRecords, NULL);
+  record *queries = malloc((size_t)n * sizeof(record));
+  void *results[kQueriesPerBatch];
+  for (int i = 0; i < n; i++) {
+    record r = { KeyAt(i), { 1, 2 } };
+    HashSetEnter(&set, &r);
+  }
+  printf("batched lookups: %d records, %zu MB of slots\n", n,
+         (size_t)set.numBuckets * set.slotSize >> 20);
+  printf("%-10s %10s %10s\n", "ns/lookup", "single", "batched");
+  long sink = 0;
+  for (int hits = 1; hits >= 0; hits--) {
+    srand(23);
+    for (int i = 0; i < n; i++) {
+      record r = { KeyAt(hits ? rand() % n : n + rand() % n), { 0, 0 } };
+      queries[i] = r;
+    }
+    int numQueries = n / kQueriesPerBatch * kQueriesPerBatch;
+    double best[2] = { 1e9, 1e9 };
+    for (int rep = 0; rep < kRepetitions; rep++) {
+      double start = NowSeconds();
+      for (int q = 0; q < numQueries; q++) sink += HashSetLookup(&set, &queries[q]) != NULL;
+      double middle = NowSeconds();
+      for (int q = 0; q < numQueries; q += kQueriesPerBatch) {
+        HashSetLookupBatch(&set, &queries[q], kQueriesPerBatch, results);
+        for (int i = 0; i < kQueriesPerBatch; i++) sink += results[i] != NULL;
+      }
+      double end = NowSeconds();
+      if ((middle - start) * 1e9 / numQueries < best[0]) best[0] = (middle - start) * 1e9 / numQueries;
+      if ((end - middle) * 1e9 / numQueries < best[1]) best[1] = (end - middle) * 1e9 / numQueries;
+    }
+    printf("%-10s %10.1f %10.1f\n", hits ? "hits" : "misses", best[0], best[1]);
+  }
+  printf("%s\n", sink == 1 ? " " : "");
+  free(queries);
+  HashSetDispose(&set);
+}
+
+/**
+ * Function: BenchCounting
+ * -----------------------
+ * Counts n random keys drawn from n / 8 distinct ones, the way
+ * BuildTableOfLetterCounts counts letters: as a lookup followed by an
+ * enter of the updated count, and as one FindOrEnter and an increment in
+ * place.  Each run starts from an empty table, so growth is included.
+ */
+
+static void BenchCounting(int n) {
+  int distinct = n / 8 + 1;
+  long *keys = malloc((size_t)n * sizeof(long));
+  srand(29);
+  for (int i = 0; i < n; i++) keys[i] = KeyAt(rand() % distinct);
+  printf("counting: %d keys, %d distinct\n", n, distinct);
+  printf("%-10s %14s %14s\n", "ns/key", "lookup+enter", "find-or-enter");
+  long sink = 0;
+  for (int swiss = 0; swiss <= 1; swiss++) {
+    double best[2] = { 1e9, 1e9 };
+    for (int rep = 0; rep < kRepetitions; rep++) {
+      for (int upsert = 0; upsert <= 1; upsert++) {
+        hashset open;
+        swisshashset sw;
+        double start = NowSeconds();
+        if (swiss) SwissHashSetNew(&sw, sizeof(record), 16, HashRecord, CompareRecords, NULL);
+        else HashSetNew(&open, sizeof(record), 16, HashRecord, CompareRecords, NULL);
+        for (int i = 0; i < n; i++) {
+          record r = { keys[i], { 1, 0 } };
+          mybool inserted;
+          if (upsert) {
+            record *entry = swiss ? SwissHashSetFindOrEnter(&sw, &r, &inserted)
+                                  : HashSetFindOrEnter(&open, &r, &inserted);
+            if (!inserted) entry->payload[0]++;
+          } else {
+            const record *found = swiss ? SwissHashSetLookup(&sw, &r) : HashSetLookup(&open, &r);
+            if (found != NULL) r.payload[0] = found->payload[0] + 1;
+            if (swiss) SwissHashSetEnter(&sw, &r);
+            else HashSetEnter(&open, &r);
+          }
+        }
+        double ns = (NowSeconds() - start) * 1e9 / n;
+        if (ns < best[upsert]) best[upsert] = ns;
+        if (swiss) {
+          sink += SwissHashSetCount(&sw);
+          SwissHashSetDispose(&sw);
+        } else {
+          sink += HashSetCount(&open);
+          HashSetDispose(&open);
+        }
+      }
+    }
+    printf("%-10s %14.1f %14.1f\n", swiss ? "swiss" : "open", best[0], best[1]);
+  }
+  printf("%s\n", sink == 1 ? " " : "");
+  free(keys);
+}
+
+/**
+ * Function: TimeChurnLookups
+ * --------------------------
+ * Returns the best nanoseconds per lookup, over kRepetitions runs, of the
+ * n keys starting at KeyAt(first), in the open hashset or the swisshashset.
+ */
+
+static double TimeChurnLookups(const hashset *open, const swisshashset *swiss, int first, int n,
+                               long *sink) {
+  double best = 1e9;
+  for (int rep = 0; rep < kRepetitions; rep++) {
+    double start = NowSeconds();
+    for (int i = 0; i < n; i++) {
+      record r = { KeyAt(first + i), { 0, 0 } };
+      *sink += (open != NULL ? HashSetLookup(open, &r) : SwissHashSetLookup(swiss, &r)) != NULL;
+    }
+    double ns = (NowSeconds() - start) * 1e9 / n;
+    if (ns < best) best = ns;
+  }
+  return best;
+}
+
+/**
+ * Function: BenchChurn
+ * --------------------
+ * Fills a table with n keys, then slides the window of live keys along by
+ * kChurnRounds * n: each step removes the oldest key and enters a new one.
+ * Lookups, hits and misses, are timed before and after, to show whether
+ * removals leave the probes any longer.  The open hashset shifts elements
+ * back on removal, while the swisshashset may leave tombstones.
+ */
+
+static void BenchChurn(int n) {
+  enum { kChurnRounds = 4 };
+  printf("churn: %d live keys, %d removals and enters\n", n, kChurnRounds * n);
+  printf("%-10s %10s %10s %14s %12s %12s\n", "ns", "fresh hit", "fresh miss", "remove+enter",
+         "churned hit", "churned miss");
+  long sink = 0;
+  for (int swiss = 0; swiss <= 1; swiss++) {
+    hashset open;
+    swisshashset sw;
+    hashset *o = swiss ? NULL : &open;
+    if (swiss) SwissHashSetNew(&sw, sizeof(record), n, HashRecord, CompareRecords, NULL);
+    else HashSetNew(&open, sizeof(record), n, HashRecord, CompareRecords, NULL);
+    for (int i = 0; i < n; i++) {
+      record r = { KeyAt(i), { 1, 2 } };
+      if (swiss) SwissHashSetEnter(&sw, &r);
+      else HashSetEnter(&open, &r);
+    }
+    int last = kChurnRounds * n;
+    double freshHit = TimeChurnLookups(o, &sw, 0, n, &sink);
+    double freshMiss = TimeChurnLookups(o, &sw, last + n, n, &sink);
+    double start = NowSeconds();
+    for (int i = 0; i < last; i++) {
+      record oldest = { KeyAt(i), { 0, 0 } }, r = { KeyAt(n + i), { 1, 2 } };
+      if (swiss) {
+        SwissHashSetRemove(&sw, &oldest);
+        SwissHashSetEnter(&sw, &r);
+      } else {
+        HashSetRemove(&open, &oldest);
+        HashSetEnter(&open, &r);
+      }
+    }
+    double churn = (NowSeconds() - start) * 1e9 / last;
+    double churnedHit = TimeChurnLookups(o, &sw, last, n, &sink);
+    double churnedMiss = TimeChurnLookups(o, &sw, last + n, n, &sink);
+    printf("%-10s %10.1f %10.1f %14.1f %12.1f %12.1f\n", swiss ? "swiss" : "open",
+           freshHit, freshMiss, churn, churnedHit, churnedMiss);
+    if (swiss) SwissHashSetDispose(&sw);
+    else HashSetDispose(&open);
+  }
+  printf("%s\n", sink == 1 ? " " : "");
+}
+
+static void SumKeys(void *elemAddr, void *auxData) {
+  *(long *)auxData += ((const record *)elemAddr)->key;
+}
+
+/**
+ * Function: BenchOrderedMap
+ * -------------------------
+ * Creates an open hashset, a swisshashset and an orderedhashset with n
+ * buckets each, fills them with n / 64, n / 8 and 7n / 8 records, and times
+ * a full map over each (per live element) and successful lookups.  The
+ * open and swiss maps walk every slot, empty or not; the ordered one scans
+ * just its live elements.
+ */
+
+static void BenchOrderedMap(int n) {
+  printf("map: %d buckets\n", n);
+  printf("%-8s %8s %8s %8s %11s %11s %11s\n", "live", "open", "swiss", "ordered",
+         "open hit", "swiss hit", "ordered hit");
+  long sink = 0;
+  int fills[] = { n / 64 + 1, n / 8 + 1, n - n / 8 };
+  for (int f = 0; f < (int)(sizeof(fills) / sizeof(fills[0])); f++) {
+    int live = fills[f];
+    hashset open;
+    swisshashset swiss;
+    orderedhashset ordered;
+    HashSetNew(&open, sizeof(record), n, HashRecord, CompareRecords, NULL);
+    SwissHashSetNew(&swiss, sizeof(record), n, HashRecord, CompareRecords, NULL);
+    OrderedHashSetNew(&ordered, sizeof(record), n, HashRecord, CompareRecords, NULL);
+    for (int i = 0; i < live; i++) {
+      record r = { KeyAt(i), { 1, 2 } };
+      HashSetEnter(&open, &r);
+      SwissHashSetEnter(&swiss, &r);
+      OrderedHashSetEnter(&ordered, &r);
+    }
+    double map[3] = { 1e9, 1e9, 1e9 }, hit[3] = { 1e9, 1e9, 1e9 };
+    for (int rep = 0; rep < kRepetitions; rep++) {
+      for (int kind = 0; kind < 3; kind++) {
+        double start = NowSeconds();
+        if (kind == 0) HashSetMap(&open, SumKeys, &sink);
+        else if (kind == 1) SwissHashSetMap(&swiss, SumKeys, &sink);
+        else OrderedHashSetMap(&ordered, SumKeys, &sink);
+        double middle = NowSeconds();
+        for (int i = 0; i < live; i++) {
+          record r = { KeyAt(i), { 0, 0 } };
+          const void *found = kind == 0 ? HashSetLookup(&open, &r)
+                            : kind == 1 ? SwissHashSetLookup(&swiss, &r)
+                                        : OrderedHashSetLookup(&ordered, &r);
+          sink += found != NULL;
+        }
+        double end = NowSeconds();
+        if ((middle - start) * 1e9 / live < map[kind]) map[kind] = (middle - start) * 1e9 / live;
+        if ((end - middle) * 1e9 / live < hit[kind]) hit[kind] = (end - middle) * 1e9 / live;
+      }
+    }
+    printf("%-8d %8.1f %8.1f %8.1f %11.1f %11.1f %11.1f\n", live, map[0], map[1], map[2],
+           hit[0], hit[1], hit[2]);
+    HashSetDispose(&open);
+    SwissHashSetDispose(&swiss);
+    OrderedHashSetDispose(&ordered);
+  }
+  printf("%s\n", sink == 1 ? " " : "");
+}
+
+static int CompareDoubles(const void *elemAddr1, const void *elemAddr2) {
+  double a = *(const double *)elemAddr1, b = *(const double *)elemAddr2;
+  return (a > b) - (a < b);
+}
+
+/**
+ * Function: BenchEnterLatency
+ * ---------------------------
+ * Grows a hashset from a handful of slots to n elements, timing each enter
+ * on its own, once with every doubling done in a single rehash and once
+ * with incremental rehashing.  The mean barely moves; the tail is what the
+ * incremental mode is for.
+ */
+
+static void BenchEnterLatency(int n, int slotsPerStep) {
+  double *nanos = malloc(n * sizeof(double));
+  printf("%-12s %8s %8s %8s %10s %10s\n", "ns/enter", "mean", "p99", "p99.9", "p99.99", "max");
+  for (int incremental = 0; incremental <= 1; incremental++) {
+    hashset set;
+    HashSetNew(&set, sizeof(record), 16, HashRecord, CompareRecords, NULL);
+    if (incremental) HashSetEnableIncrementalRehash(&set, slotsPerStep);
+    record r = { 0, { 1, 2 } };
+    double total = 0;
+    for (int i = 0; i < n; i++) {
+      r.key = KeyAt(i);
+      double start = NowSeconds();
+      HashSetEnter(&set, &r);
+      nanos[i] = (NowSeconds() - start) * 1e9;
+      total += nanos[i];
+    }
+    HashSetDispose(&set);
+    qsort(nanos, n, sizeof(double), CompareDoubles);
+    printf("%-12s %8.1f %8.0f %8.0f %10.0f %10.0f\n", incremental ? "incremental" : "all at once",
+           total / n, nanos[(int)(n * 0.99)], nanos[(int)(n * 0.999)], nanos[(int)(n * 0.9999)],
+           nanos[n - 1]);
+  }
+  printf("\n");
+  free(nanos);
+}
+
+static void BenchAllTables(int n) {
+  BenchTables(n, n);        // sized for the data up front
+  BenchTables(n, n / 8 + 1); // undersized, so chains grow long and the open table doubles
+}
+
+static void BenchIncrementalLatency(int n) {
+  BenchEnterLatency(n, 16);
+}
+
+typedef struct {
+  const char *name;
+  void (*bench)(int n);
+} BenchSection;
+
+static const BenchSection kSections[] = {
+  { "tables", BenchAllTables },
+  { "latency", BenchIncrementalLatency },
+  { "load", BenchLoadFactors },
+  { "concurrent", BenchConcurrent },
+  { "frozen", BenchFrozen },
+  { "batch", BenchLookupBatch },
+  { "count", BenchCounting },
+  { "churn", BenchChurn },
+  { "map", BenchOrderedMap },
+};
+
+int main(int argc, char **argv) {
+  int n = argc > 1 ? atoi(argv[1]) : kDefaultElements;
+  const char *only = argc > 2 ? argv[2] : NULL;
+  int numSections = sizeof(kSections) / sizeof(kSections[0]), ran = 0;
+  for (int i = 0; i < numSections && n > 0; i++) {
+    if (only != NULL && strcmp(only, kSections[i].name) != 0) continue;
+    kSections[i].bench(n);
+    ran++;
+  }
+  if (ran == 0) {
+    fprintf(stderr, "usage: %s [number-of-elements [section]]\nsections:", argv[0]);
+    for (int i = 0; i < numSections; i++) fprintf(stderr, " %s", kSections[i].name);
+    fprintf(stderr, "\n");
+    return EXIT_FAILURE;
+  }
+  return 0;
+}
@@ -6,6 +6,7 @@
 #include <assert.h>
 
 const int kNumBuckets = 26;
+const int kNumTopLetters = 5;
 
 struct frequency {
     char ch;		// a particular letter
@@ -91,6 +92,7 @@ static int CompareOccurrences(const void *elem1, const void *elem2)
 static void BuildTableOfLetterCounts(hashset *counts)
 {
   struct frequency localFreq, *found;
+  mybool inserted;
   int ch;
   FILE *fp = fopen("hashsettest.c", "r"); // open self as file
   
@@ -100,11 +102,10 @@ static void BuildTableOfLetterCounts(hashset *counts)
       localFreq.ch = tolower(ch);
       localFreq.occurrences = 1;
       
-      // See if we already have an entry for this char		
-      found = (struct frequency *) HashSetLookup(counts, &localFreq);	
-      if (found != NULL) 		// increment if already there 
-	localFreq.occurrences = found->occurrences + 1;
-      HashSetEnter(counts, &localFreq); // enter should overwrite if needed
+      // Enters a count of 1 for a new char, or finds the existing entry
+      found = (struct frequency *) HashSetFindOrEnter(counts, &localFreq, &inserted);
+      if (!inserted)		// increment in place if already there
+	found->occurrences++;
     }
   }
   
@@ -124,6 +125,23 @@ static void AddFrequency(void *elem, void *v)
   VectorAppend((vector *) v, elem);
 }
 
+/**
+ * Function: PrintMostFrequent
+ * ---------------------------
+ * Prints the numTop most frequent letters.  Only the leading numTop entries
+ * need to be in order, so VectorPartialSort does the ranking in O(n log k)
+ * rather than sorting every frequency with VectorSort.
+ */
+
+static void PrintMostFrequent(vector *counts, int numTop)
+{
+  if (numTop > VectorLength(counts)) numTop = VectorLength(counts);
+  VectorPartialSort(counts, numTop, CompareOccurrences);
+  fprintf(stdout, "\nHere are the %d most frequent letters: \n", numTop);
+  for (int i = 0; i < numTop; i++)
+    PrintFrequency(VectorNth(counts, i), stdout);
+}
+
 /**
  * Function: TestHashTable
  * -----------------------
@@ -154,6 +172,8 @@ static void TestHashTable(void)
   VectorSort(&sortedCounts, CompareLetter);      // sort by char
   fprintf(stdout, "\nHere are the trials sorted by char: \n");
   VectorMap(&sortedCounts, PrintFrequency, stdout);
+
+  PrintMostFrequent(&sortedCounts, kNumTopLetters); // rank only the top few
   
   VectorSort(&sortedCounts, CompareOccurrences); //sort by occurrences
   fprintf(stdout, "\nHere are the trials sorted by occurrence & char: \n");
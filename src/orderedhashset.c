@@ -0,0 +1,261 @@
+#include "orderedhashset.h"
+#include "vector_error.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const double kMaxLoadFactor = 0.875;
+static const uint64_t kMixMultiplier = 0x9e3779b97f4a7c15ULL;
+
+/**
+ * Type: OrderedHashSetSlot
+ * ------------------------
+ * One slot of the index.  The stored distance is one more than the number of
+ * steps the slot sits past its home, so that zero can mark an empty slot.
+ * The home depends only on the tag, so the index can be rebuilt from the
+ * slots alone without calling back into the client.
+ */
+
+typedef struct {
+  uint32_t position;      // of the element in elems
+  uint32_t distance;
+  uint32_t tag;           // the top 32 bits of the mixed hash code
+} OrderedHashSetSlot;
+
+/**
+ * Type: ProbeStop
+ * ---------------
+ * Where a probe for an absent key ended: the slot, and the distance the key
+ * would have there, which is where Robin Hood insertion would place it.
+ */
+
+typedef struct {
+  int slot;
+  uint32_t distance;
+} ProbeStop;
+
+static OrderedHashSetSlot *SlotAt(const orderedhashset *h, int slot) {
+  return (OrderedHashSetSlot *)h->slots + slot;
+}
+
+static int NextSlot(const orderedhashset *h, int slot) {
+  return slot + 1 == h->numBuckets ? 0 : slot + 1;
+}
+
+static uint32_t TagOf(const orderedhashset *h, const void *elemAddr) {
+  int code = h->hashfn(elemAddr, kOrderedHashRange);
+  vector_assert(code < 0 || code >= kOrderedHashRange, "Hash code out of range.");
+  return (uint32_t)(((uint64_t)code * kMixMultiplier) >> 32);
+}
+
+static ProbeStop HomeStop(const orderedhashset *h, uint32_t tag) {
+  ProbeStop stop = { (int)(((uint64_t)tag * (uint32_t)h->numBuckets) >> 32), 1 };
+  return stop;
+}
+
+static void *ElemAt(const orderedhashset *h, uint32_t position) {
+  return VectorNth(&h->elems, position);
+}
+
+/**
+ * Returns the index slot of the element equal to elemAddr, whose tag is tag,
+ * or -1, in which case stop (if not NULL) is set to where the probe ended.
+ * As in the hashset, only a slot at exactly the key's distance with the
+ * key's tag can hold it, and a slot closer to its home ends the search.
+ */
+static int FindSlot(const orderedhashset *h, const void *elemAddr, uint32_t tag, ProbeStop *stop) {
+  ProbeStop probe = HomeStop(h, tag);
+  for (;; probe.distance++) {
+    const OrderedHashSetSlot *s = SlotAt(h, probe.slot);
+    if (s->distance < probe.distance) {
+      if (stop != NULL) *stop = probe;
+      return -1;
+    }
+    if (s->distance == probe.distance && s->tag == tag &&
+        h->comparefn(ElemAt(h, s->position), elemAddr) == 0) return probe.slot;
+    probe.slot = NextSlot(h, probe.slot);
+  }
+}
+
+/**
+ * Places an index slot for an element known not to be in the index,
+ * starting at from and displacing any slot that sits closer to its home.
+ */
+static void InsertSlot(orderedhashset *h, OrderedHashSetSlot entering, ProbeStop from) {
+  int slot = from.slot;
+  for (entering.distance = from.distance; ; entering.distance++) {
+    OrderedHashSetSlot *s = SlotAt(h, slot);
+    if (s->distance == 0) {
+      *s = entering;
+      return;
+    }
+    if (s->distance < entering.distance) {
+      OrderedHashSetSlot displaced = *s;
+      *s = entering;
+      entering = displaced;
+    }
+    slot = NextSlot(h, slot);
+  }
+}
+
+/**
+ * Empties an index slot by shifting the rest of its run back a slot, as
+ * HashSetRemove does.
+ */
+static void RemoveSlot(orderedhashset *h, int slot) {
+  for (int next = NextSlot(h, slot); SlotAt(h, next)->distance > 1; next = NextSlot(h, next)) {
+    *SlotAt(h, slot) = *SlotAt(h, next);
+    SlotAt(h, slot)->distance--;
+    slot = next;
+  }
+  SlotAt(h, slot)->distance = 0;
+}
+
+static void AllocateSlots(orderedhashset *h, int numBuckets) {
+  h->slots = calloc(numBuckets, sizeof(OrderedHashSetSlot));
+  vector_assert(h->slots == NULL, "Couldn't allocate hashset.");
+  h->numBuckets = numBuckets;
+}
+
+static mybool IsOverloaded(const orderedhashset *h, int count) {
+  return count > h->numBuckets * kMaxLoadFactor;
+}
+
+/**
+ * Doubles the index and re-places every slot by its stored tag.  The
+ * elements themselves stay where they are.
+ */
+static void Grow(orderedhashset *h) {
+  OrderedHashSetSlot *oldSlots = h->slots;
+  int oldBuckets = h->numBuckets;
+  vector_assert(oldBuckets > INT32_MAX / 2, "Hashset is too large to grow.");
+  AllocateSlots(h, oldBuckets * 2);
+  for (int slot = 0; slot < oldBuckets; slot++) {
+    if (oldSlots[slot].distance != 0) InsertSlot(h, oldSlots[slot], HomeStop(h, oldSlots[slot].tag));
+  }
+  free(oldSlots);
+}
+
+/**
+ * Squeezes the tombstones out of the vector and points every index slot at
+ * its element's new position.
+ */
+static void Compact(orderedhashset *h) {
+  int length = VectorLength(&h->elems);
+  uint32_t *moved = malloc((length > 0 ? length : 1) * sizeof(uint32_t));
+  vector_assert(moved == NULL, "Couldn't allocate hashset.");
+  uint32_t kept = 0;
+  for (int i = 0; i < length; i++) {
+    moved[i] = kept;
+    if (!VectorIsDeleted(&h->elems, i)) kept++;
+  }
+  for (int slot = 0; slot < h->numBuckets; slot++) {
+    OrderedHashSetSlot *s = SlotAt(h, slot);
+    if (s->distance != 0) s->position = moved[s->position];
+  }
+  free(moved);
+  VectorCompact(&h->elems);
+}
+
+/**
+ * Enters an element that FindSlot has just failed to find, continuing from
+ * where its probe stopped unless the index has to grow first.  Returns the
+ * element's address.
+ */
+static void *EnterAbsent(orderedhashset *h, const void *elemAddr, uint32_t tag, ProbeStop stop) {
+  if (IsOverloaded(h, h->count + 1)) {
+    Grow(h);
+    stop = HomeStop(h, tag);
+  }
+  OrderedHashSetSlot entering = { (uint32_t)VectorLength(&h->elems), 0, tag };
+  VectorAppend(&h->elems, elemAddr);
+  InsertSlot(h, entering, stop);
+  h->count++;
+  return ElemAt(h, entering.position);
+}
+
+void OrderedHashSetNew(orderedhashset *h, int elemSize, int numBuckets,
+                       HashSetHashFunction hashfn, HashSetCompareFunction comparefn,
+                       HashSetFreeFunction freefn)
+{
+  vector_assert(elemSize <= 0, "Element size must be greater than zero.");
+  vector_assert(numBuckets <= 0, "Number of buckets must be greater than zero.");
+  vector_assert(hashfn == NULL || comparefn == NULL,
+                "Failed to create hashset, no hash or compare function provided.");
+  h->count = 0;
+  h->hashfn = hashfn;
+  h->comparefn = comparefn;
+  h->freefn = freefn;
+  // The set applies freefn itself, when an element is removed or replaced,
+  // so the vector never frees anything.
+  VectorNewUntraced(&h->elems, elemSize, NULL, numBuckets);
+  VectorEnableTombstones(&h->elems, 0);
+  AllocateSlots(h, numBuckets);
+}
+
+void OrderedHashSetDispose(orderedhashset *h)
+{
+  if (h->freefn != NULL) {
+    for (int i = 0; i < VectorLength(&h->elems); i++) {
+      if (!VectorIsDeleted(&h->elems, i)) h->freefn(ElemAt(h, i));
+    }
+  }
+  VectorDispose(&h->elems);
+  free(h->slots);
+  h->slots = NULL;
+}
+
+int OrderedHashSetCount(const orderedhashset *h)
+{ return h->count; }
+
+void OrderedHashSetEnter(orderedhashset *h, const void *elemAddr)
+{
+  vector_assert(elemAddr == NULL, "Element address is NULL.");
+  uint32_t tag = TagOf(h, elemAddr);
+  ProbeStop stop;
+  int slot = FindSlot(h, elemAddr, tag, &stop);
+  if (slot >= 0) {
+    uint32_t position = SlotAt(h, slot)->position;
+    if (h->freefn != NULL) h->freefn(ElemAt(h, position));
+    VectorReplace(&h->elems, elemAddr, position);
+    return;
+  }
+  EnterAbsent(h, elemAddr, tag, stop);
+}
+
+void *OrderedHashSetFindOrEnter(orderedhashset *h, const void *elemAddr, mybool *inserted)
+{
+  vector_assert(elemAddr == NULL, "Element address is NULL.");
+  uint32_t tag = TagOf(h, elemAddr);
+  ProbeStop stop;
+  int slot = FindSlot(h, elemAddr, tag, &stop);
+  if (inserted != NULL) *inserted = slot < 0 ? TRUE : FALSE;
+  return slot >= 0 ? ElemAt(h, SlotAt(h, slot)->position) : EnterAbsent(h, elemAddr, tag, stop);
+}
+
+mybool OrderedHashSetRemove(orderedhashset *h, const void *elemAddr)
+{
+  vector_assert(elemAddr == NULL, "Element address is NULL.");
+  int slot = FindSlot(h, elemAddr, TagOf(h, elemAddr), NULL);
+  if (slot < 0) return FALSE;
+  uint32_t position = SlotAt(h, slot)->position;
+  if (h->freefn != NULL) h->freefn(ElemAt(h, position));
+  VectorMarkDeleted(&h->elems, position);
+  RemoveSlot(h, slot);
+  h->count--;
+  if (VectorLength(&h->elems) - h->count > h->count) Compact(h);
+  return TRUE;
+}
+
+void *OrderedHashSetLookup(const orderedhashset *h, const void *elemAddr)
+{
+  vector_assert(elemAddr == NULL, "Element address is NULL.");
+  int slot = FindSlot(h, elemAddr, TagOf(h, elemAddr), NULL);
+  return slot >= 0 ? ElemAt(h, SlotAt(h, slot)->position) : NULL;
+}
+
+void OrderedHashSetMap(orderedhashset *h, HashSetMapFunction mapfn, void *auxData)
+{
+  vector_assert(mapfn == NULL, "Map function was not provided.");
+  VectorMap(&h->elems, mapfn, auxData);
+}
@@ -0,0 +1,152 @@
+#ifndef _orderedhashset_
+#define _orderedhashset_
+#include "hashset.h"
+#include "vector.h"
+
+/* File: orderedhashset.h
+ * ----------------------
+ * Defines a hashset that keeps its elements in the order they were entered,
+ * for sets that are walked in full as often as they are searched.
+ *
+ * The elements themselves live in a vector, packed end to end in the order
+ * they were entered.  Alongside it is an index: an open-addressing table of
+ * small slots, each holding the position of one element in the vector, its
+ * probe distance and 32 bits of its hash.  A lookup probes the index just as
+ * the hashset probes its slots, comparing only the elements whose hash bits
+ * match, so it stays constant time; the index slots are 12 bytes however
+ * big the elements are.
+ *
+ * Mapping over the set is then a scan of the vector, touching live elements
+ * only, where the hashset has to visit every one of its slots, full or
+ * empty.  The order of the scan is the order the elements were first
+ * entered, so it is the same on every run and every platform.
+ *
+ * The interface mirrors swisshashset.h function for function, and takes the
+ * same hash, compare, map and free functions.
+ */
+
+/**
+ * Constant: kOrderedHashRange
+ * ---------------------------
+ * The numBuckets every call to an orderedhashset's hash function is passed.
+ */
+
+enum { kOrderedHashRange = 0x7fffffff };
+
+/**
+ * Type: orderedhashset
+ * --------------------
+ * The concrete representation of the orderedhashset.  As with the hashset,
+ * the client is required to go through the functions below.
+ */
+
+typedef struct {
+  vector elems;           // in entry order; removed elements are tombstoned until compaction
+  void *slots;            // numBuckets OrderedHashSetSlots, defined in orderedhashset.c
+  int numBuckets;
+  int count;
+  HashSetHashFunction hashfn;
+  HashSetCompareFunction comparefn;
+  HashSetFreeFunction freefn;
+} orderedhashset;
+
+/**
+ * Function: OrderedHashSetNew
+ * Usage: OrderedHashSetNew(&seen, sizeof(char *), 1024,
+ *                          StringHash, StringCompare, StringFree);
+ * ---------------------------
+ * Initializes the orderedhashset to be empty, with an index of numBuckets
+ * slots that doubles once more than 7/8 of them are in use, as a hashset's
+ * table does by default.  The arguments mean what they do to HashSetNew,
+ * except that, as for the swisshashset, the hash function is always passed
+ * a numBuckets of kOrderedHashRange; the set mixes the code it returns and
+ * takes the home slot and the stored hash bits from the result.
+ *
+ * An assert is raised unless elemSize and numBuckets are positive and both
+ * hashfn and comparefn are non-NULL.
+ */
+
+void OrderedHashSetNew(orderedhashset *h, int elemSize, int numBuckets,
+                       HashSetHashFunction hashfn, HashSetCompareFunction comparefn,
+                       HashSetFreeFunction freefn);
+
+/**
+ * Function: OrderedHashSetDispose
+ * -------------------------------
+ * Applies the free function, if any, to every stored element and releases
+ * the vector and the index.
+ */
+
+void OrderedHashSetDispose(orderedhashset *h);
+
+/**
+ * Function: OrderedHashSetCount
+ * -----------------------------
+ * Returns the number of elements in the orderedhashset.
+ */
+
+int OrderedHashSetCount(const orderedhashset *h);
+
+/**
+ * Function: OrderedHashSetEnter
+ * -----------------------------
+ * Inserts the element, replacing (and freeing) a stored element that
+ * compares equal to it, exactly as HashSetEnter does.  A new element goes at
+ * the end of the order; a replacement takes over the place of the element it
+ * replaces.  An assert is raised if elemAddr is NULL or the hash code is
+ * outside [0, kOrderedHashRange).
+ */
+
+void OrderedHashSetEnter(orderedhashset *h, const void *elemAddr);
+
+/**
+ * Function: OrderedHashSetFindOrEnter
+ * -----------------------------------
+ * Returns the address of the stored element matching elemAddr, entering a
+ * copy of it at the end of the order first if there is none, in one probe;
+ * inserted (if not NULL) is set to whether it was entered.  An existing
+ * match is left untouched.  This is HashSetFindOrEnter for the
+ * orderedhashset, and the address stays good just as long as one from
+ * OrderedHashSetLookup.  The same asserts as OrderedHashSetEnter are raised.
+ */
+
+void *OrderedHashSetFindOrEnter(orderedhashset *h, const void *elemAddr, mybool *inserted);
+
+/**
+ * Function: OrderedHashSetRemove
+ * ------------------------------
+ * Removes the element matching elemAddr, applying the free function (if
+ * any) to it first, and returns TRUE; returns FALSE if there was no match.
+ * The element's index slot is closed up by backward shifting, as in
+ * HashSetRemove, and its place in the vector is tombstoned so that the
+ * others keep their positions.  Once removed elements outnumber live ones,
+ * the vector is compacted and the index updated to match, which keeps
+ * OrderedHashSetMap proportional to the live count.  The same asserts as
+ * OrderedHashSetEnter are raised.
+ */
+
+mybool OrderedHashSetRemove(orderedhashset *h, const void *elemAddr);
+
+/**
+ * Function: OrderedHashSetLookup
+ * ------------------------------
+ * Returns the address of the stored element matching elemAddr, or NULL.
+ * The vector may reallocate as elements are entered and is compacted as
+ * they are removed, so the address is only good until the next call that
+ * enters or removes an element.  The same asserts as OrderedHashSetEnter are
+ * raised.
+ */
+
+void *OrderedHashSetLookup(const orderedhashset *h, const void *elemAddr);
+
+/**
+ * Function: OrderedHashSetMap
+ * ---------------------------
+ * Applies mapfn to every stored element in the order they were entered.
+ * The mapping function may modify the elements, but not in any way that
+ * changes how they hash or compare.  An assert is raised if mapfn is NULL.
+ */
+
+void OrderedHashSetMap(orderedhashset *h, HashSetMapFunction mapfn, void *auxData);
+
+#endif
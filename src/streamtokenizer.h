@@ -2,6 +2,7 @@
 #define _streamtokenizer_
 
 #include "bool.h"
+#include <stdbool.h>
 #include <stdio.h>
 
 /**
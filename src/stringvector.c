@@ -0,0 +1,115 @@
+#include "stringvector.h"
+#include "vector_error.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const int kDefaultStringAllocation = 64;
+static const size_t kGuessedCharsPerString = 16;
+
+static const StringSpan *SpanAt(const stringvector *sv, int position) {
+  return VectorNth(&sv->spans, position);
+}
+
+static void StringVectorReserveArena(stringvector *sv, size_t needed) {
+  if (needed <= sv->arenaCapacity) return;
+  vector_assert(needed > UINT32_MAX, "String arena exceeds 4GB.");
+  size_t newCapacity = sv->arenaCapacity * 2;
+  if (newCapacity < needed) newCapacity = needed;
+  if (newCapacity > UINT32_MAX) newCapacity = UINT32_MAX;
+  sv->arena = realloc(sv->arena, newCapacity);
+  vector_assert(sv->arena == NULL, "Couldn't reallocate string arena.");
+  sv->arenaCapacity = newCapacity;
+}
+
+void StringVectorNew(stringvector *sv, int initialAllocation)
+{
+  vector_assert(initialAllocation < 0, "Initial allocation must not be negative.");
+  if (initialAllocation == 0) initialAllocation = kDefaultStringAllocation;
+  VectorNewUntraced(&sv->spans, sizeof(StringSpan), NULL, initialAllocation);
+  sv->arena = NULL;
+  sv->arenaLength = 0;
+  sv->arenaCapacity = 0;
+  StringVectorReserveArena(sv, initialAllocation * kGuessedCharsPerString);
+}
+
+void StringVectorDispose(stringvector *sv)
+{
+  free(sv->arena);
+  VectorDispose(&sv->spans);
+}
+
+int StringVectorLength(const stringvector *sv)
+{ return VectorLength(&sv->spans); }
+
+void StringVectorAppend(stringvector *sv, const char *str)
+{
+  vector_assert(str == NULL, "Failed to append, no string provided.");
+  size_t length = strlen(str);
+  StringVectorReserveArena(sv, sv->arenaLength + length + 1);
+  memcpy(sv->arena + sv->arenaLength, str, length + 1);
+  StringSpan span = { (uint32_t)sv->arenaLength, (uint32_t)length };
+  VectorAppend(&sv->spans, &span);
+  sv->arenaLength += length + 1;
+}
+
+const char *StringVectorNth(const stringvector *sv, int position, int *length)
+{
+  const StringSpan *span = SpanAt(sv, position);
+  if (length != NULL) *length = (int)span->length;
+  return sv->arena + span->offset;
+}
+
+/**
+ * Type: StringSortRecord
+ * ----------------------
+ * What StringVectorSort hands to VectorSortStrings: the string to order by,
+ * followed by the span it came from.
+ */
+
+typedef struct {
+  const char *str;
+  StringSpan span;
+} StringSortRecord;
+
+void StringVectorSort(stringvector *sv)
+{
+  int count = StringVectorLength(sv);
+  if (count < 2) return;
+  // Each string is sorted with its span riding along, so the stored
+  // lengths carry over without rescanning the arena.
+  vector records;
+  VectorNewUntraced(&records, sizeof(StringSortRecord), NULL, count);
+  for (int i = 0; i < count; i++) {
+    StringSortRecord record = { sv->arena + SpanAt(sv, i)->offset, *SpanAt(sv, i) };
+    VectorAppend(&records, &record);
+  }
+  VectorSortStrings(&records);
+  for (int i = 0; i < count; i++) {
+    VectorReplace(&sv->spans, &((const StringSortRecord *)VectorNth(&records, i))->span, i);
+  }
+  VectorDispose(&records);
+}
+
+static const int kNotFound = -1;
+int StringVectorSearch(const stringvector *sv, const char *key, mybool isSorted)
+{
+  vector_assert(key == NULL, "Failed to search, no key provided.");
+  int count = StringVectorLength(sv);
+  if (isSorted) {
+    int lo = 0, hi = count - 1;
+    while (lo <= hi) {
+      int mid = lo + (hi - lo) / 2;
+      int cmp = strcmp(sv->arena + SpanAt(sv, mid)->offset, key);
+      if (cmp == 0) return mid;
+      if (cmp < 0) lo = mid + 1;
+      else hi = mid - 1;
+    }
+    return kNotFound;
+  }
+  size_t keyLength = strlen(key);
+  for (int i = 0; i < count; i++) {
+    const StringSpan *span = SpanAt(sv, i);
+    if (span->length == keyLength && memcmp(sv->arena + span->offset, key, keyLength) == 0) return i;
+  }
+  return kNotFound;
+}
@@ -0,0 +1,125 @@
+/**
+ * File: stringvector.h
+ * --------------------
+ * Defines the interface for the stringvector, a packed sequence of C strings.
+ *
+ * A vector of char * elements costs one malloc per string, a VectorFreeFunction
+ * call per string when it is disposed of, and a pointer dereference (usually a
+ * cache miss) on every access.  A stringvector instead copies every string,
+ * terminator included, back to back into one growable character arena and
+ * keeps a parallel array of (offset, length) spans.  Per-string overhead drops
+ * from a pointer plus a heap block header to eight bytes, disposal is two
+ * frees, and a scan over the strings walks memory in order.
+ */
+
+#ifndef _stringvector_
+#define _stringvector_
+
+#include "vector.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Type: StringSpan
+ * ----------------
+ * Locates one string in the arena: its starting offset and its length, not
+ * counting the terminating '\0' that follows it.
+ */
+
+typedef struct {
+  uint32_t offset;
+  uint32_t length;
+} StringSpan;
+
+/**
+ * Type: stringvector
+ * ------------------
+ * Defines the concrete representation of the stringvector.  The spans are
+ * kept in an ordinary vector; the arena is managed directly so that a string
+ * is copied in with a single memcpy.  The client should interact with a
+ * stringvector only via the functions below.
+ */
+
+typedef struct {
+  char *arena;
+  size_t arenaLength;
+  size_t arenaCapacity;
+  vector spans;   // of StringSpan
+} stringvector;
+
+/**
+ * Function: StringVectorNew
+ * Usage: stringvector words;
+ *        StringVectorNew(&words, 1000);
+ * -------------------------
+ * Constructs a raw or previously destroyed stringvector to be empty, with
+ * room for initialAllocation strings (and a guess at their characters) before
+ * it needs to grow.  If initialAllocation is 0, a default is used.  An assert
+ * is raised if initialAllocation is less than 0.
+ */
+
+void StringVectorNew(stringvector *sv, int initialAllocation);
+
+/**
+ * Function: StringVectorDispose
+ * -----------------------------
+ * Frees the arena and the span array.  The strings were copied in, so there
+ * is nothing else to free.
+ */
+
+void StringVectorDispose(stringvector *sv);
+
+/**
+ * Function: StringVectorLength
+ * ----------------------------
+ * Returns the number of strings stored.  Runs in constant time.
+ */
+
+int StringVectorLength(const stringvector *sv);
+
+/**
+ * Function: StringVectorAppend
+ * ----------------------------
+ * Copies the C string str, terminator and all, onto the end of the arena and
+ * records its span.  Runs in amortized time proportional to the length of
+ * str.  An assert is raised if str is NULL or the arena would outgrow the
+ * 4GB that 32-bit offsets can address.
+ */
+
+void StringVectorAppend(stringvector *sv, const char *str);
+
+/**
+ * Function: StringVectorNth
+ * -------------------------
+ * Returns a pointer to the string at the specified position and, if length
+ * is non-NULL, stores its length there.  The string is '\0'-terminated, so
+ * the pointer can be handed to any C string function.  As with VectorNth,
+ * the pointer is into the stringvector's own storage and becomes invalid
+ * after the next append.  An assert is raised if position is out of bounds.
+ */
+
+const char *StringVectorNth(const stringvector *sv, int position, int *length);
+
+/**
+ * Function: StringVectorSort
+ * --------------------------
+ * Sorts the strings into strcmp order.  Only the spans are rearranged; the
+ * characters stay where they are in the arena.  The comparison work is done
+ * by VectorSortStrings.
+ */
+
+void StringVectorSort(stringvector *sv);
+
+/**
+ * Function: StringVectorSearch
+ * ----------------------------
+ * Returns the position of a string equal to key, or -1 if there is none.
+ * If isSorted is TRUE the strings must be in strcmp order and a binary
+ * search is used; otherwise the strings are scanned in order, and any whose
+ * recorded length differs from the key's is rejected without touching its
+ * characters.  An assert is raised if key is NULL.
+ */
+
+int StringVectorSearch(const stringvector *sv, const char *key, mybool isSorted);
+
+#endif
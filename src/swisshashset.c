@@ -0,0 +1,284 @@
+#include "swisshashset.h"
+#include "vector_error.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+enum { kGroupSize = 16 };
+static const signed char kEmpty = -128;
+static const signed char kDeleted = -2;    // a tombstone; see SwissHashSetRemove
+static const uint64_t kMixMultiplier = 0x9e3779b97f4a7c15ULL;
+
+/**
+ * Type: SwissHash
+ * ---------------
+ * A hash code split in two: the group a probe starts at, and the seven bits
+ * that go in the control byte.  The code is first spread by a multiply, then
+ * the top 32 bits choose the group and the seven bits beneath them become
+ * the tag, so the two are independent of each other and of how well the
+ * client's low bits are mixed.
+ */
+
+typedef struct {
+  int group;
+  signed char tag;
+} SwissHash;
+
+static int NumGroups(const swisshashset *h) {
+  return h->numBuckets / kGroupSize;
+}
+
+static int HashCode(const swisshashset *h, const void *elemAddr) {
+  int code = h->hashfn(elemAddr, kSwissHashRange);
+  vector_assert(code < 0 || code >= kSwissHashRange, "Hash code out of range.");
+  return code;
+}
+
+static SwissHash SplitHash(const swisshashset *h, int code) {
+  uint64_t mixed = (uint64_t)code * kMixMultiplier;
+  SwissHash hash = { (int)(((mixed >> 32) * (uint64_t)NumGroups(h)) >> 32),
+                     (signed char)((mixed >> 25) & 0x7f) };
+  return hash;
+}
+
+static char *ElemAt(const swisshashset *h, int slot) {
+  return h->elems + (size_t)slot * h->elemSize;
+}
+
+/**
+ * Returns a mask with bit i set for every control byte i of the group that
+ * equals byte.
+ */
+static unsigned MatchByte(const signed char *group, signed char byte) {
+#ifdef __SSE2__
+  __m128i ctrl = _mm_load_si128((const __m128i *)group);
+  return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(byte)));
+#else
+  unsigned mask = 0;
+  for (int i = 0; i < kGroupSize; i++) {
+    if (group[i] == byte) mask |= 1u << i;
+  }
+  return mask;
+#endif
+}
+
+/**
+ * Returns a mask with bit i set for every slot i of the group that is empty
+ * or a tombstone.  Those are the control bytes with the sign bit set.
+ */
+static unsigned MatchAvailable(const signed char *group) {
+#ifdef __SSE2__
+  return (unsigned)_mm_movemask_epi8(_mm_load_si128((const __m128i *)group));
+#else
+  unsigned mask = 0;
+  for (int i = 0; i < kGroupSize; i++) {
+    if (group[i] < 0) mask |= 1u << i;
+  }
+  return mask;
+#endif
+}
+
+static mybool IsFull(signed char ctrl) {
+  return ctrl >= 0;
+}
+
+/**
+ * Probes visit groups in triangular steps (1, 2, 3, ... groups on from the
+ * last), which on a power-of-two group count reaches every group.  A group
+ * with an empty slot ends the search: the key would have been placed there
+ * had the earlier groups been full.  Removals leave tombstones, which a
+ * search steps over, in groups that have been full.
+ */
+static int NextGroup(const swisshashset *h, int group, int step) {
+  return (group + step) & (NumGroups(h) - 1);
+}
+
+/**
+ * Returns the slot holding an element equal to elemAddr, or -1.  If
+ * freeSlot is not NULL, a failed search sets it to the first empty slot or
+ * tombstone it passed, which is where the element belongs if entered.
+ */
+static int FindSlot(const swisshashset *h, const void *elemAddr, SwissHash hash, int *freeSlot) {
+  int group = hash.group, available = -1;
+  for (int step = 1; ; step++) {
+    const signed char *ctrl = h->ctrl + group * kGroupSize;
+    for (unsigned match = MatchByte(ctrl, hash.tag); match != 0; match &= match - 1) {
+      int slot = group * kGroupSize + __builtin_ctz(match);
+      if (h->comparefn(ElemAt(h, slot), elemAddr) == 0) return slot;
+    }
+    if (freeSlot != NULL && available < 0) {
+      unsigned free = MatchAvailable(ctrl);
+      if (free != 0) available = group * kGroupSize + __builtin_ctz(free);
+    }
+    if (MatchByte(ctrl, kEmpty) != 0) {
+      if (freeSlot != NULL) *freeSlot = available;
+      return -1;
+    }
+    group = NextGroup(h, group, step);
+  }
+}
+
+static int FindEmptySlot(const swisshashset *h, SwissHash hash) {
+  int group = hash.group;
+  for (int step = 1; ; step++) {
+    unsigned empty = MatchByte(h->ctrl + group * kGroupSize, kEmpty);
+    if (empty != 0) return group * kGroupSize + __builtin_ctz(empty);
+    group = NextGroup(h, group, step);
+  }
+}
+
+static void AllocateTable(swisshashset *h, int numBuckets) {
+  h->ctrl = aligned_alloc(kGroupSize, numBuckets);
+  h->elems = malloc((size_t)numBuckets * h->elemSize);
+  vector_assert(h->ctrl == NULL || h->elems == NULL, "Couldn't allocate hashset.");
+  memset(h->ctrl, kEmpty, numBuckets);
+  h->numBuckets = numBuckets;
+}
+
+static mybool IsOverloaded(const swisshashset *h, int count) {
+  return count > h->numBuckets - h->numBuckets / 8;
+}
+
+/**
+ * Places every element afresh in a table of numBuckets slots, which also
+ * clears out the tombstones.
+ */
+static void Rebuild(swisshashset *h, int numBuckets) {
+  signed char *oldCtrl = h->ctrl;
+  char *oldElems = h->elems;
+  int oldBuckets = h->numBuckets;
+  AllocateTable(h, numBuckets);
+  h->deleted = 0;
+  for (int slot = 0; slot < oldBuckets; slot++) {
+    if (!IsFull(oldCtrl[slot])) continue;
+    char *elem = oldElems + (size_t)slot * h->elemSize;
+    SwissHash hash = SplitHash(h, HashCode(h, elem));
+    int dest = FindEmptySlot(h, hash);
+    h->ctrl[dest] = hash.tag;
+    memcpy(ElemAt(h, dest), elem, h->elemSize);
+  }
+  free(oldCtrl);
+  free(oldElems);
+}
+
+void SwissHashSetNew(swisshashset *h, int elemSize, int numBuckets,
+                     HashSetHashFunction hashfn, HashSetCompareFunction comparefn,
+                     HashSetFreeFunction freefn)
+{
+  vector_assert(elemSize <= 0, "Element size must be greater than zero.");
+  vector_assert(numBuckets <= 0 || numBuckets > INT32_MAX / 2,
+                "Number of buckets must be greater than zero.");
+  vector_assert(hashfn == NULL || comparefn == NULL,
+                "Failed to create hashset, no hash or compare function provided.");
+  h->elemSize = elemSize;
+  h->count = 0;
+  h->deleted = 0;
+  h->hashfn = hashfn;
+  h->comparefn = comparefn;
+  h->freefn = freefn;
+  int rounded = kGroupSize;
+  while (rounded < numBuckets) rounded *= 2;
+  AllocateTable(h, rounded);
+}
+
+void SwissHashSetDispose(swisshashset *h)
+{
+  if (h->freefn != NULL) {
+    for (int slot = 0; slot < h->numBuckets; slot++) {
+      if (IsFull(h->ctrl[slot])) h->freefn(ElemAt(h, slot));
+    }
+  }
+  free(h->ctrl);
+  free(h->elems);
+  h->ctrl = NULL;
+  h->elems = NULL;
+}
+
+int SwissHashSetCount(const swisshashset *h)
+{ return h->count; }
+
+/**
+ * Enters an element that FindSlot has just failed to find, into the free
+ * slot it reported.  Reusing a tombstone takes no more room; filling an
+ * empty slot may call for a rebuild first, since tombstones count against
+ * the load too.  If the live elements alone would leave the table under
+ * half full the rebuild keeps the size and just clears the tombstones,
+ * and otherwise it doubles.  Returns the element's new address.
+ */
+static char *EnterAbsent(swisshashset *h, const void *elemAddr, int code, int freeSlot) {
+  SwissHash hash = SplitHash(h, code);
+  if (h->ctrl[freeSlot] == kDeleted) {
+    h->deleted--;
+  } else if (IsOverloaded(h, h->count + h->deleted + 1)) {
+    int numBuckets = h->numBuckets;
+    if (IsOverloaded(h, 2 * (h->count + 1))) {
+      vector_assert(numBuckets > INT32_MAX / 2, "Hashset is too large to grow.");
+      numBuckets *= 2;
+    }
+    Rebuild(h, numBuckets);
+    hash = SplitHash(h, code);
+    freeSlot = FindEmptySlot(h, hash);
+  }
+  h->ctrl[freeSlot] = hash.tag;
+  memcpy(ElemAt(h, freeSlot), elemAddr, h->elemSize);
+  h->count++;
+  return ElemAt(h, freeSlot);
+}
+
+void SwissHashSetEnter(swisshashset *h, const void *elemAddr)
+{
+  vector_assert(elemAddr == NULL, "Element address is NULL.");
+  int code = HashCode(h, elemAddr), freeSlot;
+  int slot = FindSlot(h, elemAddr, SplitHash(h, code), &freeSlot);
+  if (slot >= 0) {
+    if (h->freefn != NULL) h->freefn(ElemAt(h, slot));
+    memcpy(ElemAt(h, slot), elemAddr, h->elemSize);
+    return;
+  }
+  EnterAbsent(h, elemAddr, code, freeSlot);
+}
+
+void *SwissHashSetFindOrEnter(swisshashset *h, const void *elemAddr, mybool *inserted)
+{
+  vector_assert(elemAddr == NULL, "Element address is NULL.");
+  int code = HashCode(h, elemAddr), freeSlot;
+  int slot = FindSlot(h, elemAddr, SplitHash(h, code), &freeSlot);
+  if (inserted != NULL) *inserted = slot < 0 ? TRUE : FALSE;
+  return slot >= 0 ? ElemAt(h, slot) : EnterAbsent(h, elemAddr, code, freeSlot);
+}
+
+mybool SwissHashSetRemove(swisshashset *h, const void *elemAddr)
+{
+  vector_assert(elemAddr == NULL, "Element address is NULL.");
+  int slot = FindSlot(h, elemAddr, SplitHash(h, HashCode(h, elemAddr)), NULL);
+  if (slot < 0) return FALSE;
+  if (h->freefn != NULL) h->freefn(ElemAt(h, slot));
+  // Empties are only ever made in a group that still has one, so such a
+  // group has never been full and no search has ever gone on past it.
+  if (MatchByte(h->ctrl + slot / kGroupSize * kGroupSize, kEmpty) != 0) {
+    h->ctrl[slot] = kEmpty;
+  } else {
+    h->ctrl[slot] = kDeleted;
+    h->deleted++;
+  }
+  h->count--;
+  return TRUE;
+}
+
+void *SwissHashSetLookup(const swisshashset *h, const void *elemAddr)
+{
+  vector_assert(elemAddr == NULL, "Element address is NULL.");
+  int slot = FindSlot(h, elemAddr, SplitHash(h, HashCode(h, elemAddr)), NULL);
+  return slot >= 0 ? ElemAt(h, slot) : NULL;
+}
+
+void SwissHashSetMap(swisshashset *h, HashSetMapFunction mapfn, void *auxData)
+{
+  vector_assert(mapfn == NULL, "Map function was not provided.");
+  for (int slot = 0; slot < h->numBuckets; slot++) {
+    if (IsFull(h->ctrl[slot])) mapfn(ElemAt(h, slot), auxData);
+  }
+}
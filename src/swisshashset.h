@@ -0,0 +1,154 @@
+#ifndef _swisshashset_
+#define _swisshashset_
+#include "hashset.h"
+
+/* File: swisshashset.h
+ * --------------------
+ * Defines a group-probing hashset for read-mostly sets that see a high rate
+ * of lookups.
+ *
+ * The swisshashset keeps one control byte per slot, in an array of its own
+ * alongside the elements.  A control byte either marks its slot empty or
+ * holds seven bits of the element's hash (or, after a removal, may mark a
+ * tombstone).  Slots are grouped sixteen at a
+ * time, so a probe loads one group's sixteen control bytes into a single
+ * SSE2 register, compares all of them against the key's seven hash bits
+ * at once and only visits the elements whose bits match.  Almost every
+ * lookup, hit or miss, is settled by the first group, touching one cache
+ * line of control bytes and (on a hit) one element.  Builds without SSE2
+ * compare the group one byte at a time.
+ *
+ * The interface mirrors hashset.h function for function, and takes the same
+ * hash, compare, map and free functions, so a client can switch between the
+ * two by changing the type and the prefix.
+ */
+
+/**
+ * Constant: kSwissHashRange
+ * -------------------------
+ * The numBuckets every call to a swisshashset's hash function is passed.
+ */
+
+enum { kSwissHashRange = 0x7fffffff };
+
+/**
+ * Type: swisshashset
+ * ------------------
+ * The concrete representation of the swisshashset.  As with the hashset,
+ * the client is required to go through the functions below.
+ */
+
+typedef struct {
+  signed char *ctrl;      // numBuckets control bytes, 16-byte aligned
+  char *elems;            // numBuckets element slots
+  int elemSize;
+  int numBuckets;         // a power of two, and at least one group
+  int count;
+  int deleted;            // tombstones left by SwissHashSetRemove
+  HashSetHashFunction hashfn;
+  HashSetCompareFunction comparefn;
+  HashSetFreeFunction freefn;
+} swisshashset;
+
+/**
+ * Function: SwissHashSetNew
+ * Usage: SwissHashSetNew(&stopWords, sizeof(char *), 4096,
+ *                        StringHash, StringCompare, StringFree);
+ * -------------------------
+ * Initializes the swisshashset to be empty.  The arguments mean what they
+ * do to HashSetNew, with two differences.  numBuckets is rounded up to a
+ * power of two of at least 16, and the table doubles once more than 7/8 of
+ * its slots are full.  And the hash function is not asked for a bucket
+ * number: it is always passed a numBuckets of kSwissHashRange and the
+ * swisshashset splits the code it returns into the group to probe and the
+ * seven bits kept in the control byte.  The hash must therefore spread
+ * elements over that whole range; the usual "hash mod numBuckets" functions
+ * do, provided the underlying hash does.
+ *
+ * An assert is raised unless elemSize and numBuckets are positive and both
+ * hashfn and comparefn are non-NULL.
+ */
+
+void SwissHashSetNew(swisshashset *h, int elemSize, int numBuckets,
+                     HashSetHashFunction hashfn, HashSetCompareFunction comparefn,
+                     HashSetFreeFunction freefn);
+
+/**
+ * Function: SwissHashSetDispose
+ * -----------------------------
+ * Applies the free function, if any, to every stored element and releases
+ * the table.
+ */
+
+void SwissHashSetDispose(swisshashset *h);
+
+/**
+ * Function: SwissHashSetCount
+ * ---------------------------
+ * Returns the number of elements in the swisshashset.
+ */
+
+int SwissHashSetCount(const swisshashset *h);
+
+/**
+ * Function: SwissHashSetEnter
+ * ---------------------------
+ * Inserts the element, replacing (and freeing) a stored element that
+ * compares equal to it, exactly as HashSetEnter does.  An assert is raised
+ * if elemAddr is NULL or the hash code is outside [0, kSwissHashRange).
+ */
+
+void SwissHashSetEnter(swisshashset *h, const void *elemAddr);
+
+/**
+ * Function: SwissHashSetFindOrEnter
+ * ---------------------------------
+ * Returns the address of the stored element matching elemAddr, entering a
+ * copy of it first if there is none, in one probe; inserted (if not NULL)
+ * is set to whether it was entered.  An existing match is left untouched.
+ * This is HashSetFindOrEnter for the swisshashset, and the address stays
+ * good just as long as one from SwissHashSetLookup.  The same asserts as
+ * SwissHashSetEnter are raised.
+ */
+
+void *SwissHashSetFindOrEnter(swisshashset *h, const void *elemAddr, mybool *inserted);
+
+/**
+ * Function: SwissHashSetRemove
+ * ----------------------------
+ * Removes the element matching elemAddr, applying the free function (if
+ * any) to it first, and returns TRUE; returns FALSE if there was no match.
+ * Group probing has no backward shift, so where later searches may have
+ * passed through the slot's group, the slot becomes a tombstone.  A
+ * tombstone is reused by the next element entered along that probe
+ * sequence, and the tombstones are cleared out whenever the table is
+ * rebuilt, which happens at the same size when they rather than live
+ * elements have filled it.  In a group that still has an empty slot, no
+ * search can have gone past, so the slot is simply emptied.  The same
+ * asserts as SwissHashSetEnter are raised.
+ */
+
+mybool SwissHashSetRemove(swisshashset *h, const void *elemAddr);
+
+/**
+ * Function: SwissHashSetLookup
+ * ----------------------------
+ * Returns the address of the stored element matching elemAddr, or NULL.
+ * Elements only move when the table grows, so the address stays good until
+ * a SwissHashSetEnter or SwissHashSetFindOrEnter adds a new element or
+ * SwissHashSetRemove removes one.  The same asserts as
+ * SwissHashSetEnter are raised.
+ */
+
+void *SwissHashSetLookup(const swisshashset *h, const void *elemAddr);
+
+/**
+ * Function: SwissHashSetMap
+ * -------------------------
+ * Applies mapfn to every stored element, in slot order.  An assert is
+ * raised if mapfn is NULL.
+ */
+
+void SwissHashSetMap(swisshashset *h, HashSetMapFunction mapfn, void *auxData);
+
+#endif
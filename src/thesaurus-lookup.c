@@ -1,5 +1,6 @@
 #include "bool.h"
 #include "hashset.h"
+#include "frozenhashset.h"
 #include "vector.h"
 #include "streamtokenizer.h"
 #include <stdlib.h>  // for malloc, free, etc
@@ -191,12 +192,12 @@ static int RandomInteger(int low, int high)
  * selects one of the its synonyms at random, printing it along
  * with the user supplied word.
  *
- * @param thesuarus the address of the hashset housing all of the
- *                  synonyms sets of a large collection of English
+ * @param thesuarus the address of the frozen hashset housing all of
+ *                  the synonyms sets of a large collection of English
  *                  words and phrases.
  */
 
-static void QueryThesaurus(hashset *thesaurus)
+static void QueryThesaurus(const frozenhashset *thesaurus)
 {
   char response[1024];
   char *responsep = response;
@@ -205,7 +206,7 @@ static void QueryThesaurus(hashset *thesaurus)
     fgets(response, sizeof(response), stdin);
     response[strlen(response) - 1] = '\0';
     if (strlen(response) == 0) return;
-    thesaurusEntry *found = HashSetLookup(thesaurus, &responsep);
+    thesaurusEntry *found = FrozenHashSetLookup(thesaurus, &responsep);
     if (found != NULL) {
       int numSynonyms = VectorLength(&found->synonyms);
       char *synonym = *(char **) VectorNth(&found->synonyms, RandomInteger(0, numSynonyms - 1));
@@ -228,7 +229,9 @@ int main(int argc, const char *argv[])
   const char *thesaurusFileName = (argc == 1) ? 
     "/usr/class/cs107/assignments/assn-3-vector-hashset-data/thesaurus.txt" : argv[1];
   ReadThesaurus(&thesaurus, thesaurusFileName);
-  QueryThesaurus(&thesaurus);
-  HashSetDispose(&thesaurus);
+  frozenhashset frozen;     // the thesaurus is never changed after loading
+  HashSetFreeze(&thesaurus, &frozen);
+  QueryThesaurus(&frozen);
+  FrozenHashSetDispose(&frozen);
   return 0;
 }
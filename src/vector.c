@@ -1,25 +1,250 @@
 #include "vector.h"
 #include "vector_error.h"
+#include "containertrace.h"
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <assert.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
+
+static const size_t kHugePageSize = 2 * 1024 * 1024;
+static const size_t kMappedPageSize = 4096;
+
+/**
+ * Maps an anonymous buffer of at least bytes on huge pages, rounding the
+ * length up to a whole number of huge pages.  Explicit hugetlbfs pages are
+ * tried first; failing that, an ordinary mapping is advised to be backed by
+ * transparent huge pages.  Returns NULL if mapping isn't supported.
+ */
+static void *MapHugeBuffer(size_t bytes, VectorBacking *backing, size_t *mappedBytes) {
+#if defined(MAP_ANONYMOUS)
+  size_t length = (bytes + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+  void *buffer = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+  buffer = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  *backing = kVectorBackingHugeTLB;
+#endif
+  if(buffer == MAP_FAILED) {
+    buffer = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(buffer == MAP_FAILED) return NULL;
+#if defined(MADV_HUGEPAGE)
+    madvise(buffer, length, MADV_HUGEPAGE);
+#endif
+    *backing = kVectorBackingTransparentHugePages;
+  }
+  *mappedBytes = length;
+  return buffer;
+#else
+  return NULL;
+#endif
+}
+
+static void ReleaseBuffer(void *buffer, VectorBacking backing, size_t allocatedBytes) {
+#if defined(MAP_ANONYMOUS)
+  if(backing == kVectorBackingTransparentHugePages || backing == kVectorBackingHugeTLB) {
+    munmap(buffer, allocatedBytes);
+    return;
+  }
+#endif
+  free(buffer);
+}
+
+/**
+ * Moves the vector's elements into a buffer of newCapacity elements.  Plain
+ * vectors simply realloc; aligned and huge-page vectors get a freshly
+ * allocated buffer of the right kind and have their elements copied over.
+ */
+static void VectorResizeBuffer(vector *v, int newCapacity) {
+  size_t bytes = (size_t)newCapacity * v->elemSize;
+  if(v->deadFlags != NULL) {
+    v->deadFlags = realloc(v->deadFlags, newCapacity);
+    vector_assert(v->deadFlags == NULL && newCapacity > 0, "Couldn't reallocate vector.");
+    if(newCapacity > v->capacity) memset(v->deadFlags + v->capacity, 0, newCapacity - v->capacity);
+  }
+  if(v->alignment == 0 && !v->allowHugePages) {
+    v->data = realloc(v->data, bytes);
+    vector_assert(v->data == NULL && bytes > 0, "Couldn't reallocate vector.");
+    v->allocatedBytes = bytes;
+    v->capacity = newCapacity;
+    return;
+  }
+
+  VectorBacking backing = kVectorBackingAligned;
+  size_t allocatedBytes = bytes;
+  void *buffer = NULL;
+  if(v->allowHugePages && bytes >= kHugePageSize && (size_t)v->alignment <= kMappedPageSize) {
+    buffer = MapHugeBuffer(bytes, &backing, &allocatedBytes);
+  }
+  if(buffer == NULL) {
+    size_t alignment = v->alignment > (int)sizeof(void *) ? (size_t)v->alignment : sizeof(void *);
+    backing = kVectorBackingAligned;
+    allocatedBytes = bytes;
+    vector_assert(posix_memalign(&buffer, alignment, bytes > 0 ? bytes : 1) != 0,
+                  "Couldn't reallocate vector.");
+  }
+  if(v->data != NULL) {
+    memcpy(buffer, v->data, (size_t)v->logicalSize * v->elemSize);
+    ReleaseBuffer(v->data, v->backing, v->allocatedBytes);
+  }
+  v->data = buffer;
+  v->backing = backing;
+  v->allocatedBytes = allocatedBytes;
+  v->capacity = newCapacity;
+}
+
+/**
+ * Copies one element.  The common element sizes go through a memcpy of
+ * constant length, which the compiler lowers to fixed-width loads and
+ * stores, so append, insert, replace and the heap sift loops don't pay for
+ * a library call per element.  The switch becomes a jump table on elemSize,
+ * which predicts perfectly for any one vector.
+ */
+static void CopyElement(void *dest, const void *src, int elemSize) {
+  switch(elemSize) {
+    case 1: memcpy(dest, src, 1); break;
+    case 2: memcpy(dest, src, 2); break;
+    case 4: memcpy(dest, src, 4); break;
+    case 8: memcpy(dest, src, 8); break;
+    case 16: memcpy(dest, src, 16); break;
+    case 32: memcpy(dest, src, 32); break;
+    default: memcpy(dest, src, elemSize); break;
+  }
+}
+
+static void *ElementAt(const vector *v, int position) {
+  return (char *)v->data + (size_t)position * v->elemSize;
+}
+
+/**
+ * The trace hook for a call on v, which stays silent for the library's own
+ * vectors.
+ */
+#define VECTOR_TRACE_CALL(op, v, index, elemSize) \
+  do { \
+    if (!(v)->untraced) CONTAINER_TRACE((op), (v), (index), (elemSize)); \
+  } while (0)
 
 void VectorNew(vector *v, int elemSize, VectorFreeFunction freeFn, int initialAllocation)
+{
+	CONTAINER_TRACE(kTraceVectorNew, v, initialAllocation, elemSize);
+	VectorNewUntraced(v, elemSize, freeFn, initialAllocation);
+	v->untraced = FALSE;
+}
+
+void VectorNewUntraced(vector *v, int elemSize, VectorFreeFunction freeFn, int initialAllocation)
 {
 	v->logicalSize = 0;
 	v->elemSize = elemSize;
 	v->capacity = initialAllocation;
 	v->data = malloc(elemSize * initialAllocation);
 	v->freeFn = freeFn;
+	v->alignment = 0;
+	v->allowHugePages = FALSE;
+	v->backing = kVectorBackingHeap;
+	v->allocatedBytes = (size_t)elemSize * initialAllocation;
+	v->deadFlags = NULL;
+	v->numDeleted = 0;
+	v->maxDeadFraction = 0;
+	v->untraced = TRUE;
+}
+
+void VectorNewAligned(vector *v, int elemSize, VectorFreeFunction freeFn,
+                      int initialAllocation, int alignment, mybool allowHugePages)
+{
+  CONTAINER_TRACE(kTraceVectorNew, v, initialAllocation, elemSize);
+  vector_assert(alignment <= 0 || (alignment & (alignment - 1)) != 0,
+                "Alignment must be a power of two.");
+  v->logicalSize = 0;
+  v->elemSize = elemSize;
+  v->freeFn = freeFn;
+  v->alignment = alignment;
+  v->allowHugePages = allowHugePages;
+  v->data = NULL;
+  v->backing = kVectorBackingAligned;
+  v->allocatedBytes = 0;
+  v->capacity = 0;
+  v->deadFlags = NULL;
+  v->numDeleted = 0;
+  v->maxDeadFraction = 0;
+  v->untraced = FALSE;
+  VectorResizeBuffer(v, initialAllocation);
 }
 
 void VectorDispose(vector *v)
 {
+  VECTOR_TRACE_CALL(kTraceVectorDispose, v, 0, v->elemSize);
   if(v->freeFn != NULL) {
     for (int i = 0; i < VectorLength(v); i++) {
       v->freeFn(v->data + (v->elemSize * i));
     }
   }
+  ReleaseBuffer(v->data, v->backing, v->allocatedBytes);
+  v->data = NULL;
+  free(v->deadFlags);
+  v->deadFlags = NULL;
+}
+
+static mybool IsDead(const vector *v, int position) {
+  return v->deadFlags != NULL && v->deadFlags[position] ? TRUE : FALSE;
+}
+
+/**
+ * Brings a tombstoned vector back to a dense layout before any operation
+ * that rearranges elements, so those operations never see a dead slot.
+ */
+static void CompactTombstones(vector *v) {
+  if(v->numDeleted > 0) VectorCompact(v);
+}
+
+void VectorEnableTombstones(vector *v, double maxDeadFraction)
+{
+  vector_assert(maxDeadFraction < 0 || maxDeadFraction > 1,
+                "Dead fraction must be between 0 and 1.");
+  v->maxDeadFraction = maxDeadFraction;
+  if(v->deadFlags != NULL) return;
+  v->deadFlags = calloc(v->capacity > 0 ? v->capacity : 1, 1);
+  vector_assert(v->deadFlags == NULL, "Couldn't allocate vector.");
+}
+
+void VectorMarkDeleted(vector *v, int position)
+{
+  AssertInBounds(v, position);
+  vector_assert(v->deadFlags == NULL, "Tombstones are not enabled for this vector.");
+  if(v->deadFlags[position]) return;
+  v->deadFlags[position] = 1;
+  v->numDeleted++;
+  if(v->maxDeadFraction > 0 && v->numDeleted > v->maxDeadFraction * VectorLength(v)) {
+    VectorCompact(v);
+  }
+}
+
+mybool VectorIsDeleted(const vector *v, int position)
+{
+  AssertInBounds(v, position);
+  return IsDead(v, position);
+}
+
+int VectorLiveLength(const vector *v)
+{ return v->logicalSize - v->numDeleted; }
+
+void VectorCompact(vector *v)
+{
+  if(v->numDeleted == 0) return;
+  int kept = 0;
+  for (int i = 0; i < VectorLength(v); i++) {
+    if(v->deadFlags[i]) {
+      if(v->freeFn != NULL) FreeElement(v, i);
+      v->deadFlags[i] = 0;
+    } else {
+      if(kept != i) memcpy(v->data + ((size_t)kept * v->elemSize), v->data + ((size_t)i * v->elemSize), v->elemSize);
+      kept++;
+    }
+  }
+  v->logicalSize = kept;
+  v->numDeleted = 0;
 }
 
 int VectorLength(const vector *v)
@@ -28,58 +253,78 @@ int VectorLength(const vector *v)
 
 void *VectorNth(const vector *v, int position)
 { 
+  VECTOR_TRACE_CALL(kTraceVectorNth, v, position, v->elemSize);
   AssertInBounds(v, position);
-  return v->data + (position * v->elemSize);
+  return ElementAt(v, position);
 }
 
 void VectorReplace(vector *v, const void *elemAddr, int position)
 {
+  VECTOR_TRACE_CALL(kTraceVectorReplace, v, position, v->elemSize);
   AssertInBounds(v, position);
   if(v->freeFn != NULL){
     FreeElement(v, position);
   }
-  memcpy(v->data + (position * v->elemSize), elemAddr, v->elemSize);
+  CopyElement(ElementAt(v, position), elemAddr, v->elemSize);
+  if(IsDead(v, position)) {
+    v->deadFlags[position] = 0;
+    v->numDeleted--;
+  }
 }
 
 void VectorInsert(vector *v, const void *elemAddr, int position)
 {
+  VECTOR_TRACE_CALL(kTraceVectorInsert, v, position, v->elemSize);
   vector_assert((position < 0 || position > VectorLength(v)), "Index out of bounds.");
   if(v->logicalSize >= v->capacity) {
     VectorReallocCapacity(v, 2);
   }
-  void * insertPos = v->data + (position * v->elemSize);
+  void * insertPos = ElementAt(v, position);
   void * nextPos = insertPos + v->elemSize;
-  size_t bytesToMove = (VectorLength(v) - position) * v->elemSize;
+  size_t bytesToMove = (size_t)(VectorLength(v) - position) * v->elemSize;
   memmove(nextPos, insertPos, bytesToMove);
-  memcpy(v->data + (position * v->elemSize), elemAddr, v->elemSize);
+  CopyElement(insertPos, elemAddr, v->elemSize);
+  if(v->deadFlags != NULL) {
+    memmove(v->deadFlags + position + 1, v->deadFlags + position, VectorLength(v) - position);
+    v->deadFlags[position] = 0;
+  }
   v->logicalSize++;
 }
 
 void VectorAppend(vector *v, const void *elemAddr)
 {
+  VECTOR_TRACE_CALL(kTraceVectorAppend, v, v->logicalSize, v->elemSize);
   if(v->logicalSize >= v->capacity) {
     VectorReallocCapacity(v, 2);
   }
-  memcpy(v->data + (v->logicalSize * v->elemSize), elemAddr, v->elemSize);
+  CopyElement(ElementAt(v, v->logicalSize), elemAddr, v->elemSize);
   v->logicalSize++;
 }
 
 void VectorDelete(vector *v, const int position)
 {
+  VECTOR_TRACE_CALL(kTraceVectorDelete, v, position, v->elemSize);
   AssertInBounds(v,  position);
   if(v->freeFn != NULL){
     FreeElement(v, position);
   }
-  void * dest = VectorNth(v, position);
+  void * dest = ElementAt(v, position);
   void * from = dest + v->elemSize;
   size_t bytesToMove = (VectorLength(v) - 1 - position) * v->elemSize;
   memmove(dest, from, bytesToMove);
+  if(v->deadFlags != NULL) {
+    if(v->deadFlags[position]) v->numDeleted--;
+    memmove(v->deadFlags + position, v->deadFlags + position + 1, VectorLength(v) - 1 - position);
+    v->deadFlags[VectorLength(v) - 1] = 0;
+  }
   v->logicalSize--;
 }
 
 void VectorSort(vector *v, VectorCompareFunction compare)
 {
+  VECTOR_TRACE_CALL(kTraceVectorSort, v, 0, v->elemSize);
   vector_assert(compare == NULL, "Failed sort, no compare function provided");
+  CompactTombstones(v);
   qsort(v->data, VectorLength(v), v->elemSize, compare);
 }
 
@@ -87,37 +332,539 @@ void VectorMap(vector *v, VectorMapFunction mapFn, void *auxData)
 {
   vector_assert(mapFn == NULL, "Map function was not provided.");
   for (int i = 0; i < VectorLength(v); i++) {
-    mapFn(VectorNth(v, i), auxData);
+    if(IsDead(v, i)) continue;
+    mapFn(ElementAt(v, i), auxData);
   }	
 
 }
 
 static const int kNotFound = -1;
+
+/**
+ * Binary search for a sorted vector holding tombstones.  Dead slots keep
+ * their values until compaction, so the order is intact; this finds the
+ * first element not less than the key and then steps over any dead slots
+ * among the equal elements that follow.
+ */
+static int SearchSortedLive(const vector *v, const void *key, VectorCompareFunction searchFn) {
+  int lo = 0, hi = VectorLength(v);
+  while(lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if(searchFn(key, ElementAt(v, mid)) > 0) lo = mid + 1;
+    else hi = mid;
+  }
+  for (; lo < VectorLength(v) && searchFn(key, ElementAt(v, lo)) == 0; lo++) {
+    if(!IsDead(v, lo)) return lo;
+  }
+  return kNotFound;
+}
+
 int VectorSearch(const vector *v, const void *key, VectorCompareFunction searchFn, int startIndex, mybool isSorted)
 { 
+	VECTOR_TRACE_CALL(kTraceVectorSearch, v, startIndex, v->elemSize);
 	vector_assert(searchFn == NULL, "Failed to search, no compare function provided.");
 	vector_assert(startIndex < 0 || startIndex >= VectorLength(v), "Failed to search, start index out of bounds.");
-	if(isSorted) {
-          void * result = bsearch(key, VectorNth(v, 0), VectorLength(v), v->elemSize, searchFn);
-	  if(result != NULL) return (result - VectorNth(v, 0)) / v->elemSize;
+	if(isSorted && v->numDeleted > 0) {
+	  return SearchSortedLive(v, key, searchFn);
+	} else if(isSorted) {
+          void * result = bsearch(key, ElementAt(v, 0), VectorLength(v), v->elemSize, searchFn);
+	  if(result != NULL) return (result - ElementAt(v, 0)) / v->elemSize;
 	} else {
 	  for (int i = startIndex; i < VectorLength(v); i++) {
-	    if (searchFn(VectorNth(v, i), key) == 0) return i;
+	    if (IsDead(v, i)) continue;
+	    if (searchFn(ElementAt(v, i), key) == 0) return i;
 	  }
 	}
 	return kNotFound;
-} 
+}
+
+static void VectorReserve(vector *v, int capacity) {
+  if(capacity <= v->capacity) return;
+  VectorResizeBuffer(v, capacity);
+}
+
+static void AppendRange(vector *out, const vector *src, int from, int to) {
+  if(to <= from) return;
+  memcpy(ElementAt(out, out->logicalSize), ElementAt(src, from), (size_t)(to - from) * src->elemSize);
+  out->logicalSize += to - from;
+}
+
+/**
+ * Returns the first position p in [start, length) such that v[p] is not
+ * less than key (or, when inclusive is set, such that v[p] is greater than
+ * key), or length if there is none.  Probes start, start+1, start+2,
+ * start+4, start+8, ... (doubling the offset each time) before binary
+ * searching the last bracket, so the cost is logarithmic in
+ * the distance travelled rather than in the length of the vector.
+ */
+static int Gallop(const vector *v, int start, const void *key,
+                  VectorCompareFunction compare, mybool inclusive) {
+  int length = VectorLength(v);
+  int lo = start, step = 1;
+  int hi = start;
+  while(hi < length) {
+    int cmp = compare(ElementAt(v, hi), key);
+    if(inclusive ? cmp > 0 : cmp >= 0) break;
+    lo = hi + 1;
+    hi = start + step;
+    step *= 2;
+  }
+  if(hi > length) hi = length;
+  while(lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    int cmp = compare(ElementAt(v, mid), key);
+    if(inclusive ? cmp > 0 : cmp >= 0) hi = mid;
+    else lo = mid + 1;
+  }
+  return lo;
+}
+
+static void AssertSetOperands(const vector *a, const vector *b, vector *out,
+                              VectorCompareFunction compare, int resultBound) {
+  vector_assert(compare == NULL, "Failed set operation, no compare function provided.");
+  vector_assert(a->elemSize != b->elemSize || a->elemSize != out->elemSize,
+                "Failed set operation, element sizes differ.");
+  vector_assert(a->numDeleted > 0 || b->numDeleted > 0,
+                "Failed set operation, inputs must be compacted first.");
+  VectorReserve(out, VectorLength(out) + resultBound);
+}
+
+void VectorMergeSorted(const vector *a, const vector *b, vector *out, VectorCompareFunction compare)
+{
+  int lengthA = VectorLength(a), lengthB = VectorLength(b);
+  AssertSetOperands(a, b, out, compare, lengthA + lengthB);
+  int i = 0, j = 0;
+  while(i < lengthA && j < lengthB) {
+    int next = Gallop(b, j, ElementAt(a, i), compare, FALSE);
+    AppendRange(out, b, j, next);
+    j = next;
+    if(j == lengthB) break;
+    next = Gallop(a, i, ElementAt(b, j), compare, TRUE);
+    AppendRange(out, a, i, next);
+    i = next;
+  }
+  AppendRange(out, a, i, lengthA);
+  AppendRange(out, b, j, lengthB);
+}
+
+void VectorUnionSorted(const vector *a, const vector *b, vector *out, VectorCompareFunction compare)
+{
+  int lengthA = VectorLength(a), lengthB = VectorLength(b);
+  AssertSetOperands(a, b, out, compare, lengthA + lengthB);
+  int i = 0, j = 0;
+  while(i < lengthA && j < lengthB) {
+    int next = Gallop(a, i, ElementAt(b, j), compare, FALSE);
+    AppendRange(out, a, i, next);
+    i = next;
+    if(i == lengthA) break;
+    next = Gallop(b, j, ElementAt(a, i), compare, FALSE);
+    AppendRange(out, b, j, next);
+    j = next;
+    if(j == lengthB) break;
+    if(compare(ElementAt(a, i), ElementAt(b, j)) == 0) {
+      AppendRange(out, a, i, i + 1);
+      i++;
+      j++;
+    }
+  }
+  AppendRange(out, a, i, lengthA);
+  AppendRange(out, b, j, lengthB);
+}
+
+void VectorIntersectSorted(const vector *a, const vector *b, vector *out, VectorCompareFunction compare)
+{
+  int lengthA = VectorLength(a), lengthB = VectorLength(b);
+  AssertSetOperands(a, b, out, compare, lengthA < lengthB ? lengthA : lengthB);
+  int i = 0, j = 0;
+  while(i < lengthA && j < lengthB) {
+    i = Gallop(a, i, ElementAt(b, j), compare, FALSE);
+    if(i == lengthA) break;
+    j = Gallop(b, j, ElementAt(a, i), compare, FALSE);
+    if(j == lengthB) break;
+    if(compare(ElementAt(a, i), ElementAt(b, j)) == 0) {
+      AppendRange(out, a, i, i + 1);
+      i++;
+      j++;
+    }
+  }
+}
+
+void VectorDifferenceSorted(const vector *a, const vector *b, vector *out, VectorCompareFunction compare)
+{
+  int lengthA = VectorLength(a), lengthB = VectorLength(b);
+  AssertSetOperands(a, b, out, compare, lengthA);
+  int i = 0, j = 0;
+  while(i < lengthA && j < lengthB) {
+    int next = Gallop(a, i, ElementAt(b, j), compare, FALSE);
+    AppendRange(out, a, i, next);
+    i = next;
+    if(i == lengthA) break;
+    j = Gallop(b, j, ElementAt(a, i), compare, FALSE);
+    if(j == lengthB) break;
+    if(compare(ElementAt(a, i), ElementAt(b, j)) == 0) {
+      i++;
+      j++;
+    }
+  }
+  AppendRange(out, a, i, lengthA);
+}
+
+void VectorUnique(vector *v, VectorCompareFunction compare)
+{
+  vector_assert(compare == NULL, "Failed unique, no compare function provided.");
+  CompactTombstones(v);
+  int length = VectorLength(v);
+  if(length < 2) return;
+  int kept = 0;
+  for (int i = 1; i < length; i++) {
+    if(compare(ElementAt(v, kept), ElementAt(v, i)) == 0) {
+      if(v->freeFn != NULL) FreeElement(v, i);
+    } else if(++kept != i) {
+      memcpy(ElementAt(v, kept), ElementAt(v, i), v->elemSize);
+    }
+  }
+  v->logicalSize = kept + 1;
+}
+
+void VectorSortUnique(vector *v, VectorCompareFunction compare)
+{
+  vector_assert(compare == NULL, "Failed unique, no compare function provided.");
+  VectorSort(v, compare);
+  VectorUnique(v, compare);
+}
+
+static void SwapElements(const vector *v, int i, int j, void *tmp) {
+  memcpy(tmp, ElementAt(v, i), v->elemSize);
+  memcpy(ElementAt(v, i), ElementAt(v, j), v->elemSize);
+  memcpy(ElementAt(v, j), tmp, v->elemSize);
+}
+
+/**
+ * Restores the max-heap property of the heap occupying [base, base + length)
+ * by sinking the element at heap index root below any larger children.
+ */
+static void SiftDownRange(const vector *v, int base, int root, int length,
+                          VectorCompareFunction compare, void *tmp) {
+  while(2 * root + 1 < length) {
+    int child = 2 * root + 1;
+    if(child + 1 < length &&
+       compare(ElementAt(v, base + child), ElementAt(v, base + child + 1)) < 0) child++;
+    if(compare(ElementAt(v, base + root), ElementAt(v, base + child)) >= 0) return;
+    SwapElements(v, base + root, base + child, tmp);
+    root = child;
+  }
+}
+
+/**
+ * Moves the k smallest elements of [lo, hi) to the front of that range,
+ * in ascending order, using a max-heap of size k.
+ */
+static void PartialSortRange(const vector *v, int lo, int hi, int k,
+                             VectorCompareFunction compare, void *tmp) {
+  if(k <= 0) return;
+  for (int root = k / 2 - 1; root >= 0; root--) {
+    SiftDownRange(v, lo, root, k, compare, tmp);
+  }
+  for (int i = lo + k; i < hi; i++) {
+    if(compare(ElementAt(v, i), ElementAt(v, lo)) < 0) {
+      SwapElements(v, lo, i, tmp);
+      SiftDownRange(v, lo, 0, k, compare, tmp);
+    }
+  }
+  for (int end = k - 1; end > 0; end--) {
+    SwapElements(v, lo, lo + end, tmp);
+    SiftDownRange(v, lo, 0, end, compare, tmp);
+  }
+}
+
+static void InsertionSortRange(const vector *v, int lo, int hi,
+                               VectorCompareFunction compare, void *tmp) {
+  for (int i = lo + 1; i <= hi; i++) {
+    int j = i;
+    memcpy(tmp, ElementAt(v, i), v->elemSize);
+    while(j > lo && compare(ElementAt(v, j - 1), tmp) > 0) j--;
+    if(j == i) continue;
+    memmove(ElementAt(v, j + 1), ElementAt(v, j), (size_t)(i - j) * v->elemSize);
+    memcpy(ElementAt(v, j), tmp, v->elemSize);
+  }
+}
+
+static const int kInsertionSortThreshold = 16;
+void VectorNthElement(vector *v, int position, VectorCompareFunction compare)
+{
+  vector_assert(compare == NULL, "Failed selection, no compare function provided.");
+  CompactTombstones(v);
+  AssertInBounds(v, position);
+  char *scratch = malloc(2 * (size_t)v->elemSize);
+  vector_assert(scratch == NULL, "Couldn't allocate scratch space.");
+  void *pivot = scratch, *tmp = scratch + v->elemSize;
+  int lo = 0, hi = VectorLength(v) - 1;
+  int depthLimit = 0;
+  for (int n = VectorLength(v); n > 1; n >>= 1) depthLimit += 2;
+
+  while(hi > lo) {
+    if(hi - lo < kInsertionSortThreshold) {
+      InsertionSortRange(v, lo, hi, compare, tmp);
+      break;
+    }
+    if(depthLimit-- == 0) {
+      PartialSortRange(v, lo, hi + 1, position - lo + 1, compare, tmp);
+      break;
+    }
+    int mid = lo + (hi - lo) / 2;
+    if(compare(ElementAt(v, mid), ElementAt(v, lo)) < 0) SwapElements(v, mid, lo, tmp);
+    if(compare(ElementAt(v, hi), ElementAt(v, lo)) < 0) SwapElements(v, hi, lo, tmp);
+    if(compare(ElementAt(v, hi), ElementAt(v, mid)) < 0) SwapElements(v, hi, mid, tmp);
+    SwapElements(v, lo, mid, tmp);
+    memcpy(pivot, ElementAt(v, lo), v->elemSize);
+
+    int i = lo - 1, j = hi + 1;
+    while(TRUE) {
+      do i++; while(compare(ElementAt(v, i), pivot) < 0);
+      do j--; while(compare(ElementAt(v, j), pivot) > 0);
+      if(i >= j) break;
+      SwapElements(v, i, j, tmp);
+    }
+    if(position <= j) hi = j;
+    else lo = j + 1;
+  }
+  free(scratch);
+}
+
+void VectorPartialSort(vector *v, int k, VectorCompareFunction compare)
+{
+  vector_assert(compare == NULL, "Failed partial sort, no compare function provided.");
+  CompactTombstones(v);
+  vector_assert(k < 0 || k > VectorLength(v), "Failed partial sort, k out of bounds.");
+  void *tmp = malloc(v->elemSize);
+  vector_assert(tmp == NULL, "Couldn't allocate scratch space.");
+  PartialSortRange(v, 0, VectorLength(v), k, compare, tmp);
+  free(tmp);
+}
+
+/**
+ * Sinks value from the hole at position hole down the d-ary heap occupying
+ * [0, length), moving larger children up into the hole rather than swapping,
+ * and finally drops value into the hole where it comes to rest.
+ */
+static void HeapSiftDown(vector *v, int hole, int length, int arity,
+                         VectorCompareFunction compare, const void *value) {
+  while(TRUE) {
+    long first = (long)hole * arity + 1;
+    if(first >= length) break;
+    int last = first + arity < length ? (int)first + arity : length;
+    int best = (int)first;
+    for (int child = best + 1; child < last; child++) {
+      if(compare(ElementAt(v, best), ElementAt(v, child)) < 0) best = child;
+    }
+    if(compare(value, ElementAt(v, best)) >= 0) break;
+    CopyElement(ElementAt(v, hole), ElementAt(v, best), v->elemSize);
+    hole = best;
+  }
+  CopyElement(ElementAt(v, hole), value, v->elemSize);
+}
+
+static void HeapSiftUp(vector *v, int hole, int arity,
+                       VectorCompareFunction compare, const void *value) {
+  while(hole > 0) {
+    int parent = (hole - 1) / arity;
+    if(compare(ElementAt(v, parent), value) >= 0) break;
+    CopyElement(ElementAt(v, hole), ElementAt(v, parent), v->elemSize);
+    hole = parent;
+  }
+  CopyElement(ElementAt(v, hole), value, v->elemSize);
+}
+
+enum { kHeapStackBufferSize = 64 };
+static void *HeapScratch(const vector *v, void *stackBuffer) {
+  if((size_t)v->elemSize <= kHeapStackBufferSize) return stackBuffer;
+  void *scratch = malloc(v->elemSize);
+  vector_assert(scratch == NULL, "Couldn't allocate scratch space.");
+  return scratch;
+}
+
+static void ReleaseHeapScratch(void *scratch, void *stackBuffer) {
+  if(scratch != stackBuffer) free(scratch);
+}
+
+static void AssertHeapArguments(vector *v, int arity, VectorCompareFunction compare) {
+  vector_assert(compare == NULL, "Failed heap operation, no compare function provided.");
+  vector_assert(arity < 2, "Failed heap operation, arity must be at least 2.");
+  CompactTombstones(v);
+}
+
+void VectorHeapifyDary(vector *v, int arity, VectorCompareFunction compare)
+{
+  AssertHeapArguments(v, arity, compare);
+  max_align_t stackBuffer[kHeapStackBufferSize / sizeof(max_align_t)];
+  void *value = HeapScratch(v, stackBuffer);
+  int length = VectorLength(v);
+  for (int i = (length - 2) / arity; i >= 0 && length > 1; i--) {
+    CopyElement(value, ElementAt(v, i), v->elemSize);
+    HeapSiftDown(v, i, length, arity, compare, value);
+  }
+  ReleaseHeapScratch(value, stackBuffer);
+}
+
+void VectorHeapify(vector *v, VectorCompareFunction compare)
+{ VectorHeapifyDary(v, 2, compare); }
+
+void VectorHeapPushDary(vector *v, const void *elemAddr, int arity, VectorCompareFunction compare)
+{
+  AssertHeapArguments(v, arity, compare);
+  if(v->logicalSize >= v->capacity) {
+    VectorReallocCapacity(v, 2);
+  }
+  v->logicalSize++;
+  HeapSiftUp(v, v->logicalSize - 1, arity, compare, elemAddr);
+}
+
+void VectorHeapPush(vector *v, const void *elemAddr, VectorCompareFunction compare)
+{ VectorHeapPushDary(v, elemAddr, 2, compare); }
+
+void VectorHeapPopDary(vector *v, void *elemAddr, int arity, VectorCompareFunction compare)
+{
+  AssertHeapArguments(v, arity, compare);
+  vector_assert(VectorLength(v) == 0, "Failed heap operation, heap is empty.");
+  if(elemAddr != NULL) {
+    CopyElement(elemAddr, ElementAt(v, 0), v->elemSize);
+  } else if(v->freeFn != NULL) {
+    FreeElement(v, 0);
+  }
+  int length = --v->logicalSize;
+  if(length == 0) return;
+  max_align_t stackBuffer[kHeapStackBufferSize / sizeof(max_align_t)];
+  void *value = HeapScratch(v, stackBuffer);
+  CopyElement(value, ElementAt(v, length), v->elemSize);
+  HeapSiftDown(v, 0, length, arity, compare, value);
+  ReleaseHeapScratch(value, stackBuffer);
+}
+
+void VectorHeapPop(vector *v, void *elemAddr, VectorCompareFunction compare)
+{ VectorHeapPopDary(v, elemAddr, 2, compare); }
+
+void *VectorHeapTop(const vector *v)
+{
+  vector_assert(VectorLength(v) == 0, "Failed heap operation, heap is empty.");
+  return v->data;
+}
+
+typedef struct {
+  const char *str;
+  uint64_t key;
+  int position;           // of the element the string came from
+} StringSortEntry;
+
+/**
+ * Packs the (up to) eight characters of s starting at depth into a
+ * big-endian integer, zero-padded past the terminator, so that comparing
+ * keys as integers agrees with strcmp on those characters.
+ */
+static uint64_t LoadStringKey(const char *s, int depth) {
+  uint64_t key = 0;
+  for (int i = 0; i < 8; i++) {
+    unsigned char ch = (unsigned char)s[depth + i];
+    if(ch == '\0') break;
+    key |= (uint64_t)ch << (56 - 8 * i);
+  }
+  return key;
+}
+
+static void SwapStringEntries(StringSortEntry *a, StringSortEntry *b) {
+  StringSortEntry tmp = *a;
+  *a = *b;
+  *b = tmp;
+}
+
+static const int kStringInsertionThreshold = 12;
+static void MultikeyQuicksort(StringSortEntry *entries, int n, int depth) {
+  while(n > 1) {
+    if(n < kStringInsertionThreshold) {
+      for (int i = 1; i < n; i++) {
+        for (int j = i; j > 0; j--) {
+          StringSortEntry *prev = &entries[j - 1], *cur = &entries[j];
+          if(prev->key < cur->key) break;
+          if(prev->key == cur->key && strcmp(prev->str + depth, cur->str + depth) <= 0) break;
+          SwapStringEntries(prev, cur);
+        }
+      }
+      return;
+    }
+
+    uint64_t a = entries[0].key, b = entries[n / 2].key, c = entries[n - 1].key;
+    uint64_t pivot = a < b ? (b < c ? b : (a < c ? c : a)) : (a < c ? a : (b < c ? c : b));
+    int lt = 0, i = 0, gt = n - 1;
+    while(i <= gt) {
+      if(entries[i].key < pivot) SwapStringEntries(&entries[lt++], &entries[i++]);
+      else if(entries[i].key > pivot) SwapStringEntries(&entries[i], &entries[gt--]);
+      else i++;
+    }
+
+    MultikeyQuicksort(entries, lt, depth);
+    if((pivot & 0xff) != 0) {
+      for (int k = lt; k <= gt; k++) entries[k].key = LoadStringKey(entries[k].str, depth + 8);
+      MultikeyQuicksort(entries + lt, gt - lt + 1, depth + 8);
+    }
+    entries += gt + 1;
+    n -= gt + 1;
+  }
+}
+
+void VectorSortStrings(vector *v)
+{
+  vector_assert(v->elemSize < (int)sizeof(char *), "Failed string sort, elements are not char *s.");
+  CompactTombstones(v);
+  int length = VectorLength(v);
+  if(length < 2) return;
+  StringSortEntry *entries = malloc((size_t)length * sizeof(StringSortEntry));
+  vector_assert(entries == NULL, "Couldn't allocate scratch space.");
+  for (int i = 0; i < length; i++) {
+    entries[i].str = *(char **)ElementAt(v, i);
+    entries[i].key = LoadStringKey(entries[i].str, 0);
+    entries[i].position = i;
+  }
+  MultikeyQuicksort(entries, length, 0);
+  if(v->elemSize == sizeof(char *)) {
+    char **strings = v->data;
+    for (int i = 0; i < length; i++) strings[i] = (char *)entries[i].str;
+  } else {
+    // Records are moved whole, by way of a copy in sorted order.
+    char *sorted = malloc((size_t)length * v->elemSize);
+    vector_assert(sorted == NULL, "Couldn't allocate scratch space.");
+    for (int i = 0; i < length; i++) {
+      memcpy(sorted + (size_t)i * v->elemSize, ElementAt(v, entries[i].position), v->elemSize);
+    }
+    memcpy(v->data, sorted, (size_t)length * v->elemSize);
+    free(sorted);
+  }
+  free(entries);
+}
+
+void VectorGetStats(const vector *v, VectorStats *stats)
+{
+  stats->length = VectorLength(v);
+  stats->capacity = v->capacity;
+  stats->elemSize = v->elemSize;
+  stats->bytesAllocated = v->allocatedBytes;
+  stats->backing = v->backing;
+  switch(v->backing) {
+    case kVectorBackingHeap: stats->alignment = _Alignof(max_align_t); break;
+    case kVectorBackingAligned:
+      stats->alignment = v->alignment > (int)sizeof(void *) ? (size_t)v->alignment : sizeof(void *);
+      break;
+    case kVectorBackingTransparentHugePages: stats->alignment = kMappedPageSize; break;
+    case kVectorBackingHugeTLB: stats->alignment = kHugePageSize; break;
+  }
+}
 
 static void VectorReallocCapacity(vector *v, int factor) {
-  int newCapacity = (v->logicalSize || 1)* factor;
-  v->data = realloc(v->data, newCapacity * v->elemSize);
-  vector_assert(v->data == NULL, "Couln't reallocate vector.");
-  v->capacity = newCapacity;
+  int newCapacity = (v->logicalSize > 0 ? v->logicalSize : 1) * factor;
+  VectorResizeBuffer(v, newCapacity);
 };
 
 static void AssertInBounds(const vector *v, const int position) {
   int vectorLength = VectorLength(v);
-  vector_assert((vectorLength < 0 || position >= vectorLength), "Index out of bounds.");
+  vector_assert((position < 0 || position >= vectorLength), "Index out of bounds.");
 } 
 
 static void FreeElement(const vector *v, const int position) {
@@ -17,6 +17,7 @@
 #define _vector_
 
 #include "bool.h"
+#include <stddef.h>
 
 /**
  * Type: VectorCompareFunction
@@ -57,6 +58,21 @@ typedef void (*VectorMapFunction)(void *elemAddr, void *auxData);
 
 typedef void (*VectorFreeFunction)(void *elemAddr);
 
+/**
+ * Type: VectorBacking
+ * -------------------
+ * Identifies where a vector's element buffer currently lives: the ordinary
+ * malloc heap, an aligned heap block, an anonymous mapping advised to use
+ * transparent huge pages, or an explicit (hugetlbfs) huge-page mapping.
+ */
+
+typedef enum {
+  kVectorBackingHeap,
+  kVectorBackingAligned,
+  kVectorBackingTransparentHugePages,
+  kVectorBackingHugeTLB
+} VectorBacking;
+
 /**
  * Type: vector
  * ------------
@@ -75,6 +91,14 @@ typedef struct {
 	int elemSize;
 	int capacity;
 	VectorFreeFunction freeFn;
+	int alignment;
+	mybool allowHugePages;
+	VectorBacking backing;
+	size_t allocatedBytes;
+	unsigned char *deadFlags;
+	int numDeleted;
+	double maxDeadFraction;
+	mybool untraced;        // TRUE for vectors made with VectorNewUntraced
 } vector;
 
 /**
@@ -131,6 +155,43 @@ typedef struct {
 void VectorNew(vector *v, int elemSize, VectorFreeFunction freefn,
                int initialAllocation);
 
+/**
+ * Function: VectorNewUntraced
+ * ---------------------------
+ * Behaves just like VectorNew, except that no call on the vector, from this
+ * one to its VectorDispose, is ever written to a container trace (see
+ * containertrace.h).  The library's own containers build their internal
+ * storage this way, so a trace of a client program holds only the vector
+ * calls the client made.  A client may do the same for vectors it wants
+ * kept out of its traces.
+ */
+
+void VectorNewUntraced(vector *v, int elemSize, VectorFreeFunction freefn,
+                       int initialAllocation);
+
+/**
+ * Function: VectorNewAligned
+ * Usage: vector samples;
+ *        VectorNewAligned(&samples, sizeof(float), NULL, 1 << 20, 64, TRUE);
+ * --------------------------
+ * Behaves just like VectorNew, except that the element buffer is always
+ * aligned to at least alignment bytes (so SIMD kernels can use aligned loads,
+ * or so that element 0 starts a cache line), and that, if allowHugePages is
+ * TRUE, any buffer of at least 2MB is mapped on huge pages to cut TLB misses
+ * on very large vectors.  An explicit hugetlbfs mapping is tried first; if
+ * none is available, an ordinary mapping advised with MADV_HUGEPAGE is used.
+ * Where neither is supported the vector quietly falls back to an aligned
+ * heap block, as it does when alignment exceeds the 4KB page size.
+ * VectorGetStats reports which backing was chosen.
+ *
+ * An assert is raised if alignment is not a power of two, in addition to the
+ * conditions checked by VectorNew.  Growing an aligned vector copies the
+ * elements into a new buffer rather than calling realloc.
+ */
+
+void VectorNewAligned(vector *v, int elemSize, VectorFreeFunction freefn,
+                      int initialAllocation, int alignment, mybool allowHugePages);
+
 /**
  * Function: VectorDispose
  *           VectorDispose(&studentsDroppingTheCourse);
@@ -279,6 +340,281 @@ void VectorSort(vector *v, VectorCompareFunction comparefn);
 
 void VectorMap(vector *v, VectorMapFunction mapfn, void *auxData);
 
+/**
+ * Function: VectorEnableTombstones
+ * --------------------------------
+ * Switches the vector into lazy-deletion mode, in which VectorMarkDeleted
+ * can retire an element in constant time by setting a tombstone on its slot
+ * rather than shifting everything after it.  Tombstoned slots keep their
+ * positions (and their contents) until the vector is compacted: VectorLength
+ * still counts them and VectorNth still reaches them, but VectorMap and
+ * VectorSearch skip over them.  Operations that rearrange the elements
+ * (sorting, deduplication, selection, the heap functions) compact the vector
+ * first, and the sorted set operations require compacted inputs.
+ *
+ * If maxDeadFraction is greater than zero, the vector compacts itself as
+ * soon as more than that fraction of its slots are dead; note that positions
+ * then shift, just as they would after the equivalent VectorDelete calls.  A
+ * maxDeadFraction of zero leaves compaction entirely to VectorCompact.
+ * Calling this again on a tombstoned vector just updates the fraction.  An
+ * assert is raised if maxDeadFraction is outside [0, 1].
+ */
+
+void VectorEnableTombstones(vector *v, double maxDeadFraction);
+
+/**
+ * Function: VectorMarkDeleted
+ * ---------------------------
+ * Sets a tombstone on the element at the specified position in constant
+ * time.  The VectorFreeFunction is not called until the slot is reclaimed by
+ * compaction (or the vector is disposed of).  Marking an already dead slot
+ * has no effect.  An assert is raised if position is out of bounds or if
+ * tombstones have not been enabled.
+ */
+
+void VectorMarkDeleted(vector *v, int position);
+
+/**
+ * Function: VectorIsDeleted
+ * -------------------------
+ * Returns TRUE if the slot at the specified position holds a tombstone.
+ * An assert is raised if position is out of bounds.
+ */
+
+mybool VectorIsDeleted(const vector *v, int position);
+
+/**
+ * Function: VectorLiveLength
+ * --------------------------
+ * Returns the number of elements that are not tombstoned.  For a vector
+ * without tombstones this is the same as VectorLength.
+ */
+
+int VectorLiveLength(const vector *v);
+
+/**
+ * Function: VectorCompact
+ * -----------------------
+ * Reclaims every tombstoned slot in one linear pass, calling the
+ * VectorFreeFunction on each dead element and sliding the live elements
+ * down in order.  Does nothing if no slot is dead.
+ */
+
+void VectorCompact(vector *v);
+
+/**
+ * Function: VectorMergeSorted
+ * Usage: vector all;
+ *        VectorNew(&all, sizeof(int), NULL, 0);
+ *        VectorMergeSorted(&evens, &odds, &all, CompareInts);
+ * ---------------------------
+ * Merges two vectors, each already sorted according to comparefn, appending
+ * every element of both to the output vector in sorted order.  The merge is
+ * stable: when elements compare equal, those from a come before those from b.
+ *
+ * The four sorted-vector operations (this one and the three below) share the
+ * same contract.  The output must have been initialized with VectorNew using
+ * the same element size as both inputs, and it must not be either input.  Its
+ * capacity is grown once, up front, to hold the largest possible result, and
+ * the results are then appended in a single linear pass.  Elements are copied
+ * bytewise, so if the inputs own embedded pointers the output should be
+ * created with a NULL VectorFreeFunction.  Runs of consecutive elements taken
+ * from the same input are located with a galloping (exponential) search and
+ * copied in bulk, so merging a short vector into a long one costs close to
+ * O(m log(n/m)) comparisons rather than O(m + n).
+ *
+ * An assert is raised if the comparator is NULL or the element sizes differ.
+ */
+
+void VectorMergeSorted(const vector *a, const vector *b, vector *out,
+                       VectorCompareFunction comparefn);
+
+/**
+ * Function: VectorUnionSorted
+ * ---------------------------
+ * Appends the sorted union of a and b to the output vector.  An element that
+ * appears in both inputs is emitted once, taken from a.  If an input holds
+ * repeated elements, each copy is matched against at most one copy in the
+ * other input, as with the C++ std::set_union.
+ */
+
+void VectorUnionSorted(const vector *a, const vector *b, vector *out,
+                       VectorCompareFunction comparefn);
+
+/**
+ * Function: VectorIntersectSorted
+ * -------------------------------
+ * Appends the elements of a that also appear in b, in sorted order.
+ */
+
+void VectorIntersectSorted(const vector *a, const vector *b, vector *out,
+                           VectorCompareFunction comparefn);
+
+/**
+ * Function: VectorDifferenceSorted
+ * --------------------------------
+ * Appends the elements of a that do not appear in b, in sorted order.
+ */
+
+void VectorDifferenceSorted(const vector *a, const vector *b, vector *out,
+                            VectorCompareFunction comparefn);
+
+/**
+ * Function: VectorUnique
+ * ----------------------
+ * Removes consecutive duplicate elements from the vector in a single linear
+ * pass, keeping the first element of every run of elements that compare
+ * equal under comparefn.  The VectorFreeFunction supplied to VectorNew is
+ * called on each element that is dropped, and the survivors are shifted down
+ * to close the gaps.  Only adjacent duplicates are detected, so the vector
+ * is normally sorted first (see VectorSortUnique).  The allocated size of
+ * the vector is left untouched.  An assert is raised if the comparator is
+ * NULL.
+ */
+
+void VectorUnique(vector *v, VectorCompareFunction comparefn);
+
+/**
+ * Function: VectorSortUnique
+ * --------------------------
+ * Sorts the vector and then removes duplicates, leaving exactly one element
+ * from each class of equal elements, in ascending order.  Runs in
+ * O(n log n) time.  Since the sort is not stable, which of several equal
+ * elements survives is unspecified.  An assert is raised if the comparator
+ * is NULL.
+ */
+
+void VectorSortUnique(vector *v, VectorCompareFunction comparefn);
+
+/**
+ * Function: VectorNthElement
+ * --------------------------
+ * Partially reorders the vector so that the element at position is the one
+ * that would be there if the whole vector were sorted with comparefn.  Every
+ * element before it compares less than or equal to it, and every element
+ * after it compares greater than or equal to it; otherwise the order is
+ * unspecified.  Uses introselect: quickselect with a median-of-three pivot,
+ * falling back to heap selection if partitioning degenerates, so it runs in
+ * expected linear time and never worse than O(n log n).  An assert is raised
+ * if the comparator is NULL or position is out of bounds.
+ */
+
+void VectorNthElement(vector *v, int position, VectorCompareFunction comparefn);
+
+/**
+ * Function: VectorPartialSort
+ * ---------------------------
+ * Rearranges the vector so that its first k elements are the k smallest
+ * under comparefn, in ascending order.  The order of the remaining elements
+ * is unspecified.  A bounded heap of k elements is used, so the cost is
+ * O(n log k), which makes "top 100 of several million" far cheaper than a
+ * full VectorSort.  An assert is raised if the comparator is NULL or k is
+ * less than 0 or greater than the logical length.
+ */
+
+void VectorPartialSort(vector *v, int k, VectorCompareFunction comparefn);
+
+/**
+ * Function: VectorHeapify
+ * -----------------------
+ * Rearranges the vector in place into a binary heap ordered by comparefn,
+ * so that VectorHeapTop is an element comparing greater than or equal to
+ * every other (pass a reversed comparator for a min-heap).  Runs in linear
+ * time.  An assert is raised if the comparator is NULL.
+ *
+ * The heap functions let an ordinary vector act as a priority queue: once
+ * heapified, elements should only be added and removed with VectorHeapPush
+ * and VectorHeapPop, which each cost O(log n) instead of re-sorting.  Each
+ * has a Dary variant taking the branching factor of the heap; wider heaps
+ * are shallower and visit sibling elements that share cache lines, which
+ * tends to pay off for large heaps with cheap comparators.  The same arity
+ * must be used for every call on a given heap.  The binary versions are
+ * equivalent to passing an arity of 2.
+ */
+
+void VectorHeapify(vector *v, VectorCompareFunction comparefn);
+void VectorHeapifyDary(vector *v, int arity, VectorCompareFunction comparefn);
+
+/**
+ * Function: VectorHeapPush
+ * ------------------------
+ * Appends a copy of the element at elemAddr to the heap and restores the
+ * heap order.  An assert is raised if the comparator is NULL.
+ */
+
+void VectorHeapPush(vector *v, const void *elemAddr, VectorCompareFunction comparefn);
+void VectorHeapPushDary(vector *v, const void *elemAddr, int arity,
+                        VectorCompareFunction comparefn);
+
+/**
+ * Function: VectorHeapPop
+ * -----------------------
+ * Removes the top element of the heap and restores the heap order.  If
+ * elemAddr is non-NULL the removed element is copied there and ownership of
+ * anything it points to passes to the client; if elemAddr is NULL the
+ * VectorFreeFunction is levied against it instead.  An assert is raised if
+ * the heap is empty or the comparator is NULL.
+ */
+
+void VectorHeapPop(vector *v, void *elemAddr, VectorCompareFunction comparefn);
+void VectorHeapPopDary(vector *v, void *elemAddr, int arity,
+                       VectorCompareFunction comparefn);
+
+/**
+ * Function: VectorHeapTop
+ * -----------------------
+ * Returns a pointer to the top element of the heap, which is simply the
+ * first element of the vector.  The same caveats as for VectorNth apply.
+ * An assert is raised if the heap is empty.
+ */
+
+void *VectorHeapTop(const vector *v);
+
+/**
+ * Function: VectorSortStrings
+ * ---------------------------
+ * Sorts a vector whose elements are C strings (char *s) into the same order
+ * VectorSort would produce with a strcmp-based comparator, but without going
+ * through qsort.  The strings are sorted with a multikey quicksort over
+ * cached 8-byte big-endian key prefixes: each partitioning pass compares
+ * eight characters at once using integers held alongside the pointers, and
+ * strings that tie on a prefix move on to the next eight characters rather
+ * than rescanning the shared prefix.  Only the pointers are rearranged; the
+ * strings themselves are untouched.
+ *
+ * The elements may also be records whose first field is the char * to sort
+ * by, so that data kept alongside each string (its length, say) moves with
+ * it.  An assert is raised if the element size is less than sizeof(char *).
+ */
+
+void VectorSortStrings(vector *v);
+
+/**
+ * Type: VectorStats
+ * -----------------
+ * A snapshot of a vector's memory use: logical length, allocated capacity
+ * (both in elements), element size, the number of bytes actually reserved
+ * for the buffer (which may be rounded up to a huge-page multiple), the
+ * alignment the buffer is guaranteed to have, and its backing.
+ */
+
+typedef struct {
+  int length;
+  int capacity;
+  int elemSize;
+  size_t bytesAllocated;
+  size_t alignment;
+  VectorBacking backing;
+} VectorStats;
+
+/**
+ * Function: VectorGetStats
+ * ------------------------
+ * Fills in stats with the current memory statistics of the vector.
+ */
+
+void VectorGetStats(const vector *v, VectorStats *stats);
+
 static void VectorReallocCapacity(vector *v, int factor);
 
 static void AssertInBounds(const vector *v, const int position); 
@@ -0,0 +1,139 @@
+#include "vector.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * File: vector_bench.c
+ * --------------------
+ * Microbenchmark for the element-size-specialized copies in the vector.
+ * For each element size it times VectorAppend, VectorReplace and VectorNth
+ * against a baseline that does what those calls did before the switch: a
+ * memcpy of a runtime length at an offset computed with a multiply.
+ *
+ * The containers are small enough to stay in cache, so the figures show the
+ * cost of the calls themselves rather than of memory traffic.
+ *
+ *   vector_bench [elements, a power of two]
+ */
+
+static const int kDefaultElements = 4096;
+static const int kCallsPerRun = 1 << 22;
+static const int kRepetitions = 5;
+static const int kElemSizes[] = { 1, 2, 4, 8, 16, 32, 12, 24 };
+
+typedef struct {
+  char *data;
+  int elemSize;
+  int length;
+  int capacity;
+  VectorFreeFunction freeFn;
+  unsigned char *deadFlags;
+} RawArray;
+
+static double NowSeconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * The baseline calls.  They make the same checks as the library calls they
+ * stand in for, and are kept out of line so that, like those calls, the
+ * compiler can't see the element size.
+ */
+
+__attribute__((noinline)) static void RawAppend(RawArray *a, const void *elemAddr) {
+  if (a->length >= a->capacity) abort();
+  memcpy(a->data + a->length * a->elemSize, elemAddr, a->elemSize);
+  a->length++;
+}
+
+__attribute__((noinline)) static void RawReplace(RawArray *a, const void *elemAddr, int position) {
+  if (position < 0 || position >= a->length) abort();
+  if (a->freeFn != NULL) a->freeFn(a->data + position * a->elemSize);
+  memcpy(a->data + position * a->elemSize, elemAddr, a->elemSize);
+  if (a->deadFlags != NULL && a->deadFlags[position]) a->deadFlags[position] = 0;
+}
+
+__attribute__((noinline)) static void *RawNth(const RawArray *a, int position) {
+  if (position < 0 || position >= a->length) abort();
+  return a->data + position * a->elemSize;
+}
+
+/**
+ * Function: BenchElemSize
+ * -----------------------
+ * Times the three operations at one element size and prints nanoseconds per
+ * call for the baseline and the vector side by side.  A run makes about
+ * kCallsPerRun calls of each kind over a container of n elements, and each
+ * figure is the best of kRepetitions runs.  Both containers are sized and touched before
+ * the first run, so the append figures measure the copy rather than growth
+ * or page faults.
+ */
+
+static void BenchElemSize(int elemSize, int n) {
+  unsigned char elem[64];
+  memset(elem, 0x5a, sizeof(elem));
+  double best[6] = { 1e9, 1e9, 1e9, 1e9, 1e9, 1e9 };
+  uintptr_t sink = 0;
+  RawArray raw = { malloc((size_t)n * elemSize), elemSize, 0, n, NULL, NULL };
+  memset(raw.data, 0, (size_t)n * elemSize);
+  vector v;
+  VectorNew(&v, elemSize, NULL, n);
+  for (int i = 0; i < n; i++) VectorAppend(&v, elem);
+
+  int rounds = kCallsPerRun / n > 0 ? kCallsPerRun / n : 1;
+  for (int rep = 0; rep < kRepetitions; rep++) {
+    double t[7] = { 0 };
+    for (int r = 0; r < rounds; r++) {
+      raw.length = 0;
+      while (VectorLength(&v) > 0) VectorDelete(&v, VectorLength(&v) - 1);
+      double start = NowSeconds();
+      for (int i = 0; i < n; i++) RawAppend(&raw, elem);
+      double end = NowSeconds();
+      t[1] += end - start;
+      for (int i = 0; i < n; i++) VectorAppend(&v, elem);
+      start = NowSeconds();
+      t[2] += start - end;
+      for (int i = 0; i < n; i++) RawReplace(&raw, elem, (i * 7) & (n - 1));
+      end = NowSeconds();
+      t[3] += end - start;
+      for (int i = 0; i < n; i++) VectorReplace(&v, elem, (i * 7) & (n - 1));
+      start = NowSeconds();
+      t[4] += start - end;
+      for (int i = 0; i < n; i++) sink += *(unsigned char *)RawNth(&raw, i);
+      end = NowSeconds();
+      t[5] += end - start;
+      for (int i = 0; i < n; i++) sink += *(unsigned char *)VectorNth(&v, i);
+      t[6] += NowSeconds() - end;
+    }
+    for (int k = 0; k < 6; k++) {
+      double perCall = t[k + 1] * 1e9 / ((double)n * rounds);
+      if (perCall < best[k]) best[k] = perCall;
+    }
+  }
+  VectorDispose(&v);
+  free(raw.data);
+  printf("%8d %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f%s\n", elemSize,
+         best[0], best[1], best[2], best[3], best[4], best[5], sink == 1 ? " " : "");
+}
+
+int main(int argc, char **argv) {
+  int n = argc > 1 ? atoi(argv[1]) : kDefaultElements;
+  if (n <= 0 || (n & (n - 1)) != 0) {
+    fprintf(stderr, "usage: %s [elements-per-run, a power of two]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  printf("ns per call, best of %d runs over %d elements\n", kRepetitions, n);
+  printf("%8s %10s %10s %10s %10s %10s %10s\n", "elemSize",
+         "append", "Append", "replace", "Replace", "nth", "Nth");
+  printf("%8s %10s %10s %10s %10s %10s %10s\n", "",
+         "baseline", "vector", "baseline", "vector", "baseline", "vector");
+  for (size_t s = 0; s < sizeof(kElemSizes) / sizeof(kElemSizes[0]); s++) {
+    BenchElemSize(kElemSizes[s], n);
+  }
+  return 0;
+}
@@ -0,0 +1,248 @@
+#include "vectorpipeline.h"
+#include "vector_error.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { kStackScratchBytes = 256 };
+static const int kMinElementsPerThread = 4096;
+static const size_t kCacheLineSize = 64;
+
+typedef enum {
+  kStageTransform,
+  kStageFilter
+} VectorPipelineStageKind;
+
+typedef struct {
+  VectorPipelineStageKind kind;
+  VectorTransformFunction transformFn;
+  VectorFilterFunction filterFn;
+  void *auxData;
+} VectorPipelineStage;
+
+/**
+ * Type: PipelineSink
+ * ------------------
+ * Where the elements leaving the last stage go: a reduction into an
+ * accumulator or an append onto a vector.
+ */
+
+typedef void (*PipelineSinkFunction)(void *sinkData, const void *elemAddr);
+
+typedef struct {
+  void *accumulatorAddr;
+  VectorReduceFunction reduceFn;
+  void *auxData;
+} ReduceSink;
+
+static void ReduceIntoSink(void *sinkData, const void *elemAddr) {
+  ReduceSink *sink = sinkData;
+  sink->reduceFn(sink->accumulatorAddr, elemAddr, sink->auxData);
+}
+
+static void AppendToSink(void *sinkData, const void *elemAddr) {
+  VectorAppend(sinkData, elemAddr);
+}
+
+/**
+ * Type: PipelinePass
+ * ------------------
+ * Everything a fused pass needs, looked up once on the calling thread so
+ * that worker threads never call back into the vector: the address of the
+ * source's first element, the stage array and, if the source holds any
+ * tombstones, its dead flags.
+ */
+
+typedef struct {
+  const vectorpipeline *p;
+  const char *base;
+  const VectorPipelineStage *stages;
+  int numStages;
+  const unsigned char *deadFlags;   // NULL when no element is tombstoned
+} PipelinePass;
+
+/**
+ * Prepares a pass over a pipeline whose source is not empty.
+ */
+static void PreparePass(const vectorpipeline *p, PipelinePass *pass) {
+  pass->p = p;
+  pass->base = VectorNth(p->source, 0);
+  pass->numStages = VectorLength(&p->stages);
+  pass->stages = pass->numStages > 0 ? VectorNth(&p->stages, 0) : NULL;
+  pass->deadFlags = VectorLiveLength(p->source) != VectorLength(p->source) ? p->source->deadFlags : NULL;
+}
+
+/**
+ * The fused pass over source positions [from, to).  Each element is carried
+ * through the stages in place, each transform writing into whichever half
+ * of the scratch buffer the previous one didn't, and whatever survives the
+ * last stage goes to the sink.
+ */
+static void RunStages(const PipelinePass *pass, int from, int to, char *scratch,
+                      PipelineSinkFunction sinkFn, void *sinkData) {
+  const VectorPipelineStage *stages = pass->stages;
+  int srcSize = pass->p->source->elemSize;
+  int maxElemSize = pass->p->maxElemSize;
+  const char *src = pass->base + (size_t)from * srcSize;
+  for (int i = from; i < to; i++, src += srcSize) {
+    if (pass->deadFlags != NULL && pass->deadFlags[i]) continue;
+    const void *elem = src;
+    int half = 0;
+    mybool kept = TRUE;
+    for (int s = 0; s < pass->numStages && kept; s++) {
+      if (stages[s].kind == kStageFilter) {
+        kept = stages[s].filterFn(elem, stages[s].auxData);
+      } else {
+        void *dest = scratch + half * maxElemSize;
+        stages[s].transformFn(dest, elem, stages[s].auxData);
+        elem = dest;
+        half ^= 1;
+      }
+    }
+    if (kept) sinkFn(sinkData, elem);
+  }
+}
+
+/**
+ * Runs [from, to) through the pipeline with scratch space for two elements
+ * of the largest transformed size, on the stack when it fits.
+ */
+static void RunPass(const PipelinePass *pass, int from, int to,
+                    PipelineSinkFunction sinkFn, void *sinkData) {
+  max_align_t stackBuffer[kStackScratchBytes / sizeof(max_align_t)];
+  char *scratch = (char *)stackBuffer;
+  if (2 * pass->p->maxElemSize > kStackScratchBytes) {
+    scratch = malloc(2 * (size_t)pass->p->maxElemSize);
+    vector_assert(scratch == NULL, "Couldn't allocate scratch space.");
+  }
+  RunStages(pass, from, to, scratch, sinkFn, sinkData);
+  if (scratch != (char *)stackBuffer) free(scratch);
+}
+
+/**
+ * Runs the whole source through the pipeline on the calling thread.
+ */
+static void RunPipelineSerially(const vectorpipeline *p, PipelineSinkFunction sinkFn, void *sinkData) {
+  int length = VectorLength(p->source);
+  if (length == 0) return;
+  PipelinePass pass;
+  PreparePass(p, &pass);
+  RunPass(&pass, 0, length, sinkFn, sinkData);
+}
+
+void VectorPipelineNew(vectorpipeline *p, const vector *source)
+{
+  p->source = source;
+  VectorNewUntraced(&p->stages, sizeof(VectorPipelineStage), NULL, 4);
+  p->elemSize = source->elemSize;
+  p->maxElemSize = 0;
+}
+
+void VectorPipelineDispose(vectorpipeline *p)
+{
+  VectorDispose(&p->stages);
+}
+
+void VectorPipelineTransform(vectorpipeline *p, VectorTransformFunction transformFn,
+                             int outElemSize, void *auxData)
+{
+  vector_assert(transformFn == NULL, "Failed pipeline, no transform function provided.");
+  vector_assert(outElemSize <= 0, "Element size must be greater than zero.");
+  VectorPipelineStage stage = { kStageTransform, transformFn, NULL, auxData };
+  VectorAppend(&p->stages, &stage);
+  p->elemSize = outElemSize;
+  // Both halves of the scratch buffer must be aligned for any element type,
+  // so the second half starts at a multiple of the strictest alignment.
+  int alignment = (int)_Alignof(max_align_t);
+  int stride = (outElemSize + alignment - 1) / alignment * alignment;
+  if (stride > p->maxElemSize) p->maxElemSize = stride;
+}
+
+void VectorPipelineFilter(vectorpipeline *p, VectorFilterFunction filterFn, void *auxData)
+{
+  vector_assert(filterFn == NULL, "Failed pipeline, no filter function provided.");
+  VectorPipelineStage stage = { kStageFilter, NULL, filterFn, auxData };
+  VectorAppend(&p->stages, &stage);
+}
+
+void VectorPipelineReduce(vectorpipeline *p, void *accumulatorAddr,
+                          VectorReduceFunction reduceFn, void *auxData)
+{
+  vector_assert(reduceFn == NULL, "Failed pipeline, no reduce function provided.");
+  ReduceSink sink = { accumulatorAddr, reduceFn, auxData };
+  RunPipelineSerially(p, ReduceIntoSink, &sink);
+}
+
+/**
+ * Type: ReduceTask
+ * ----------------
+ * One thread's share of a parallel reduce: its range of the source and the
+ * sink that owns its private accumulator.
+ */
+
+typedef struct {
+  const PipelinePass *pass;
+  int from;
+  int to;
+  ReduceSink sink;
+} ReduceTask;
+
+static void *RunReduceTask(void *taskAddr) {
+  ReduceTask *task = taskAddr;
+  RunPass(task->pass, task->from, task->to, ReduceIntoSink, &task->sink);
+  return NULL;
+}
+
+void VectorPipelineReduceParallel(vectorpipeline *p, void *accumulatorAddr, int accumulatorSize,
+                                  VectorReduceFunction reduceFn, VectorCombineFunction combineFn,
+                                  void *auxData, int numThreads)
+{
+  vector_assert(reduceFn == NULL || combineFn == NULL,
+                "Failed pipeline, no reduce function provided.");
+  vector_assert(accumulatorSize <= 0, "Accumulator size must be greater than zero.");
+  vector_assert(numThreads < 1, "Thread count must be at least one.");
+  int length = VectorLength(p->source);
+  if (numThreads > length / kMinElementsPerThread) numThreads = length / kMinElementsPerThread;
+  if (numThreads <= 1) {
+    VectorPipelineReduce(p, accumulatorAddr, reduceFn, auxData);
+    return;
+  }
+
+  // Each partial gets its own cache line so the threads don't contend.
+  size_t stride = (accumulatorSize + kCacheLineSize - 1) / kCacheLineSize * kCacheLineSize;
+  char *partials = aligned_alloc(kCacheLineSize, (size_t)numThreads * stride);
+  PipelinePass pass;
+  PreparePass(p, &pass);
+  ReduceTask *tasks = malloc(numThreads * sizeof(ReduceTask));
+  pthread_t *threads = malloc(numThreads * sizeof(pthread_t));
+  vector_assert(partials == NULL || tasks == NULL || threads == NULL,
+                "Couldn't allocate parallel reduce.");
+  for (int t = 0; t < numThreads; t++) {
+    char *partial = partials + t * stride;
+    memcpy(partial, accumulatorAddr, accumulatorSize);
+    ReduceTask task = { &pass, (int)((long long)length * t / numThreads),
+                        (int)((long long)length * (t + 1) / numThreads),
+                        { partial, reduceFn, auxData } };
+    tasks[t] = task;
+  }
+  // The calling thread takes the first range itself.
+  for (int t = 1; t < numThreads; t++) {
+    vector_assert(pthread_create(&threads[t], NULL, RunReduceTask, &tasks[t]) != 0,
+                  "Couldn't start reduce thread.");
+  }
+  RunReduceTask(&tasks[0]);
+  for (int t = 1; t < numThreads; t++) pthread_join(threads[t], NULL);
+
+  for (int t = 0; t < numThreads; t++) {
+    combineFn(accumulatorAddr, partials + t * stride, auxData);
+  }
+  free(partials);
+  free(tasks);
+  free(threads);
+}
+
+void VectorPipelineCollect(vectorpipeline *p, vector *out)
+{
+  vector_assert(out->elemSize != p->elemSize, "Output element size doesn't match the pipeline.");
+  RunPipelineSerially(p, AppendToSink, out);
+}
@@ -0,0 +1,165 @@
+/**
+ * File: vectorpipeline.h
+ * ----------------------
+ * Defines a lazy, fused pipeline of transform and filter stages over a vector.
+ *
+ * Computing "the sum of the squares of the odd elements" with the plain vector
+ * interface takes a VectorMap into a temporary vector, a second pass to filter
+ * that into another, and a third to add it up.  A vectorpipeline instead
+ * records the stages as they are added and does nothing until a terminal
+ * operation (a reduce or a collect) runs.  The terminal then makes a single
+ * pass over the source buffer, pushing each element through every stage in
+ * turn, so no intermediate vector is ever built and nothing is allocated per
+ * element.  A parallel reduce splits the source across threads, each running
+ * the same fused pass over its own range, and combines the partial results.
+ *
+ * Tombstoned source elements are skipped.  The source must not be modified
+ * while a terminal operation is running.
+ */
+
+#ifndef _vectorpipeline_
+#define _vectorpipeline_
+
+#include "vector.h"
+#include "bool.h"
+
+/**
+ * Type: VectorTransformFunction
+ * -----------------------------
+ * A transform stage.  It is handed the incoming element and must write the
+ * outgoing element, whose size was fixed when the stage was added, to
+ * destAddr.  The two never overlap.
+ */
+
+typedef void (*VectorTransformFunction)(void *destAddr, const void *srcAddr, void *auxData);
+
+/**
+ * Type: VectorFilterFunction
+ * --------------------------
+ * A filter stage.  Returns TRUE to pass the element on to the next stage and
+ * FALSE to drop it.
+ */
+
+typedef mybool (*VectorFilterFunction)(const void *elemAddr, void *auxData);
+
+/**
+ * Type: VectorReduceFunction
+ * --------------------------
+ * Folds one element coming out of the last stage into the accumulator.
+ */
+
+typedef void (*VectorReduceFunction)(void *accumulatorAddr, const void *elemAddr, void *auxData);
+
+/**
+ * Type: VectorCombineFunction
+ * ---------------------------
+ * Used by the parallel reduce to fold one thread's partial accumulator into
+ * the overall accumulator.
+ */
+
+typedef void (*VectorCombineFunction)(void *accumulatorAddr, const void *partialAddr, void *auxData);
+
+/**
+ * Type: vectorpipeline
+ * --------------------
+ * Defines the concrete representation of the pipeline: the source vector, the
+ * list of stages and the size of the element each stage hands on.  As with
+ * the vector, the client should only go through the functions below.
+ */
+
+typedef struct {
+  const vector *source;
+  vector stages;      // of VectorPipelineStage, defined in vectorpipeline.c
+  int elemSize;       // size of the elements leaving the last stage
+  int maxElemSize;    // largest element any transform produces, rounded up to
+                      // a multiple of max_align_t's alignment
+} vectorpipeline;
+
+/**
+ * Function: VectorPipelineNew
+ * Usage: vectorpipeline squares;
+ *        VectorPipelineNew(&squares, &numbers);
+ * ---------------------------
+ * Constructs an empty pipeline over source.  The pipeline only remembers the
+ * address of the source, which must outlive it.
+ */
+
+void VectorPipelineNew(vectorpipeline *p, const vector *source);
+
+/**
+ * Function: VectorPipelineDispose
+ * -------------------------------
+ * Frees the stage list.  The source vector is untouched.
+ */
+
+void VectorPipelineDispose(vectorpipeline *p);
+
+/**
+ * Function: VectorPipelineTransform
+ * Usage: VectorPipelineTransform(&squares, SquareInt, sizeof(long), NULL);
+ * ---------------------------------
+ * Appends a transform stage producing elements of outElemSize bytes, which
+ * need not match the size of the elements it receives.  An assert is raised
+ * if transformFn is NULL or outElemSize is not positive.
+ */
+
+void VectorPipelineTransform(vectorpipeline *p, VectorTransformFunction transformFn,
+                             int outElemSize, void *auxData);
+
+/**
+ * Function: VectorPipelineFilter
+ * Usage: VectorPipelineFilter(&squares, IsOdd, NULL);
+ * ------------------------------
+ * Appends a filter stage.  An assert is raised if filterFn is NULL.
+ */
+
+void VectorPipelineFilter(vectorpipeline *p, VectorFilterFunction filterFn, void *auxData);
+
+/**
+ * Function: VectorPipelineReduce
+ * Usage: long sum = 0;
+ *        VectorPipelineReduce(&squares, &sum, AddLong, NULL);
+ * ------------------------------
+ * Runs the pipeline in one pass over the source, folding every element that
+ * makes it through all the stages into the accumulator, in source order.  The
+ * accumulator is whatever the client wants it to be; it is only ever touched
+ * by reduceFn.  An assert is raised if reduceFn is NULL.
+ */
+
+void VectorPipelineReduce(vectorpipeline *p, void *accumulatorAddr,
+                          VectorReduceFunction reduceFn, void *auxData);
+
+/**
+ * Function: VectorPipelineReduceParallel
+ * Usage: long sum = 0;
+ *        VectorPipelineReduceParallel(&squares, &sum, sizeof(long),
+ *                                     AddLong, AddLong, NULL, 4);
+ * --------------------------------------
+ * Runs the pipeline over the source split into numThreads contiguous ranges,
+ * each on its own thread.  Every thread starts from a copy of the
+ * accumulator as passed in, which must therefore hold the identity of the
+ * reduction (0 for a sum, say), and reduces its range into that copy.  The
+ * partials are then folded into the accumulator with combineFn in range
+ * order, so an associative reduction gives the same answer as
+ * VectorPipelineReduce.  Stage, reduce and combine functions are called
+ * concurrently and must not share unsynchronized state.  With numThreads of
+ * 1, or a source too short to be worth splitting, this is the serial reduce.
+ * An assert is raised if either function is NULL, accumulatorSize is not
+ * positive or numThreads is less than 1.
+ */
+
+void VectorPipelineReduceParallel(vectorpipeline *p, void *accumulatorAddr, int accumulatorSize,
+                                  VectorReduceFunction reduceFn, VectorCombineFunction combineFn,
+                                  void *auxData, int numThreads);
+
+/**
+ * Function: VectorPipelineCollect
+ * -------------------------------
+ * Runs the pipeline in one pass, appending every element that makes it
+ * through the stages to out.  An assert is raised if out's element size is
+ * not the size of the elements the last stage produces.
+ */
+
+void VectorPipelineCollect(vectorpipeline *p, vector *out);
+
+#endif
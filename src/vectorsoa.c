@@ -0,0 +1,103 @@
+#include "vectorsoa.h"
+#include "vector_error.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const int kDefaultSoAAllocation = 4;
+
+static void VectorSoAAssertInBounds(const vectorsoa *v, int position) {
+  vector_assert(position < 0 || position >= v->logicalSize, "Index out of bounds.");
+}
+
+static void VectorSoAAssertField(const vectorsoa *v, int field) {
+  vector_assert(field < 0 || field >= v->numFields, "Field out of bounds.");
+}
+
+static void VectorSoAReallocColumns(vectorsoa *v, int newCapacity) {
+  for (int f = 0; f < v->numFields; f++) {
+    v->columns[f] = realloc(v->columns[f], (size_t)newCapacity * v->fields[f].size);
+    vector_assert(v->columns[f] == NULL, "Couldn't reallocate vector.");
+  }
+  v->capacity = newCapacity;
+}
+
+static void VectorSoAScatter(vectorsoa *v, const void *recordAddr, int position) {
+  const char *record = recordAddr;
+  for (int f = 0; f < v->numFields; f++) {
+    int size = v->fields[f].size;
+    memcpy((char *)v->columns[f] + (size_t)position * size, record + v->fields[f].offset, size);
+  }
+}
+
+void VectorSoANew(vectorsoa *v, int recordSize, const VectorSoAField *fields,
+                  int numFields, int initialAllocation)
+{
+  vector_assert(recordSize <= 0, "Record size must be greater than zero.");
+  vector_assert(fields == NULL || numFields <= 0, "At least one field must be provided.");
+  vector_assert(initialAllocation < 0, "Initial allocation must not be negative.");
+  for (int f = 0; f < numFields; f++) {
+    vector_assert(fields[f].size <= 0 || fields[f].offset < 0 ||
+                  fields[f].offset + fields[f].size > recordSize,
+                  "Field does not fit within the record.");
+  }
+  v->recordSize = recordSize;
+  v->numFields = numFields;
+  v->logicalSize = 0;
+  v->capacity = 0;
+  v->fields = malloc(numFields * sizeof(VectorSoAField));
+  vector_assert(v->fields == NULL, "Couldn't allocate vector.");
+  memcpy(v->fields, fields, numFields * sizeof(VectorSoAField));
+  v->columns = calloc(numFields, sizeof(void *));
+  vector_assert(v->columns == NULL, "Couldn't allocate vector.");
+  VectorSoAReallocColumns(v, initialAllocation > 0 ? initialAllocation : kDefaultSoAAllocation);
+}
+
+void VectorSoADispose(vectorsoa *v)
+{
+  for (int f = 0; f < v->numFields; f++) {
+    free(v->columns[f]);
+  }
+  free(v->columns);
+  free(v->fields);
+}
+
+int VectorSoALength(const vectorsoa *v)
+{ return v->logicalSize; }
+
+void VectorSoAAppend(vectorsoa *v, const void *recordAddr)
+{
+  if (v->logicalSize >= v->capacity) {
+    VectorSoAReallocColumns(v, v->capacity * 2);
+  }
+  VectorSoAScatter(v, recordAddr, v->logicalSize);
+  v->logicalSize++;
+}
+
+void VectorSoAGet(const vectorsoa *v, int position, void *recordAddr)
+{
+  VectorSoAAssertInBounds(v, position);
+  char *record = recordAddr;
+  for (int f = 0; f < v->numFields; f++) {
+    int size = v->fields[f].size;
+    memcpy(record + v->fields[f].offset, (char *)v->columns[f] + (size_t)position * size, size);
+  }
+}
+
+void VectorSoASet(vectorsoa *v, const void *recordAddr, int position)
+{
+  VectorSoAAssertInBounds(v, position);
+  VectorSoAScatter(v, recordAddr, position);
+}
+
+void *VectorSoAColumn(const vectorsoa *v, int field)
+{
+  VectorSoAAssertField(v, field);
+  return v->columns[field];
+}
+
+void *VectorSoAFieldNth(const vectorsoa *v, int field, int position)
+{
+  VectorSoAAssertField(v, field);
+  VectorSoAAssertInBounds(v, position);
+  return (char *)v->columns[field] + (size_t)position * v->fields[field].size;
+}
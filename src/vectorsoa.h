@@ -0,0 +1,140 @@
+/**
+ * File: vectorsoa.h
+ * -----------------
+ * Defines the interface for the struct-of-arrays vector.
+ *
+ * A vectorsoa stores records of a fixed layout, but rather than laying each
+ * record out contiguously (as a vector of structs would), it splits every
+ * record into its fields and stores each field in its own contiguous column.
+ * A scan that only reads one field then touches only that field's bytes,
+ * which is far friendlier to the cache and lets per-field loops vectorize.
+ *
+ * The client describes the record with an array of field descriptors, one per
+ * field, each giving the field's byte offset within the record and its size.
+ * Records go in and come out in their usual (array-of-structs) form: append
+ * and set scatter a record into the columns, get gathers it back out.
+ */
+
+#ifndef _vectorsoa_
+#define _vectorsoa_
+
+/**
+ * Type: VectorSoAField
+ * --------------------
+ * Describes one field of the record stored in a vectorsoa: the offset of
+ * the field from the start of the record and the number of bytes it spans.
+ * The offsetof macro from <stddef.h> is the natural way to fill one in.
+ */
+
+typedef struct {
+  int offset;
+  int size;
+} VectorSoAField;
+
+/**
+ * Type: vectorsoa
+ * ---------------
+ * Defines the concrete representation of the struct-of-arrays vector.
+ * As with the vector, everything is exposed, but the client should only
+ * interact with a vectorsoa through the functions defined in this file.
+ */
+
+typedef struct {
+  void **columns;
+  VectorSoAField *fields;
+  int numFields;
+  int recordSize;
+  int logicalSize;
+  int capacity;
+} vectorsoa;
+
+/**
+ * Function: VectorSoANew
+ * Usage: VectorSoAField fields[] = {
+ *          { offsetof(point, x), sizeof(double) },
+ *          { offsetof(point, y), sizeof(double) } };
+ *        vectorsoa points;
+ *        VectorSoANew(&points, sizeof(point), fields, 2, 100);
+ * ----------------------
+ * Constructs a raw or previously destroyed vectorsoa to be empty.  The
+ * recordSize is the size of the client's record, and the field array (which
+ * is copied, so it need not outlive the call) describes how that record is
+ * split into columns.  An assert is raised if recordSize or numFields is not
+ * greater than zero, if any field has a non-positive size, or if any field
+ * extends beyond the end of the record.  The initialAllocation parameter
+ * behaves exactly as it does for VectorNew.
+ */
+
+void VectorSoANew(vectorsoa *v, int recordSize, const VectorSoAField *fields,
+                  int numFields, int initialAllocation);
+
+/**
+ * Function: VectorSoADispose
+ * --------------------------
+ * Frees all of the columns and bookkeeping owned by the vectorsoa.  Records
+ * are plain data here; there is no free function to levy against them.
+ */
+
+void VectorSoADispose(vectorsoa *v);
+
+/**
+ * Function: VectorSoALength
+ * -------------------------
+ * Returns the number of records currently stored.  Runs in constant time.
+ */
+
+int VectorSoALength(const vectorsoa *v);
+
+/**
+ * Function: VectorSoAAppend
+ * -------------------------
+ * Appends a record to the end of the vectorsoa, scattering each of its
+ * fields into the matching column.  Runs in amortized constant time.
+ */
+
+void VectorSoAAppend(vectorsoa *v, const void *recordAddr);
+
+/**
+ * Function: VectorSoAGet
+ * ----------------------
+ * Gathers the record at the specified position back into the memory
+ * addressed by recordAddr.  Bytes of the record not covered by any field
+ * (padding, for instance) are left untouched.  An assert is raised if
+ * position is out of bounds.
+ */
+
+void VectorSoAGet(const vectorsoa *v, int position, void *recordAddr);
+
+/**
+ * Function: VectorSoASet
+ * ----------------------
+ * Overwrites the record at the specified position by scattering the fields
+ * of the record at recordAddr into the columns.  An assert is raised if
+ * position is out of bounds.
+ */
+
+void VectorSoASet(vectorsoa *v, const void *recordAddr, int position);
+
+/**
+ * Function: VectorSoAColumn
+ * -------------------------
+ * Returns the base address of the column holding the specified field.  The
+ * column holds VectorSoALength values laid out back to back, each the size
+ * given in the field's descriptor, so the client can scan it directly.  As
+ * with VectorNth, the pointer is invalidated by any call that appends.  An
+ * assert is raised if field is not a valid field index.
+ */
+
+void *VectorSoAColumn(const vectorsoa *v, int field);
+
+/**
+ * Function: VectorSoAFieldNth
+ * ---------------------------
+ * Returns the address of a single field of the record at the specified
+ * position.  An assert is raised if either field or position is out of
+ * bounds.
+ */
+
+void *VectorSoAFieldNth(const vectorsoa *v, int field, int position);
+
+#endif
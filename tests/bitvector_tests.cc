@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+extern "C" {
+  #include "bitvector.h"
+}
+
+static void AppendPattern(bitvector *bv, int count, int every) {
+	for (int i = 0; i < count; i++) {
+	  BitVectorAppend(bv, i % every == 0 ? TRUE : FALSE);
+	}
+}
+
+TEST(BitVectorTests, BitVectorNew_0_Length) {
+	bitvector flags;
+	BitVectorNew(&flags, 0);
+	EXPECT_EQ(BitVectorLength(&flags), 0);
+	EXPECT_EQ(BitVectorPopCount(&flags), 0);
+	BitVectorDispose(&flags);
+}
+
+TEST(BitVectorTests, Append_grows_and_keeps_values) {
+	bitvector flags;
+	BitVectorNew(&flags, 1);
+	AppendPattern(&flags, 300, 3);
+	EXPECT_EQ(BitVectorLength(&flags), 300);
+	for (int i = 0; i < 300; i++) {
+	  EXPECT_EQ(BitVectorGet(&flags, i), i % 3 == 0 ? TRUE : FALSE);
+	}
+	BitVectorDispose(&flags);
+}
+
+TEST(BitVectorTests, Set_and_clear_single_bits) {
+	bitvector flags;
+	BitVectorNew(&flags, 128);
+	AppendPattern(&flags, 100, 1000);
+	BitVectorSet(&flags, 70);
+	BitVectorClear(&flags, 0);
+	EXPECT_EQ(BitVectorGet(&flags, 70), TRUE);
+	EXPECT_EQ(BitVectorGet(&flags, 0), FALSE);
+	EXPECT_EQ(BitVectorPopCount(&flags), 1);
+	BitVectorDispose(&flags);
+}
+
+TEST(BitVectorTests, Throws_get_out_of_bounds) {
+	bitvector flags;
+	BitVectorNew(&flags, 64);
+	EXPECT_DEATH(BitVectorGet(&flags, 0), "Index out of bounds.");
+}
+
+TEST(BitVectorTests, Rank_counts_bits_before_position) {
+	bitvector flags;
+	BitVectorNew(&flags, 0);
+	AppendPattern(&flags, 200, 2);
+	EXPECT_EQ(BitVectorRank(&flags, 0), 0);
+	EXPECT_EQ(BitVectorRank(&flags, 1), 1);
+	EXPECT_EQ(BitVectorRank(&flags, 130), 65);
+	EXPECT_EQ(BitVectorRank(&flags, 200), BitVectorPopCount(&flags));
+	BitVectorDispose(&flags);
+}
+
+TEST(BitVectorTests, NextSet_skips_empty_words) {
+	bitvector flags;
+	BitVectorNew(&flags, 0);
+	AppendPattern(&flags, 500, 1000);
+	BitVectorSet(&flags, 321);
+	EXPECT_EQ(BitVectorNextSet(&flags, 0), 0);
+	EXPECT_EQ(BitVectorNextSet(&flags, 1), 321);
+	EXPECT_EQ(BitVectorNextSet(&flags, 322), -1);
+	EXPECT_EQ(BitVectorNextSet(&flags, 500), -1);
+	BitVectorDispose(&flags);
+}
+
+TEST(BitVectorTests, Bulk_and_or_xor) {
+	bitvector a, b;
+	BitVectorNew(&a, 0);
+	BitVectorNew(&b, 0);
+	AppendPattern(&a, 130, 2);
+	AppendPattern(&b, 130, 3);
+	BitVectorAnd(&a, &b);
+	EXPECT_EQ(BitVectorPopCount(&a), 22);   // multiples of 6 below 130
+	BitVectorOr(&a, &b);
+	EXPECT_EQ(BitVectorPopCount(&a), BitVectorPopCount(&b));
+	BitVectorXor(&a, &b);
+	EXPECT_EQ(BitVectorPopCount(&a), 0);
+	BitVectorDispose(&a);
+	BitVectorDispose(&b);
+}
+
+TEST(BitVectorTests, Bulk_ops_throw_on_length_mismatch) {
+	bitvector a, b;
+	BitVectorNew(&a, 0);
+	BitVectorNew(&b, 0);
+	AppendPattern(&a, 10, 2);
+	EXPECT_DEATH(BitVectorOr(&a, &b), "Bitvector lengths differ.");
+}
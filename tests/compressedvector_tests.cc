@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+
+extern "C" {
+  #include "compressedvector.h"
+}
+
+TEST(CompressedVectorTests, CompressedVectorNew_0_Length) {
+	compressedvector ids;
+	CompressedVectorNew(&ids);
+	EXPECT_EQ(CompressedVectorLength(&ids), 0);
+	EXPECT_EQ(CompressedVectorNumBlocks(&ids), 0);
+	CompressedVectorDispose(&ids);
+}
+
+TEST(CompressedVectorTests, Sorted_ids_round_trip_and_compress) {
+	compressedvector ids;
+	CompressedVectorNew(&ids);
+	const int count = 1000;
+	for (int i = 0; i < count; i++) CompressedVectorAppend(&ids, 500000L + 3L * i);
+	EXPECT_EQ(CompressedVectorLength(&ids), count);
+	for (int i = 0; i < count; i++) {
+	  EXPECT_EQ(CompressedVectorNth(&ids, i), 500000L + 3L * i);
+	}
+	EXPECT_LT(CompressedVectorBytesUsed(&ids), count * sizeof(long) / 8);
+	CompressedVectorDispose(&ids);
+}
+
+TEST(CompressedVectorTests, Permutation_uses_frame_of_reference) {
+	compressedvector perm;
+	CompressedVectorNew(&perm);
+	const long d = 1031;
+	for (long k = 0; k < d; k++) CompressedVectorAppend(&perm, (k * 17) % d);
+	for (long k = 0; k < d; k++) {
+	  EXPECT_EQ(CompressedVectorNth(&perm, (int)k), (k * 17) % d);
+	}
+	CompressedVectorDispose(&perm);
+}
+
+TEST(CompressedVectorTests, Wide_and_negative_values_round_trip) {
+	compressedvector values;
+	CompressedVectorNew(&values);
+	for (int i = 0; i < 300; i++) {
+	  long v = (i % 2 ? -1L : 1L) * ((long)i << 40);
+	  CompressedVectorAppend(&values, v);
+	}
+	for (int i = 0; i < 300; i++) {
+	  EXPECT_EQ(CompressedVectorNth(&values, i), (i % 2 ? -1L : 1L) * ((long)i << 40));
+	}
+	CompressedVectorDispose(&values);
+}
+
+TEST(CompressedVectorTests, Sorted_values_with_gaps_wider_than_32_bits_round_trip) {
+	compressedvector values;
+	CompressedVectorNew(&values);
+	for (int i = 0; i < 2 * kCompressedBlockLength; i++) CompressedVectorAppend(&values, (long)i << 36);
+	for (int i = 0; i < 2 * kCompressedBlockLength; i++) {
+	  EXPECT_EQ(CompressedVectorNth(&values, i), (long)i << 36);
+	}
+	long decoded[kCompressedBlockLength];
+	ASSERT_EQ(CompressedVectorDecodeBlock(&values, 0, decoded), kCompressedBlockLength);
+	for (int i = 0; i < kCompressedBlockLength; i++) EXPECT_EQ(decoded[i], (long)i << 36);
+	CompressedVectorDispose(&values);
+}
+
+TEST(CompressedVectorTests, DecodeBlock_matches_random_access) {
+	compressedvector ids;
+	CompressedVectorNew(&ids);
+	for (int i = 0; i < 300; i++) CompressedVectorAppend(&ids, (long)i * i);
+	EXPECT_EQ(CompressedVectorNumBlocks(&ids), 3);
+	long decoded[kCompressedBlockLength];
+	int position = 0;
+	for (int b = 0; b < CompressedVectorNumBlocks(&ids); b++) {
+	  int n = CompressedVectorDecodeBlock(&ids, b, decoded);
+	  for (int i = 0; i < n; i++) EXPECT_EQ(decoded[i], CompressedVectorNth(&ids, position++));
+	}
+	EXPECT_EQ(position, 300);
+	CompressedVectorDispose(&ids);
+}
+
+TEST(CompressedVectorTests, Throws_nth_out_of_bounds) {
+	compressedvector ids;
+	CompressedVectorNew(&ids);
+	EXPECT_DEATH(CompressedVectorNth(&ids, 0), "Index out of bounds.");
+}
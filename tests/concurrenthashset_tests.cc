@@ -0,0 +1,179 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+extern "C" {
+  #include "concurrenthashset.h"
+}
+
+typedef struct {
+  int key;
+  int writer;
+} entry;
+
+static uint64_t HashEntry(const void *elemAddr) {
+	uint64_t key = (uint32_t)((const entry *)elemAddr)->key;
+	key *= 0x9e3779b97f4a7c15ULL;
+	return key ^ (key >> 29);
+}
+
+static int CompareEntry(const void *elemAddr1, const void *elemAddr2) {
+	return ((const entry *)elemAddr1)->key - ((const entry *)elemAddr2)->key;
+}
+
+static std::atomic<int> freeCalls(0);
+static void CountFree(void *elemAddr) {
+	freeCalls++;
+}
+
+static void CountEntries(void *elemAddr, void *auxData) {
+	(*(int *)auxData)++;
+}
+
+TEST(ConcurrentHashSetTests, Single_thread_enter_lookup_and_replace) {
+	concurrenthashset set;
+	freeCalls = 0;
+	ConcurrentHashSetNew(&set, sizeof(entry), 64, 6, HashEntry, CompareEntry, CountFree);
+	EXPECT_EQ(set.numShards, 8);
+	for (int i = 0; i < 1000; i++) {
+	  entry e = { i, 0 };
+	  ConcurrentHashSetEnter(&set, &e);
+	}
+	EXPECT_EQ(ConcurrentHashSetCount(&set), 1000);
+	entry replacement = { 10, 7 }, found = { -1, -1 };
+	ConcurrentHashSetEnter(&set, &replacement);
+	EXPECT_EQ(freeCalls, 1);
+	EXPECT_TRUE(ConcurrentHashSetLookup(&set, &replacement, &found));
+	EXPECT_EQ(found.writer, 7);
+	entry absent = { 5000, 0 };
+	EXPECT_FALSE(ConcurrentHashSetLookup(&set, &absent, NULL));
+	int visited = 0;
+	ConcurrentHashSetMap(&set, CountEntries, &visited);
+	EXPECT_EQ(visited, 1000);
+	ConcurrentHashSetDispose(&set);
+	EXPECT_EQ(freeCalls, 1001);
+}
+
+TEST(ConcurrentHashSetTests, EnterIfAbsent_leaves_existing_element) {
+	concurrenthashset set;
+	ConcurrentHashSetNew(&set, sizeof(entry), 16, 4, HashEntry, CompareEntry, NULL);
+	entry first = { 3, 1 }, second = { 3, 2 }, found;
+	EXPECT_TRUE(ConcurrentHashSetEnterIfAbsent(&set, &first));
+	EXPECT_FALSE(ConcurrentHashSetEnterIfAbsent(&set, &second));
+	ASSERT_TRUE(ConcurrentHashSetLookup(&set, &second, &found));
+	EXPECT_EQ(found.writer, 1);
+	ConcurrentHashSetDispose(&set);
+}
+
+TEST(ConcurrentHashSetTests, Mixed_workload_from_many_threads_keeps_every_key) {
+	const int kThreads = 8, kKeys = 20000;
+	concurrenthashset set;
+	ConcurrentHashSetNew(&set, sizeof(entry), 64, 16, HashEntry, CompareEntry, NULL);
+	std::atomic<int> wins(0), missedOwnWrite(0);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < kThreads; t++) {
+	  threads.emplace_back([&, t]() {
+	    // Every thread walks all the keys from a different starting point,
+	    // mixing attempted inserts, overwrites of other keys and lookups.
+	    for (int i = 0; i < kKeys; i++) {
+	      int key = (i + t * (kKeys / kThreads)) % kKeys;
+	      entry e = { key, t }, found;
+	      if (ConcurrentHashSetEnterIfAbsent(&set, &e)) wins++;
+	      if (!ConcurrentHashSetLookup(&set, &e, &found) || found.key != key) missedOwnWrite++;
+	      if (i % 16 == 0) {
+	        entry overwrite = { (key * 7) % kKeys, t };
+	        ConcurrentHashSetEnter(&set, &overwrite);
+	      }
+	    }
+	  });
+	}
+	for (std::thread &thread : threads) thread.join();
+	// Overwrites may enter a key before any EnterIfAbsent gets to it.
+	EXPECT_EQ(ConcurrentHashSetCount(&set), kKeys);
+	EXPECT_LE(wins.load(), kKeys);
+	EXPECT_GT(wins.load(), 0);
+	EXPECT_EQ(missedOwnWrite.load(), 0);
+	ConcurrentHashSetDispose(&set);
+}
+
+TEST(ConcurrentHashSetTests, Racing_EnterIfAbsent_has_one_winner_per_key) {
+	const int kThreads = 8, kKeys = 5000;
+	concurrenthashset set;
+	ConcurrentHashSetNew(&set, sizeof(entry), 16, 8, HashEntry, CompareEntry, NULL);
+	std::atomic<int> wins(0);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < kThreads; t++) {
+	  threads.emplace_back([&, t]() {
+	    for (int i = 0; i < kKeys; i++) {
+	      entry e = { (i * (t + 1)) % kKeys, t };
+	      if (ConcurrentHashSetEnterIfAbsent(&set, &e)) wins++;
+	    }
+	  });
+	}
+	for (std::thread &thread : threads) thread.join();
+	EXPECT_EQ(wins.load(), ConcurrentHashSetCount(&set));
+	// Thread 0 walked every key, so all of them must be there.
+	EXPECT_EQ(ConcurrentHashSetCount(&set), kKeys);
+	ConcurrentHashSetDispose(&set);
+}
+
+static void IncrementWriter(void *elemAddr, void *auxData) {
+	((entry *)elemAddr)->writer++;
+}
+
+TEST(ConcurrentHashSetTests, Racing_FindOrEnter_updates_are_never_lost) {
+	const int kThreads = 8, kKeys = 500, kRounds = 20;
+	concurrenthashset set;
+	ConcurrentHashSetNew(&set, sizeof(entry), 16, 4, HashEntry, CompareEntry, NULL);
+	std::atomic<int> inserts(0);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < kThreads; t++) {
+	  threads.emplace_back([&, t]() {
+	    // Each thread counts every key kRounds times, starting from zero.
+	    for (int round = 0; round < kRounds; round++) {
+	      for (int i = 0; i < kKeys; i++) {
+	        entry e = { (i + t * 61) % kKeys, 0 };
+	        if (ConcurrentHashSetFindOrEnter(&set, &e, IncrementWriter, NULL)) inserts++;
+	      }
+	    }
+	  });
+	}
+	for (std::thread &thread : threads) thread.join();
+	EXPECT_EQ(inserts.load(), kKeys);
+	for (int i = 0; i < kKeys; i++) {
+	  entry key = { i, 0 }, found;
+	  ASSERT_TRUE(ConcurrentHashSetLookup(&set, &key, &found));
+	  EXPECT_EQ(found.writer, kThreads * kRounds) << i;
+	}
+	entry fresh = { kKeys, 5 };
+	EXPECT_TRUE(ConcurrentHashSetFindOrEnter(&set, &fresh, NULL, NULL));
+	EXPECT_FALSE(ConcurrentHashSetFindOrEnter(&set, &fresh, NULL, NULL));
+	ConcurrentHashSetDispose(&set);
+}
+
+TEST(ConcurrentHashSetTests, Racing_Remove_has_one_winner_per_key) {
+	const int kThreads = 8, kKeys = 5000;
+	concurrenthashset set;
+	freeCalls = 0;
+	ConcurrentHashSetNew(&set, sizeof(entry), 16, 8, HashEntry, CompareEntry, CountFree);
+	for (int i = 0; i < kKeys; i++) {
+	  entry e = { i, 0 };
+	  ConcurrentHashSetEnter(&set, &e);
+	}
+	std::atomic<int> removals(0);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < kThreads; t++) {
+	  threads.emplace_back([&, t]() {
+	    for (int i = 0; i < kKeys; i++) {
+	      entry e = { (i + t * 613) % kKeys, 0 };
+	      if (ConcurrentHashSetRemove(&set, &e)) removals++;
+	    }
+	  });
+	}
+	for (std::thread &thread : threads) thread.join();
+	EXPECT_EQ(removals.load(), kKeys);
+	EXPECT_EQ(freeCalls.load(), kKeys);
+	EXPECT_EQ(ConcurrentHashSetCount(&set), 0);
+	ConcurrentHashSetDispose(&set);
+}
@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+extern "C" {
+  #include "containertrace.h"
+  #include "hashset.h"
+  #include "orderedhashset.h"
+  #include "stringvector.h"
+}
+
+// Built with VECTOR_TRACE, so the vector and hashset calls below report
+// themselves to the recorder.
+
+static std::string TempPath(const char *name) {
+	return ::testing::TempDir() + name;
+}
+
+static std::vector<int> hashRanges;
+static int HashInt(const void *elemAddr, int numBuckets) {
+	hashRanges.push_back(numBuckets);
+	unsigned long key = (unsigned)*(const int *)elemAddr * 2654435761ul;
+	return (int)(key % (unsigned long)numBuckets);
+}
+
+static int CompareInt(const void *elemAddr1, const void *elemAddr2) {
+	return *(const int *)elemAddr1 - *(const int *)elemAddr2;
+}
+
+static std::vector<ContainerTraceRecord> LoadTrace(const std::string &path) {
+	vector records;
+	VectorNew(&records, sizeof(ContainerTraceRecord), NULL, 16);
+	ContainerTraceLoad(path.c_str(), &records);
+	std::vector<ContainerTraceRecord> loaded;
+	for (int i = 0; i < VectorLength(&records); i++) {
+	  loaded.push_back(*(const ContainerTraceRecord *)VectorNth(&records, i));
+	}
+	VectorDispose(&records);
+	return loaded;
+}
+
+TEST(ContainerTraceHookTests, Vector_calls_are_recorded) {
+	std::string path = TempPath("containertrace_vector_hooks.trace");
+	ContainerTraceStart(path.c_str());
+	vector v;
+	VectorNew(&v, sizeof(long), NULL, 8);
+	for (long n = 0; n < 3; n++) VectorAppend(&v, &n);
+	long n = 7;
+	VectorReplace(&v, &n, 2);
+	VectorNth(&v, 1);
+	VectorDelete(&v, 0);
+	VectorDispose(&v);
+	ContainerTraceStop();
+
+	std::vector<ContainerTraceRecord> records = LoadTrace(path);
+	const ContainerTraceOp expectedOps[] = {
+	  kTraceVectorNew, kTraceVectorAppend, kTraceVectorAppend, kTraceVectorAppend,
+	  kTraceVectorReplace, kTraceVectorNth, kTraceVectorDelete, kTraceVectorDispose
+	};
+	const int expectedIndices[] = { 8, 0, 1, 2, 2, 1, 0, 0 };
+	ASSERT_EQ(records.size(), sizeof(expectedOps) / sizeof(expectedOps[0]));
+	for (size_t i = 0; i < records.size(); i++) {
+	  EXPECT_EQ(records[i].op, expectedOps[i]) << i;
+	  EXPECT_EQ(records[i].index, expectedIndices[i]) << i;
+	  EXPECT_EQ(records[i].elemSize, sizeof(long)) << i;
+	  EXPECT_EQ(records[i].container, (uint64_t)(uintptr_t)&v) << i;
+	}
+	remove(path.c_str());
+}
+
+TEST(ContainerTraceHookTests, HashSet_calls_are_recorded_with_the_key_hash) {
+	std::string path = TempPath("containertrace_hashset_hooks.trace");
+	ContainerTraceStart(path.c_str());
+	hashset set;
+	HashSetNew(&set, sizeof(int), 16, HashInt, CompareInt, NULL);
+	int key = 42, other = 43;
+	HashSetEnter(&set, &key);
+	HashSetLookup(&set, &key);
+	HashSetFindOrEnter(&set, &other, NULL);
+	HashSetRemove(&set, &key);
+	HashSetDispose(&set);
+	ContainerTraceStop();
+
+	std::vector<ContainerTraceRecord> records = LoadTrace(path);
+	const ContainerTraceOp expectedOps[] = {
+	  kTraceHashSetNew, kTraceHashSetEnter, kTraceHashSetLookup,
+	  kTraceHashSetFindOrEnter, kTraceHashSetRemove, kTraceHashSetDispose
+	};
+	ASSERT_EQ(records.size(), sizeof(expectedOps) / sizeof(expectedOps[0]));
+	for (size_t i = 0; i < records.size(); i++) {
+	  EXPECT_EQ(records[i].op, expectedOps[i]) << i;
+	  EXPECT_EQ(records[i].elemSize, sizeof(int)) << i;
+	  EXPECT_EQ(records[i].container, (uint64_t)(uintptr_t)&set) << i;
+	}
+	EXPECT_EQ(records[0].index, 16);
+	int keyHash = HashInt(&key, 0x7fffffff), otherHash = HashInt(&other, 0x7fffffff);
+	EXPECT_EQ(records[1].index, keyHash);
+	EXPECT_EQ(records[2].index, keyHash);
+	EXPECT_EQ(records[3].index, otherHash);
+	EXPECT_EQ(records[4].index, keyHash);
+	remove(path.c_str());
+}
+
+TEST(ContainerTraceHookTests, LookupBatch_records_one_lookup_per_key_on_both_paths) {
+	std::string path = TempPath("containertrace_batch_hooks.trace");
+	hashset set;
+	HashSetNew(&set, sizeof(int), 16, HashInt, CompareInt, NULL);
+	HashSetEnableIncrementalRehash(&set, 1);
+	int keys[40];
+	for (int i = 0; i < 40; i++) keys[i] = i;
+	void *results[40];
+	for (int i = 0; i < 15; i++) HashSetEnter(&set, &keys[i]);
+	ASSERT_NE(set.oldSlots, nullptr);
+	ContainerTraceStart(path.c_str());
+	HashSetLookupBatch(&set, keys, 40, results);
+	for (int i = 15; i < 40; i++) HashSetEnter(&set, &keys[i]);
+	while (set.oldSlots != NULL) HashSetEnter(&set, &keys[0]);
+	HashSetLookupBatch(&set, keys, 40, results);
+	ContainerTraceStop();
+
+	std::vector<ContainerTraceRecord> lookups;
+	for (const ContainerTraceRecord &record : LoadTrace(path)) {
+	  if (record.op == kTraceHashSetLookup) lookups.push_back(record);
+	}
+	ASSERT_EQ(lookups.size(), 80u);
+	for (int i = 0; i < 80; i++) EXPECT_EQ(lookups[i].index, HashInt(&keys[i % 40], 0x7fffffff)) << i;
+	HashSetDispose(&set);
+	remove(path.c_str());
+}
+
+TEST(ContainerTraceHookTests, Idle_hooks_do_not_hash_for_the_trace) {
+	hashset set;
+	HashSetNew(&set, sizeof(int), 16, HashInt, CompareInt, NULL);
+	int key = 42;
+	hashRanges.clear();
+	HashSetEnter(&set, &key);
+	HashSetLookup(&set, &key);
+	HashSetRemove(&set, &key);
+	for (int numBuckets : hashRanges) EXPECT_EQ(numBuckets, 16);
+	EXPECT_FALSE(hashRanges.empty());
+	HashSetDispose(&set);
+}
+
+TEST(ContainerTraceHookTests, Vectors_inside_other_containers_are_not_recorded) {
+	std::string path = TempPath("containertrace_internal_hooks.trace");
+	ContainerTraceStart(path.c_str());
+	stringvector words;
+	StringVectorNew(&words, 4);
+	StringVectorAppend(&words, "polar");
+	StringVectorAppend(&words, "icy");
+	StringVectorSort(&words);
+	StringVectorNth(&words, 0, NULL);
+	StringVectorDispose(&words);
+	orderedhashset set;
+	OrderedHashSetNew(&set, sizeof(int), 16, HashInt, CompareInt, NULL);
+	for (int i = 0; i < 20; i++) OrderedHashSetEnter(&set, &i);
+	OrderedHashSetDispose(&set);
+	vector v;
+	VectorNew(&v, sizeof(int), NULL, 4);
+	VectorDispose(&v);
+	ContainerTraceStop();
+
+	std::vector<ContainerTraceRecord> records = LoadTrace(path);
+	ASSERT_EQ(records.size(), 2u);
+	EXPECT_EQ(records[0].op, kTraceVectorNew);
+	EXPECT_EQ(records[1].op, kTraceVectorDispose);
+	EXPECT_EQ(records[0].container, (uint64_t)(uintptr_t)&v);
+	remove(path.c_str());
+}
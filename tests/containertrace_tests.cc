@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+
+extern "C" {
+  #include "containertrace.h"
+}
+
+static std::string TempPath(const char *name) {
+	return ::testing::TempDir() + name;
+}
+
+TEST(ContainerTraceTests, Logged_operations_load_back_in_order) {
+	std::string path = TempPath("containertrace_roundtrip.trace");
+	int container;
+	ContainerTraceStart(path.c_str());
+	EXPECT_TRUE(ContainerTraceIsRunning());
+	ContainerTraceLog(kTraceVectorNew, &container, 4, sizeof(long));
+	for (int i = 0; i < 10000; i++) ContainerTraceLog(kTraceVectorAppend, &container, i, sizeof(long));
+	ContainerTraceLog(kTraceVectorDispose, &container, 0, sizeof(long));
+	ContainerTraceStop();
+	EXPECT_FALSE(ContainerTraceIsRunning());
+
+	vector records;
+	VectorNew(&records, sizeof(ContainerTraceRecord), NULL, 16);
+	ContainerTraceLoad(path.c_str(), &records);
+	ASSERT_EQ(VectorLength(&records), 10002);
+	const ContainerTraceRecord *first = (const ContainerTraceRecord *)VectorNth(&records, 0);
+	EXPECT_EQ(first->op, kTraceVectorNew);
+	EXPECT_EQ(first->index, 4);
+	EXPECT_EQ(first->elemSize, sizeof(long));
+	EXPECT_EQ(first->container, (uint64_t)(uintptr_t)&container);
+	for (int i = 1; i < VectorLength(&records); i++) {
+	  const ContainerTraceRecord *prev = (const ContainerTraceRecord *)VectorNth(&records, i - 1);
+	  const ContainerTraceRecord *cur = (const ContainerTraceRecord *)VectorNth(&records, i);
+	  EXPECT_LE(prev->timestamp, cur->timestamp);
+	  if (cur->op == kTraceVectorAppend) EXPECT_EQ(cur->index, i - 1);
+	}
+	EXPECT_EQ(((const ContainerTraceRecord *)VectorNth(&records, 10001))->op, kTraceVectorDispose);
+	VectorDispose(&records);
+	remove(path.c_str());
+}
+
+TEST(ContainerTraceTests, Log_without_running_trace_is_ignored) {
+	int container;
+	EXPECT_FALSE(ContainerTraceIsRunning());
+	ContainerTraceLog(kTraceVectorAppend, &container, 0, 1);
+	ContainerTraceStop();
+}
+
+TEST(ContainerTraceTests, Load_rejects_a_file_that_is_not_a_trace) {
+	std::string path = TempPath("containertrace_bogus.trace");
+	FILE *fp = fopen(path.c_str(), "wb");
+	fputs("not a trace", fp);
+	fclose(fp);
+	vector records;
+	VectorNew(&records, sizeof(ContainerTraceRecord), NULL, 16);
+	EXPECT_DEATH(ContainerTraceLoad(path.c_str(), &records), "Not a container trace.");
+	VectorDispose(&records);
+	remove(path.c_str());
+}
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+extern "C" {
+  #include "externalsort.h"
+}
+
+typedef struct {
+  int key;
+  int payload;
+} record;
+
+static int CompareRecords(const void *a, const void *b) {
+	int lhs = ((const record *)a)->key, rhs = ((const record *)b)->key;
+	return (lhs > rhs) - (lhs < rhs);
+}
+
+static std::string TempPath(const char *name) {
+	return ::testing::TempDir() + name;
+}
+
+static void WriteRecords(const std::string &path, const std::vector<record> &records) {
+	FILE *fp = fopen(path.c_str(), "wb");
+	ASSERT_NE(fp, nullptr);
+	if (!records.empty()) fwrite(records.data(), sizeof(record), records.size(), fp);
+	fclose(fp);
+}
+
+static std::vector<record> ReadRecords(const std::string &path) {
+	std::vector<record> records;
+	FILE *fp = fopen(path.c_str(), "rb");
+	EXPECT_NE(fp, nullptr);
+	record r;
+	while (fp != nullptr && fread(&r, sizeof(record), 1, fp) == 1) records.push_back(r);
+	if (fp != nullptr) fclose(fp);
+	return records;
+}
+
+static std::vector<record> RandomRecords(int count) {
+	std::vector<record> records;
+	srand(107);
+	for (int i = 0; i < count; i++) records.push_back({ rand() % 1000, i });
+	return records;
+}
+
+static void ExpectSortedPermutation(const std::vector<record> &input, const std::vector<record> &output) {
+	ASSERT_EQ(output.size(), input.size());
+	std::vector<int> in, out;
+	for (size_t i = 0; i < input.size(); i++) {
+	  in.push_back(input[i].payload);
+	  out.push_back(output[i].payload);
+	  if (i > 0) EXPECT_LE(output[i - 1].key, output[i].key);
+	}
+	std::sort(in.begin(), in.end());
+	std::sort(out.begin(), out.end());
+	EXPECT_EQ(in, out);
+}
+
+TEST(ExternalSortTests, Empty_input_gives_empty_output) {
+	std::string in = TempPath("extsort_empty.in"), out = TempPath("extsort_empty.out");
+	WriteRecords(in, {});
+	VectorExternalSort(in.c_str(), out.c_str(), sizeof(record), CompareRecords, 1024);
+	EXPECT_TRUE(ReadRecords(out).empty());
+	remove(in.c_str());
+	remove(out.c_str());
+}
+
+TEST(ExternalSortTests, Input_that_fits_in_budget_is_one_run) {
+	std::string in = TempPath("extsort_small.in"), out = TempPath("extsort_small.out");
+	std::vector<record> input = RandomRecords(500);
+	WriteRecords(in, input);
+	VectorExternalSort(in.c_str(), out.c_str(), sizeof(record), CompareRecords, 1 << 20);
+	ExpectSortedPermutation(input, ReadRecords(out));
+	remove(in.c_str());
+	remove(out.c_str());
+}
+
+TEST(ExternalSortTests, Many_runs_merge_in_several_passes) {
+	std::string in = TempPath("extsort_large.in"), out = TempPath("extsort_large.out");
+	std::vector<record> input = RandomRecords(50000);
+	WriteRecords(in, input);
+	// 4KB runs give about a hundred runs, more than one merge can take at once.
+	VectorExternalSort(in.c_str(), out.c_str(), sizeof(record), CompareRecords, 4096);
+	ExpectSortedPermutation(input, ReadRecords(out));
+	remove(in.c_str());
+	remove(out.c_str());
+}
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+
+extern "C" {
+  #include "frozenhashset.h"
+}
+#include "hashset_test_helpers.h"
+
+static uint64_t HashInt64(const void *elemAddr) {
+	uint64_t key = (uint32_t)*(const int *)elemAddr;
+	key *= 0x9e3779b97f4a7c15ULL;
+	return key ^ (key >> 29);
+}
+
+// Case-insensitive hash over case-sensitive compare: words differing only in
+// case collide completely.
+static int HashWord(const void *elemAddr, int numBuckets) {
+	const char *s = *(char * const *)elemAddr;
+	unsigned long hashcode = 0;
+	for (; *s != '\0'; s++) hashcode = hashcode * -1664117991L + tolower(*s);
+	return (int)(hashcode % numBuckets);
+}
+
+static int CompareWord(const void *elemAddr1, const void *elemAddr2) {
+	return strcmp(*(char * const *)elemAddr1, *(char * const *)elemAddr2);
+}
+
+static int wordCompares = 0;
+static int CountingCompareWord(const void *elemAddr1, const void *elemAddr2) {
+	wordCompares++;
+	return CompareWord(elemAddr1, elemAddr2);
+}
+
+static void FreeWord(void *elemAddr) {
+	free(*(char **)elemAddr);
+}
+
+TEST(FrozenHashSetTests, Frozen_set_finds_every_element_and_nothing_else) {
+	hashset set;
+	HashSetNew(&set, sizeof(int), 16, HashInt, CompareInt, NULL);
+	std::set<int> expected;
+	for (int i = 0; i < 50000; i++) {
+	  int key = i * 3;
+	  HashSetEnter(&set, &key);
+	  expected.insert(key);
+	}
+	frozenhashset frozen;
+	HashSetFreeze(&set, &frozen);
+	EXPECT_EQ(FrozenHashSetCount(&frozen), 50000);
+	EXPECT_EQ(frozen.numSlots, 50000);
+	for (int i = 0; i < 150000; i++) {
+	  int *found = (int *)FrozenHashSetLookup(&frozen, &i);
+	  if (i % 3 == 0) {
+	    ASSERT_NE(found, nullptr) << i;
+	    EXPECT_EQ(*found, i);
+	  } else {
+	    ASSERT_EQ(found, nullptr) << i;
+	  }
+	}
+	std::set<int> seen;
+	FrozenHashSetMap(&frozen, CollectInt, &seen);
+	EXPECT_EQ(seen, expected);
+	EXPECT_LT(FrozenHashSetBytesUsed(&frozen), 50000 * (sizeof(int) + 2));
+	FrozenHashSetDispose(&frozen);
+}
+
+TEST(FrozenHashSetTests, Hash64_set_freezes) {
+	hashset set;
+	HashSetNewWithHash64(&set, sizeof(int), 16, HashInt64, CompareInt, NULL);
+	for (int i = 0; i < 1000; i++) HashSetEnter(&set, &i);
+	frozenhashset frozen;
+	HashSetFreeze(&set, &frozen);
+	for (int i = 0; i < 1000; i++) ASSERT_NE(FrozenHashSetLookup(&frozen, &i), nullptr);
+	int absent = 1000;
+	EXPECT_EQ(FrozenHashSetLookup(&frozen, &absent), nullptr);
+	FrozenHashSetDispose(&frozen);
+}
+
+TEST(FrozenHashSetTests, Empty_set_freezes) {
+	hashset set;
+	HashSetNew(&set, sizeof(int), 4, HashInt, CompareInt, NULL);
+	frozenhashset frozen;
+	HashSetFreeze(&set, &frozen);
+	EXPECT_EQ(FrozenHashSetCount(&frozen), 0);
+	int key = 1;
+	EXPECT_EQ(FrozenHashSetLookup(&frozen, &key), nullptr);
+	FrozenHashSetDispose(&frozen);
+}
+
+TEST(FrozenHashSetTests, Colliding_hash_codes_go_to_overflow_and_ownership_moves) {
+	const char *words[] = { "apple", "Apple", "APPLE", "pear", "Pear", "plum", "fig", "kiwi" };
+	hashset set;
+	HashSetNew(&set, sizeof(char *), 8, HashWord, CompareWord, FreeWord);
+	for (const char *word : words) {
+	  char *copy = strdup(word);
+	  HashSetEnter(&set, &copy);
+	}
+	frozenhashset frozen;
+	HashSetFreeze(&set, &frozen);
+	EXPECT_EQ(FrozenHashSetCount(&frozen), 8);
+	EXPECT_EQ(VectorLength(&frozen.overflow), 3);
+	for (const char *word : words) {
+	  char **found = (char **)FrozenHashSetLookup(&frozen, &word);
+	  ASSERT_NE(found, nullptr) << word;
+	  EXPECT_STREQ(*found, word);
+	}
+	const char *absent = "aPPle";
+	EXPECT_EQ(FrozenHashSetLookup(&frozen, &absent), nullptr);
+	// Each strdup'd word is freed exactly once, by the frozen set; leak
+	// checkers would flag a miss and the allocator a double free.
+	FrozenHashSetDispose(&frozen);
+}
+
+TEST(FrozenHashSetTests, Misses_only_compare_overflow_elements_with_the_same_hash) {
+	hashset set;
+	HashSetNew(&set, sizeof(char *), 64, HashWord, CountingCompareWord, FreeWord);
+	for (int i = 0; i < 300; i++) {
+	  char word[8];
+	  snprintf(word, sizeof(word), "%c%c%c", 'a' + i % 26, 'a' + i / 26 % 26, 'q');
+	  for (int variant = 0; variant < 3; variant++) {
+	    if (variant > 0) word[variant - 1] = (char)toupper(word[variant - 1]);
+	    char *copy = strdup(word);
+	    HashSetEnter(&set, &copy);
+	  }
+	}
+	frozenhashset frozen;
+	HashSetFreeze(&set, &frozen);
+	EXPECT_EQ(VectorLength(&frozen.overflow), 600);
+	const char *unknown = "xyzzy";
+	wordCompares = 0;
+	EXPECT_EQ(FrozenHashSetLookup(&frozen, &unknown), nullptr);
+	EXPECT_EQ(wordCompares, 1);
+	const char *variant = "aaQ";   // shares its hash with aaq, Aaq and AAq
+	wordCompares = 0;
+	EXPECT_EQ(FrozenHashSetLookup(&frozen, &variant), nullptr);
+	EXPECT_LE(wordCompares, 3);
+	const char *present = "AAq";
+	char **found = (char **)FrozenHashSetLookup(&frozen, &present);
+	ASSERT_NE(found, nullptr);
+	EXPECT_STREQ(*found, "AAq");
+	FrozenHashSetDispose(&frozen);
+}
@@ -0,0 +1,35 @@
+#ifndef _hashset_test_helpers_
+#define _hashset_test_helpers_
+
+#include <set>
+
+// Element callbacks shared by the tests of the hashset and its variants,
+// all of which store plain ints unless a test says otherwise.
+
+inline int HashInt(const void *elemAddr, int numBuckets) {
+	return (int)((unsigned)*(const int *)elemAddr % (unsigned)numBuckets);
+}
+
+inline int CompareInt(const void *elemAddr1, const void *elemAddr2) {
+	return *(const int *)elemAddr1 - *(const int *)elemAddr2;
+}
+
+inline void CollectInt(void *elemAddr, void *auxData) {
+	((std::set<int> *)auxData)->insert(*(int *)elemAddr);
+}
+
+// A free function has no auxData, so CountFree tallies into whichever
+// FreeCounter is alive.  A test checking how often elements are freed
+// declares one before creating its set, and reads it back from calls.
+struct FreeCounter {
+	int calls = 0;
+	static inline FreeCounter *current = nullptr;
+	FreeCounter() { current = this; }
+	~FreeCounter() { current = nullptr; }
+};
+
+inline void CountFree(void *elemAddr) {
+	if (FreeCounter::current != nullptr) FreeCounter::current->calls++;
+}
+
+#endif
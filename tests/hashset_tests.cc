@@ -0,0 +1,438 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <set>
+
+extern "C" {
+  #include "hashset.h"
+}
+#include "hashset_test_helpers.h"
+
+typedef struct {
+  char ch;
+  int occurrences;
+} frequency;
+
+static int HashFrequency(const void *elemAddr, int numBuckets) {
+	return ((const frequency *)elemAddr)->ch % numBuckets;
+}
+
+static int CompareLetter(const void *elemAddr1, const void *elemAddr2) {
+	return ((const frequency *)elemAddr1)->ch - ((const frequency *)elemAddr2)->ch;
+}
+
+TEST(HashSetTests, HashSetNew_is_empty) {
+	hashset set;
+	HashSetNew(&set, sizeof(int), 10, HashInt, CompareInt, NULL);
+	EXPECT_EQ(HashSetCount(&set), 0);
+	int key = 3;
+	EXPECT_EQ(HashSetLookup(&set, &key), nullptr);
+	HashSetDispose(&set);
+}
+
+TEST(HashSetTests, HashSetNew_rejects_missing_hash_function) {
+	hashset set;
+	EXPECT_DEATH(HashSetNew(&set, sizeof(int), 10, NULL, CompareInt, NULL),
+	             "no hash or compare function provided");
+}
+
+TEST(HashSetTests, Enter_then_lookup_finds_stored_copy) {
+	hashset set;
+	HashSetNew(&set, sizeof(int), 10, HashInt, CompareInt, NULL);
+	for (int i = 0; i < 5; i++) HashSetEnter(&set, &i);
+	EXPECT_EQ(HashSetCount(&set), 5);
+	for (int i = 0; i < 5; i++) {
+	  int *found = (int *)HashSetLookup(&set, &i);
+	  ASSERT_NE(found, nullptr);
+	  EXPECT_EQ(*found, i);
+	  EXPECT_NE(found, &i);
+	}
+	int absent = 7;
+	EXPECT_EQ(HashSetLookup(&set, &absent), nullptr);
+	HashSetDispose(&set);
+}
+
+TEST(HashSetTests, Enter_replaces_matching_element_and_frees_old_one) {
+	hashset counts;
+	FreeCounter frees;
+	HashSetNew(&counts, sizeof(frequency), 26, HashFrequency, CompareLetter, CountFree);
+	frequency f = { 'e', 1 };
+	HashSetEnter(&counts, &f);
+	f.occurrences = 2;
+	HashSetEnter(&counts, &f);
+	EXPECT_EQ(HashSetCount(&counts), 1);
+	EXPECT_EQ(frees.calls, 1);
+	EXPECT_EQ(((frequency *)HashSetLookup(&counts, &f))->occurrences, 2);
+	HashSetDispose(&counts);
+	EXPECT_EQ(frees.calls, 2);
+}
+
+TEST(HashSetTests, Colliding_keys_are_all_found) {
+	hashset set;
+	HashSetNew(&set, sizeof(int), 16, HashInt, CompareInt, NULL);
+	// Every multiple of 16 hashes to slot 0 of the initial table.
+	for (int i = 0; i < 12; i++) {
+	  int key = i * 16;
+	  HashSetEnter(&set, &key);
+	}
+	for (int i = 0; i < 12; i++) {
+	  int key = i * 16, miss = i * 16 + 1;
+	  EXPECT_NE(HashSetLookup(&set, &key), nullptr);
+	  EXPECT_EQ(HashSetLookup(&set, &miss), nullptr);
+	}
+	HashSetDispose(&set);
+}
+
+TEST(HashSetTests, Grows_past_initial_bucket_count) {
+	hashset set;
+	HashSetNew(&set, sizeof(int), 1, HashInt, CompareInt, NULL);
+	for (int i = 0; i < 10000; i++) {
+	  int key = i * 7919;
+	  HashSetEnter(&set, &key);
+	}
+	EXPECT_EQ(HashSetCount(&set), 10000);
+	EXPECT_GE(set.numBuckets, 10000);
+	for (int i = 0; i < 10000; i++) {
+	  int key = i * 7919;
+	  ASSERT_NE(HashSetLookup(&set, &key), nullptr);
+	}
+	HashSetDispose(&set);
+}
+
+TEST(HashSetTests, Map_visits_every_element_once) {
+	hashset set;
+	HashSetNew(&set, sizeof(int), 8, HashInt, CompareInt, NULL);
+	std::set<int> expected, seen;
+	for (int i = 0; i < 100; i++) {
+	  int key = (i * 37) % 101;
+	  HashSetEnter(&set, &key);
+	  expected.insert(key);
+	}
+	HashSetMap(&set, CollectInt, &seen);
+	EXPECT_EQ(seen, expected);
+	EXPECT_EQ(HashSetCount(&set), (int)expected.size());
+	HashSetDispose(&set);
+}
+
+TEST(HashSetTests, Out_of_range_hash_code_asserts) {
+	hashset set;
+	HashSetNew(&set, sizeof(int), 4, [](const void *, int numBuckets) { return numBuckets; },
+	           CompareInt, NULL);
+	int key = 1;
+	EXPECT_DEATH(HashSetEnter(&set, &key), "Hash code out of range.");
+	HashSetDispose(&set);
+}
+
+TEST(HashSetTests, Lower_load_factor_grows_sooner) {
+	hashset set;
+	HashSetNew(&set, sizeof(int), 16, HashInt, CompareInt, NULL);
+	HashSetSetMaxLoadFactor(&set, 0.5);
+	for (int i = 0; i < 8; i++) HashSetEnter(&set, &i);
+	EXPECT_EQ(set.numBuckets, 16);
+	int key = 8;
+	HashSetEnter(&set, &key);
+	EXPECT_EQ(set.numBuckets, 32);
+	HashSetDispose(&set);
+}
+
+TEST(HashSetTests, Setting_load_factor_below_current_load_grows_now) {
+	hashset set;
+	HashSetNew(&set, sizeof(int), 16, HashInt, CompareInt, NULL);
+	for (int i = 0; i < 12; i++) HashSetEnter(&set, &i);
+	HashSetSetMaxLoadFactor(&set, 0.25);
+	EXPECT_GE(set.numBuckets, 48);
+	for (int i = 0; i < 12; i++) EXPECT_NE(HashSetLookup(&set, &i), nullptr);
+	HashSetDispose(&set);
+}
+
+TEST(HashSetTests, SetMaxLoadFactor_rejects_full_table) {
+	hashset set;
+	HashSetNew(&set, sizeof(int), 16, HashInt, CompareInt, NULL);
+	EXPECT_DEATH(HashSetSetMaxLoadFactor(&set, 1.0), "Load factor must be between 0 and 1.");
+	HashSetDispose(&set);
+}
+
+TEST(HashSetTests, Incremental_rehash_keeps_every_element_reachable) {
+	hashset set;
+	FreeCounter frees;
+	HashSetNew(&set, sizeof(int), 64, HashInt, CompareInt, CountFree);
+	HashSetEnableIncrementalRehash(&set, 2);
+	mybool sawMigration = FALSE;
+	for (int i = 0; i < 5000; i++) {
+	  int key = i * 31;
+	  HashSetEnter(&set, &key);
+	  if (set.oldSlots != NULL) sawMigration = TRUE;
+	  // Every earlier key, wherever it currently lives, must still be found.
+	  if (i % 97 == 0) {
+	    for (int j = 0; j <= i; j++) {
+	      int earlier = j * 31;
+	      ASSERT_NE(HashSetLookup(&set, &earlier), nullptr) << j << " after " << i;
+	    }
+	  }
+	}
+	EXPECT_TRUE(sawMigration);
+	// Re-entering keys that may still sit in the old table replaces them in place.
+	for (int i = 0; i < 5000; i++) {
+	  int key = i * 31;
+	  HashSetEnter(&set, &key);
+	}
+	EXPECT_EQ(HashSetCount(&set), 5000);
+	EXPECT_EQ(frees.calls, 5000);
+	std::set<int> seen;
+	HashSetMap(&set, CollectInt, &seen);
+	EXPECT_EQ((int)seen.size(), 5000);
+	HashSetDispose(&set);
+	EXPECT_EQ(frees.calls, 10000);
+}
+
+TEST(HashSetTests, Disposing_mid_rehash_frees_each_element_once) {
+	hashset set;
+	FreeCounter frees;
+	HashSetNew(&set, sizeof(int), 1024, HashInt, CompareInt, CountFree);
+	HashSetEnableIncrementalRehash(&set, 4);
+	for (int i = 0; i < 900; i++) HashSetEnter(&set, &i);
+	ASSERT_NE(set.oldSlots, nullptr);
+	HashSetDispose(&set);
+	EXPECT_EQ(frees.calls, 900);
+}
+
+static int hash64Calls = 0;
+static uint64_t HashInt64(const void *elemAddr) {
+	hash64Calls++;
+	uint64_t key = (uint32_t)*(const int *)elemAddr;
+	key *= 0x9e3779b97f4a7c15ULL;
+	return key ^ (key >> 29);
+}
+
+static int compareCalls = 0;
+static int CountingCompareInt(const void *elemAddr1, const void *elemAddr2) {
+	compareCalls++;
+	return CompareInt(elemAddr1, elemAddr2);
+}
+
+TEST(HashSetTests, Hash64_set_enters_and_finds_elements) {
+	hashset set;
+	HashSetNewWithHash64(&set, sizeof(int), 4, HashInt64, CompareInt, NULL);
+	for (int i = 0; i < 3000; i++) HashSetEnter(&set, &i);
+	EXPECT_EQ(HashSetCount(&set), 3000);
+	for (int i = 0; i < 3000; i++) {
+	  int *found = (int *)HashSetLookup(&set, &i);
+	  ASSERT_NE(found, nullptr);
+	  EXPECT_EQ(*found, i);
+	}
+	int absent = -5;
+	EXPECT_EQ(HashSetLookup(&set, &absent), nullptr);
+	HashSetDispose(&set);
+}
+
+TEST(HashSetTests, Hash64_set_grows_without_rehashing_elements) {
+	hashset set;
+	HashSetNewWithHash64(&set, sizeof(int), 1, HashInt64, CompareInt, NULL);
+	hash64Calls = 0;
+	for (int i = 0; i < 10000; i++) HashSetEnter(&set, &i);
+	EXPECT_GE(set.numBuckets, 8192);
+	EXPECT_EQ(hash64Calls, 10000);
+	HashSetDispose(&set);
+}
+
+TEST(HashSetTests, Hash64_set_compares_only_on_matching_tags) {
+	hashset set;
+	HashSetNewWithHash64(&set, sizeof(int), 1024, HashInt64, CountingCompareInt, NULL);
+	for (int i = 0; i < 800; i++) HashSetEnter(&set, &i);
+	compareCalls = 0;
+	for (int i = 1000; i < 2000; i++) EXPECT_EQ(HashSetLookup(&set, &i), nullptr);
+	EXPECT_EQ(compareCalls, 0);
+	for (int i = 0; i < 800; i++) HashSetLookup(&set, &i);
+	EXPECT_EQ(compareCalls, 800);
+	HashSetDispose(&set);
+}
+
+TEST(HashSetTests, Hash64_set_survives_incremental_rehash) {
+	hashset set;
+	FreeCounter frees;
+	HashSetNewWithHash64(&set, sizeof(int), 8, HashInt64, CompareInt, CountFree);
+	HashSetEnableIncrementalRehash(&set, 2);
+	for (int i = 0; i < 4000; i++) {
+	  HashSetEnter(&set, &i);
+	  int probe = i / 2;
+	  ASSERT_NE(HashSetLookup(&set, &probe), nullptr);
+	}
+	std::set<int> seen;
+	HashSetMap(&set, CollectInt, &seen);
+	EXPECT_EQ((int)seen.size(), 4000);
+	HashSetDispose(&set);
+	EXPECT_EQ(frees.calls, 4000);
+}
+
+TEST(HashSetTests, LookupBatch_matches_single_lookups) {
+	hashset plain, tagged;
+	HashSetNew(&plain, sizeof(int), 64, HashInt, CompareInt, NULL);
+	HashSetNewWithHash64(&tagged, sizeof(int), 64, HashInt64, CompareInt, NULL);
+	for (int i = 0; i < 1000; i += 2) {
+	  HashSetEnter(&plain, &i);
+	  HashSetEnter(&tagged, &i);
+	}
+	// An odd count leaves a partial window at the end.
+	int keys[301];
+	void *results[301];
+	for (int i = 0; i < 301; i++) keys[i] = (i * 7) % 1200;
+	for (hashset *set : { &plain, &tagged }) {
+	  HashSetLookupBatch(set, keys, 301, results);
+	  for (int i = 0; i < 301; i++) EXPECT_EQ(results[i], HashSetLookup(set, &keys[i])) << keys[i];
+	}
+	HashSetLookupBatch(&plain, keys, 0, results);
+	HashSetDispose(&plain);
+	HashSetDispose(&tagged);
+}
+
+TEST(HashSetTests, LookupBatch_finds_elements_mid_rehash) {
+	hashset set;
+	HashSetNew(&set, sizeof(int), 1024, HashInt, CompareInt, NULL);
+	HashSetEnableIncrementalRehash(&set, 4);
+	for (int i = 0; i < 900; i++) HashSetEnter(&set, &i);
+	ASSERT_NE(set.oldSlots, nullptr);
+	int keys[1000];
+	void *results[1000];
+	for (int i = 0; i < 1000; i++) keys[i] = i;
+	HashSetLookupBatch(&set, keys, 1000, results);
+	for (int i = 0; i < 1000; i++) {
+	  if (i < 900) {
+	    ASSERT_NE(results[i], nullptr) << i;
+	    EXPECT_EQ(*(int *)results[i], i);
+	  } else {
+	    EXPECT_EQ(results[i], nullptr) << i;
+	  }
+	}
+	HashSetDispose(&set);
+}
+
+TEST(HashSetTests, LookupBatch_rejects_null_arrays) {
+	hashset set;
+	HashSetNew(&set, sizeof(int), 16, HashInt, CompareInt, NULL);
+	int key = 1;
+	void *result;
+	EXPECT_DEATH(HashSetLookupBatch(&set, NULL, 1, &result), "Element address is NULL.");
+	EXPECT_DEATH(HashSetLookupBatch(&set, &key, 1, NULL), "Element address is NULL.");
+	HashSetDispose(&set);
+}
+
+TEST(HashSetTests, FindOrEnter_enters_once_then_finds_without_replacing) {
+	hashset set;
+	FreeCounter frees;
+	HashSetNew(&set, sizeof(frequency), 4, HashFrequency, CompareLetter, CountFree);
+	// Counting letters in place; the table grows along the way.
+	const char *text = "the quick brown fox jumps over the lazy dog";
+	for (const char *c = text; *c != '\0'; c++) {
+	  if (*c == ' ') continue;
+	  frequency f = { *c, 1 };
+	  mybool inserted;
+	  frequency *entry = (frequency *)HashSetFindOrEnter(&set, &f, &inserted);
+	  ASSERT_NE(entry, nullptr);
+	  EXPECT_EQ(entry->ch, *c);
+	  if (!inserted) entry->occurrences++;
+	  EXPECT_EQ(entry, HashSetLookup(&set, &f));
+	}
+	EXPECT_EQ(HashSetCount(&set), 26);
+	EXPECT_EQ(frees.calls, 0);
+	frequency key = { 'o', 0 };
+	EXPECT_EQ(((frequency *)HashSetLookup(&set, &key))->occurrences, 4);
+	key.ch = 'e';
+	EXPECT_EQ(((frequency *)HashSetLookup(&set, &key))->occurrences, 3);
+	HashSetDispose(&set);
+	EXPECT_EQ(frees.calls, 26);
+}
+
+TEST(HashSetTests, FindOrEnter_returns_inserted_element_while_displacing_others) {
+	hashset plain, tagged;
+	HashSetNew(&plain, sizeof(int), 64, HashInt, CompareInt, NULL);
+	HashSetNewWithHash64(&tagged, sizeof(int), 64, HashInt64, CompareInt, NULL);
+	for (hashset *set : { &plain, &tagged }) {
+	  HashSetEnableIncrementalRehash(set, 2);
+	  for (int i = 0; i < 3000; i++) {
+	    int key = (i * 7919) % 4096;
+	    mybool inserted = FALSE;
+	    int *entry = (int *)HashSetFindOrEnter(set, &key, &inserted);
+	    ASSERT_NE(entry, nullptr);
+	    EXPECT_EQ(*entry, key);
+	    EXPECT_TRUE(inserted);
+	    EXPECT_EQ(entry, HashSetFindOrEnter(set, &key, &inserted));
+	    EXPECT_FALSE(inserted);
+	  }
+	  EXPECT_EQ(HashSetCount(set), 3000);
+	  std::set<int> seen;
+	  HashSetMap(set, CollectInt, &seen);
+	  EXPECT_EQ((int)seen.size(), 3000);
+	  HashSetDispose(set);
+	}
+}
+
+TEST(HashSetTests, FindOrEnter_rejects_null_element) {
+	hashset set;
+	HashSetNew(&set, sizeof(int), 16, HashInt, CompareInt, NULL);
+	EXPECT_DEATH(HashSetFindOrEnter(&set, NULL, NULL), "Element address is NULL.");
+	HashSetDispose(&set);
+}
+
+TEST(HashSetTests, Remove_frees_element_and_keeps_the_rest_reachable) {
+	hashset set;
+	FreeCounter frees;
+	// Every key homes to one of four slots, so the runs are long and a removal
+	// shifts many elements back.
+	HashSetNew(&set, sizeof(int), 64, [](const void *elemAddr, int numBuckets) {
+	  return (*(const int *)elemAddr % 4) * (numBuckets / 4);
+	}, CompareInt, CountFree);
+	for (int i = 0; i < 40; i++) HashSetEnter(&set, &i);
+	for (int i = 0; i < 40; i += 3) {
+	  EXPECT_TRUE(HashSetRemove(&set, &i));
+	  EXPECT_FALSE(HashSetRemove(&set, &i));
+	}
+	EXPECT_EQ(frees.calls, 14);
+	EXPECT_EQ(HashSetCount(&set), 26);
+	for (int i = 0; i < 40; i++) EXPECT_EQ(HashSetLookup(&set, &i) != nullptr, i % 3 != 0) << i;
+	HashSetDispose(&set);
+	EXPECT_EQ(frees.calls, 40);
+}
+
+static long TotalProbeDistance(const hashset *h) {
+	long total = 0;
+	for (int slot = 0; slot < h->numBuckets; slot++) {
+	  uint32_t distance;
+	  memcpy(&distance, h->slots + (size_t)slot * h->slotSize + h->distanceOffset, sizeof(distance));
+	  total += distance;
+	}
+	return total;
+}
+
+TEST(HashSetTests, Removals_leave_no_trace_in_probe_distances) {
+	hashset churned, fresh;
+	HashSetNewWithHash64(&churned, sizeof(int), 1024, HashInt64, CompareInt, NULL);
+	HashSetNewWithHash64(&fresh, sizeof(int), 1024, HashInt64, CompareInt, NULL);
+	for (int i = 0; i < 600; i++) HashSetEnter(&churned, &i);
+	for (int i = 600; i < 50000; i++) {
+	  int oldest = i - 600;
+	  ASSERT_TRUE(HashSetRemove(&churned, &oldest));
+	  HashSetEnter(&churned, &i);
+	}
+	for (int i = 50000 - 600; i < 50000; i++) HashSetEnter(&fresh, &i);
+	// With linear probing the total probe distance doesn't depend on the
+	// order the elements went in, so backward shifting must leave exactly
+	// the total a fresh table of the survivors has.
+	ASSERT_EQ(churned.numBuckets, fresh.numBuckets);
+	EXPECT_EQ(TotalProbeDistance(&churned), TotalProbeDistance(&fresh));
+	EXPECT_EQ(HashSetCount(&churned), 600);
+	HashSetDispose(&churned);
+	HashSetDispose(&fresh);
+}
+
+TEST(HashSetTests, Remove_mid_rehash_frees_each_element_once) {
+	hashset set;
+	FreeCounter frees;
+	HashSetNew(&set, sizeof(int), 1024, HashInt, CompareInt, CountFree);
+	HashSetEnableIncrementalRehash(&set, 4);
+	for (int i = 0; i < 900; i++) HashSetEnter(&set, &i);
+	ASSERT_NE(set.oldSlots, nullptr);
+	for (int i = 0; i < 900; i += 2) ASSERT_TRUE(HashSetRemove(&set, &i)) << i;
+	EXPECT_EQ(HashSetCount(&set), 450);
+	for (int i = 0; i < 900; i++) EXPECT_EQ(HashSetLookup(&set, &i) != nullptr, i % 2 == 1) << i;
+	HashSetDispose(&set);
+	EXPECT_EQ(frees.calls, 900);
+}
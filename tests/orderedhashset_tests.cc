@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+#include <set>
+#include <vector>
+
+extern "C" {
+  #include "orderedhashset.h"
+}
+#include "hashset_test_helpers.h"
+
+typedef struct {
+  int key;
+  int value;
+} pair;
+
+static int HashPair(const void *elemAddr, int numBuckets) {
+	return HashInt(&((const pair *)elemAddr)->key, numBuckets);
+}
+
+static int ComparePair(const void *elemAddr1, const void *elemAddr2) {
+	return ((const pair *)elemAddr1)->key - ((const pair *)elemAddr2)->key;
+}
+
+static void AppendInt(void *elemAddr, void *auxData) {
+	((std::vector<int> *)auxData)->push_back(*(int *)elemAddr);
+}
+
+static void AppendPair(void *elemAddr, void *auxData) {
+	((std::vector<pair> *)auxData)->push_back(*(pair *)elemAddr);
+}
+
+TEST(OrderedHashSetTests, Map_visits_elements_in_entry_order) {
+	orderedhashset set;
+	OrderedHashSetNew(&set, sizeof(int), 4, HashInt, CompareInt, NULL);
+	std::vector<int> entered;
+	for (int i = 0; i < 5000; i++) {
+	  int key = (i * 7919) % 10007;
+	  OrderedHashSetEnter(&set, &key);
+	  entered.push_back(key);
+	}
+	EXPECT_EQ(OrderedHashSetCount(&set), 5000);
+	EXPECT_GE(set.numBuckets, 5000);
+	std::vector<int> visited;
+	OrderedHashSetMap(&set, AppendInt, &visited);
+	EXPECT_EQ(visited, entered);
+	for (int key : entered) {
+	  int *found = (int *)OrderedHashSetLookup(&set, &key);
+	  ASSERT_NE(found, nullptr);
+	  EXPECT_EQ(*found, key);
+	}
+	int absent = 10007;
+	EXPECT_EQ(OrderedHashSetLookup(&set, &absent), nullptr);
+	OrderedHashSetDispose(&set);
+}
+
+TEST(OrderedHashSetTests, Enter_replaces_in_place_and_frees_old_one) {
+	orderedhashset set;
+	FreeCounter frees;
+	OrderedHashSetNew(&set, sizeof(pair), 16, HashPair, ComparePair, CountFree);
+	for (int i = 0; i < 3; i++) {
+	  pair p = { i, i };
+	  OrderedHashSetEnter(&set, &p);
+	}
+	pair replacement = { 0, 100 };
+	OrderedHashSetEnter(&set, &replacement);
+	EXPECT_EQ(frees.calls, 1);
+	EXPECT_EQ(OrderedHashSetCount(&set), 3);
+	std::vector<pair> visited;
+	OrderedHashSetMap(&set, AppendPair, &visited);
+	ASSERT_EQ(visited.size(), 3u);
+	EXPECT_EQ(visited[0].key, 0);
+	EXPECT_EQ(visited[0].value, 100);
+	EXPECT_EQ(visited[2].key, 2);
+	OrderedHashSetDispose(&set);
+	EXPECT_EQ(frees.calls, 4);
+}
+
+TEST(OrderedHashSetTests, FindOrEnter_enters_once_then_finds_without_replacing) {
+	orderedhashset set;
+	FreeCounter frees;
+	OrderedHashSetNew(&set, sizeof(pair), 4, HashPair, ComparePair, CountFree);
+	for (int i = 0; i < 3000; i++) {
+	  pair p = { i % 500, 1 };
+	  mybool inserted;
+	  pair *entry = (pair *)OrderedHashSetFindOrEnter(&set, &p, &inserted);
+	  ASSERT_NE(entry, nullptr);
+	  EXPECT_EQ(entry->key, i % 500);
+	  EXPECT_EQ(inserted, i < 500 ? TRUE : FALSE);
+	  if (!inserted) entry->value++;
+	}
+	EXPECT_EQ(OrderedHashSetCount(&set), 500);
+	EXPECT_EQ(frees.calls, 0);
+	std::vector<pair> visited;
+	OrderedHashSetMap(&set, AppendPair, &visited);
+	for (int i = 0; i < 500; i++) {
+	  EXPECT_EQ(visited[i].key, i);
+	  EXPECT_EQ(visited[i].value, 6);
+	}
+	OrderedHashSetDispose(&set);
+}
+
+TEST(OrderedHashSetTests, Remove_keeps_order_of_the_rest) {
+	orderedhashset set;
+	FreeCounter frees;
+	OrderedHashSetNew(&set, sizeof(int), 64, HashInt, CompareInt, CountFree);
+	for (int i = 0; i < 100; i++) OrderedHashSetEnter(&set, &i);
+	std::vector<int> expected;
+	for (int i = 0; i < 100; i++) {
+	  if (i % 3 == 0) {
+	    EXPECT_TRUE(OrderedHashSetRemove(&set, &i));
+	    EXPECT_FALSE(OrderedHashSetRemove(&set, &i));
+	  } else {
+	    expected.push_back(i);
+	  }
+	}
+	EXPECT_EQ(frees.calls, 34);
+	EXPECT_EQ(OrderedHashSetCount(&set), 66);
+	// Re-entering a removed element puts it at the end.
+	int back = 0;
+	OrderedHashSetEnter(&set, &back);
+	expected.push_back(0);
+	std::vector<int> visited;
+	OrderedHashSetMap(&set, AppendInt, &visited);
+	EXPECT_EQ(visited, expected);
+	for (int i = 0; i < 100; i++) {
+	  EXPECT_EQ(OrderedHashSetLookup(&set, &i) != nullptr, i % 3 != 0 || i == 0) << i;
+	}
+	OrderedHashSetDispose(&set);
+	EXPECT_EQ(frees.calls, 34 + 67);
+}
+
+TEST(OrderedHashSetTests, Churn_compacts_the_vector_and_keeps_lookups_right) {
+	orderedhashset set;
+	OrderedHashSetNew(&set, sizeof(int), 1024, HashInt, CompareInt, NULL);
+	for (int i = 0; i < 500; i++) OrderedHashSetEnter(&set, &i);
+	for (int i = 500; i < 100000; i++) {
+	  int oldest = i - 500;
+	  ASSERT_TRUE(OrderedHashSetRemove(&set, &oldest));
+	  OrderedHashSetEnter(&set, &i);
+	  ASSERT_LE(VectorLength(&set.elems), 2 * 500 + 1);
+	}
+	EXPECT_EQ(set.numBuckets, 1024);
+	std::vector<int> visited;
+	OrderedHashSetMap(&set, AppendInt, &visited);
+	ASSERT_EQ(visited.size(), 500u);
+	for (int i = 0; i < 500; i++) {
+	  EXPECT_EQ(visited[i], 100000 - 500 + i);
+	  int *found = (int *)OrderedHashSetLookup(&set, &visited[i]);
+	  ASSERT_NE(found, nullptr);
+	  EXPECT_EQ(*found, visited[i]);
+	}
+	int gone = 100000 - 501;
+	EXPECT_EQ(OrderedHashSetLookup(&set, &gone), nullptr);
+	OrderedHashSetDispose(&set);
+}
+
+TEST(OrderedHashSetTests, Colliding_hash_codes_are_all_found) {
+	orderedhashset set;
+	OrderedHashSetNew(&set, sizeof(int), 8, [](const void *, int) { return 7; }, CompareInt, NULL);
+	for (int i = 0; i < 200; i++) OrderedHashSetEnter(&set, &i);
+	for (int i = 0; i < 200; i += 2) OrderedHashSetRemove(&set, &i);
+	for (int i = 0; i < 200; i++) EXPECT_EQ(OrderedHashSetLookup(&set, &i) != nullptr, i % 2 == 1) << i;
+	OrderedHashSetDispose(&set);
+}
+
+TEST(OrderedHashSetTests, Out_of_range_hash_code_asserts) {
+	orderedhashset set;
+	OrderedHashSetNew(&set, sizeof(int), 16, [](const void *, int) { return -1; }, CompareInt, NULL);
+	int key = 1;
+	EXPECT_DEATH(OrderedHashSetEnter(&set, &key), "Hash code out of range.");
+	EXPECT_DEATH(OrderedHashSetLookup(&set, NULL), "Element address is NULL.");
+	OrderedHashSetDispose(&set);
+}
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include <cstring>
+
+extern "C" {
+  #include "stringvector.h"
+}
+
+static const char *const kWords[] = { "cold", "arctic", "blustery", "", "freezing",
+                                      "frigid", "icy", "nippy", "polar" };
+static const int kNumWords = sizeof(kWords) / sizeof(kWords[0]);
+
+static void AppendWords(stringvector *sv) {
+	for (int i = 0; i < kNumWords; i++) StringVectorAppend(sv, kWords[i]);
+}
+
+TEST(StringVectorTests, StringVectorNew_0_Length) {
+	stringvector words;
+	StringVectorNew(&words, 0);
+	EXPECT_EQ(StringVectorLength(&words), 0);
+	StringVectorDispose(&words);
+}
+
+TEST(StringVectorTests, Nth_returns_string_and_length) {
+	stringvector words;
+	StringVectorNew(&words, 1);
+	AppendWords(&words);
+	for (int i = 0; i < kNumWords; i++) {
+	  int length;
+	  EXPECT_STREQ(StringVectorNth(&words, i, &length), kWords[i]);
+	  EXPECT_EQ(length, (int)strlen(kWords[i]));
+	}
+	StringVectorDispose(&words);
+}
+
+TEST(StringVectorTests, Throws_nth_out_of_bounds) {
+	stringvector words;
+	StringVectorNew(&words, 4);
+	EXPECT_DEATH(StringVectorNth(&words, 0, NULL), "Index out of bounds.");
+	StringVectorAppend(&words, "ice");
+	EXPECT_DEATH(StringVectorNth(&words, -1, NULL), "Index out of bounds.");
+}
+
+TEST(StringVectorTests, Sort_orders_spans_by_strcmp) {
+	stringvector words;
+	StringVectorNew(&words, 4);
+	AppendWords(&words);
+	StringVectorSort(&words);
+	for (int i = 1; i < kNumWords; i++) {
+	  EXPECT_LT(strcmp(StringVectorNth(&words, i - 1, NULL), StringVectorNth(&words, i, NULL)), 0);
+	}
+	for (int i = 0; i < kNumWords; i++) {
+	  int length;
+	  const char *word = StringVectorNth(&words, i, &length);
+	  EXPECT_EQ(length, (int)strlen(word));
+	}
+	int length;
+	StringVectorNth(&words, kNumWords - 1, &length);
+	EXPECT_EQ(length, (int)strlen("polar"));
+	StringVectorDispose(&words);
+}
+
+TEST(StringVectorTests, Search_linear_and_binary) {
+	stringvector words;
+	StringVectorNew(&words, 4);
+	AppendWords(&words);
+	EXPECT_EQ(StringVectorSearch(&words, "icy", FALSE), 6);
+	EXPECT_EQ(StringVectorSearch(&words, "ic", FALSE), -1);
+	StringVectorSort(&words);
+	int found = StringVectorSearch(&words, "frigid", TRUE);
+	ASSERT_NE(found, -1);
+	EXPECT_STREQ(StringVectorNth(&words, found, NULL), "frigid");
+	EXPECT_EQ(StringVectorSearch(&words, "warm", TRUE), -1);
+	StringVectorDispose(&words);
+}
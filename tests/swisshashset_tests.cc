@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include <set>
+
+extern "C" {
+  #include "swisshashset.h"
+}
+#include "hashset_test_helpers.h"
+
+TEST(SwissHashSetTests, SwissHashSetNew_rounds_up_to_whole_groups) {
+	swisshashset set;
+	SwissHashSetNew(&set, sizeof(int), 5, HashInt, CompareInt, NULL);
+	EXPECT_EQ(set.numBuckets, 16);
+	EXPECT_EQ(SwissHashSetCount(&set), 0);
+	SwissHashSetDispose(&set);
+	SwissHashSetNew(&set, sizeof(int), 100, HashInt, CompareInt, NULL);
+	EXPECT_EQ(set.numBuckets, 128);
+	SwissHashSetDispose(&set);
+}
+
+TEST(SwissHashSetTests, Enter_then_lookup_finds_stored_copy) {
+	swisshashset set;
+	SwissHashSetNew(&set, sizeof(int), 16, HashInt, CompareInt, NULL);
+	for (int i = 0; i < 14; i++) SwissHashSetEnter(&set, &i);
+	EXPECT_EQ(set.numBuckets, 16);
+	for (int i = 0; i < 14; i++) {
+	  int *found = (int *)SwissHashSetLookup(&set, &i);
+	  ASSERT_NE(found, nullptr);
+	  EXPECT_EQ(*found, i);
+	}
+	int absent = 14;
+	EXPECT_EQ(SwissHashSetLookup(&set, &absent), nullptr);
+	SwissHashSetDispose(&set);
+}
+
+TEST(SwissHashSetTests, Enter_replaces_matching_element_and_frees_old_one) {
+	swisshashset set;
+	FreeCounter frees;
+	SwissHashSetNew(&set, sizeof(int), 16, HashInt, CompareInt, CountFree);
+	int key = 42;
+	SwissHashSetEnter(&set, &key);
+	SwissHashSetEnter(&set, &key);
+	EXPECT_EQ(SwissHashSetCount(&set), 1);
+	EXPECT_EQ(frees.calls, 1);
+	SwissHashSetDispose(&set);
+	EXPECT_EQ(frees.calls, 2);
+}
+
+TEST(SwissHashSetTests, Grows_and_keeps_every_element) {
+	swisshashset set;
+	SwissHashSetNew(&set, sizeof(int), 1, HashInt, CompareInt, NULL);
+	std::set<int> expected, seen;
+	for (int i = 0; i < 20000; i++) {
+	  int key = i * 7919;
+	  SwissHashSetEnter(&set, &key);
+	  expected.insert(key);
+	}
+	EXPECT_EQ(SwissHashSetCount(&set), 20000);
+	EXPECT_LE(SwissHashSetCount(&set), set.numBuckets - set.numBuckets / 8);
+	for (int key : expected) ASSERT_NE(SwissHashSetLookup(&set, &key), nullptr);
+	int absent = 1;
+	EXPECT_EQ(SwissHashSetLookup(&set, &absent), nullptr);
+	SwissHashSetMap(&set, CollectInt, &seen);
+	EXPECT_EQ(seen, expected);
+	SwissHashSetDispose(&set);
+}
+
+TEST(SwissHashSetTests, Colliding_hash_codes_spill_into_later_groups) {
+	swisshashset set;
+	SwissHashSetNew(&set, sizeof(int), 64, [](const void *, int) { return 7; }, CompareInt, NULL);
+	// Every element has the same group and tag, so all but the first sixteen
+	// live in groups the probe sequence only reaches after a full one.
+	for (int i = 0; i < 40; i++) SwissHashSetEnter(&set, &i);
+	for (int i = 0; i < 40; i++) ASSERT_NE(SwissHashSetLookup(&set, &i), nullptr);
+	int absent = 40;
+	EXPECT_EQ(SwissHashSetLookup(&set, &absent), nullptr);
+	SwissHashSetDispose(&set);
+}
+
+TEST(SwissHashSetTests, Out_of_range_hash_code_asserts) {
+	swisshashset set;
+	SwissHashSetNew(&set, sizeof(int), 16, [](const void *, int) { return -1; }, CompareInt, NULL);
+	int key = 1;
+	EXPECT_DEATH(SwissHashSetEnter(&set, &key), "Hash code out of range.");
+	SwissHashSetDispose(&set);
+}
+
+TEST(SwissHashSetTests, FindOrEnter_enters_once_then_finds_without_replacing) {
+	swisshashset set;
+	FreeCounter frees;
+	SwissHashSetNew(&set, sizeof(int), 16, HashInt, CompareInt, CountFree);
+	for (int round = 0; round < 2; round++) {
+	  for (int i = 0; i < 1000; i++) {
+	    mybool inserted = round == 0 ? FALSE : TRUE;
+	    int *entry = (int *)SwissHashSetFindOrEnter(&set, &i, &inserted);
+	    ASSERT_NE(entry, nullptr);
+	    EXPECT_EQ(*entry, i);
+	    EXPECT_EQ(inserted, round == 0 ? TRUE : FALSE);
+	    EXPECT_EQ(entry, SwissHashSetLookup(&set, &i));
+	  }
+	}
+	EXPECT_EQ(SwissHashSetCount(&set), 1000);
+	EXPECT_EQ(frees.calls, 0);
+	std::set<int> seen;
+	SwissHashSetMap(&set, CollectInt, &seen);
+	EXPECT_EQ((int)seen.size(), 1000);
+	SwissHashSetDispose(&set);
+	EXPECT_EQ(frees.calls, 1000);
+}
+
+TEST(SwissHashSetTests, Remove_in_full_group_leaves_reusable_tombstone) {
+	swisshashset set;
+	FreeCounter frees;
+	SwissHashSetNew(&set, sizeof(int), 64, [](const void *, int) { return 7; }, CompareInt, CountFree);
+	for (int i = 0; i < 40; i++) SwissHashSetEnter(&set, &i);
+	// 3 sits in the full first group, so later keys may have probed past it.
+	int key = 3;
+	EXPECT_TRUE(SwissHashSetRemove(&set, &key));
+	EXPECT_FALSE(SwissHashSetRemove(&set, &key));
+	EXPECT_EQ(frees.calls, 1);
+	EXPECT_EQ(set.deleted, 1);
+	EXPECT_EQ(SwissHashSetCount(&set), 39);
+	for (int i = 0; i < 40; i++) EXPECT_EQ(SwissHashSetLookup(&set, &i) != nullptr, i != 3) << i;
+	// The last key is in a group with room left, so its slot is just emptied.
+	key = 39;
+	EXPECT_TRUE(SwissHashSetRemove(&set, &key));
+	EXPECT_EQ(set.deleted, 1);
+	key = 100;
+	SwissHashSetEnter(&set, &key);
+	EXPECT_EQ(set.deleted, 0);
+	EXPECT_NE(SwissHashSetLookup(&set, &key), nullptr);
+	SwissHashSetDispose(&set);
+	EXPECT_EQ(frees.calls, 2 + 39);
+}
+
+TEST(SwissHashSetTests, Churn_clears_tombstones_without_growing) {
+	swisshashset set;
+	SwissHashSetNew(&set, sizeof(int), 1024, HashInt, CompareInt, NULL);
+	for (int i = 0; i < 400; i++) SwissHashSetEnter(&set, &i);
+	// A sliding window of 400 keys: the live count never passes 400, so the
+	// table has no need to double however many tombstones pile up.
+	for (int i = 400; i < 100000; i++) {
+	  int oldest = i - 400;
+	  ASSERT_TRUE(SwissHashSetRemove(&set, &oldest));
+	  SwissHashSetEnter(&set, &i);
+	}
+	EXPECT_EQ(set.numBuckets, 1024);
+	EXPECT_EQ(SwissHashSetCount(&set), 400);
+	std::set<int> seen;
+	SwissHashSetMap(&set, CollectInt, &seen);
+	EXPECT_EQ((int)seen.size(), 400);
+	EXPECT_EQ(*seen.begin(), 100000 - 400);
+	SwissHashSetDispose(&set);
+}
@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <cstring>
 
 extern "C" {
   #include "vector.h"
@@ -17,6 +18,16 @@ TEST(VectorTests, Throws_nth_with_0_Capacity) {
 	EXPECT_DEATH(VectorNth(&myIntVector, 0), "Index out of bounds.");
 }
 
+TEST(VectorTests, Throws_nth_with_negative_position) {
+	vector myIntVector;
+	VectorNew(&myIntVector, sizeof(int), NULL, 10);
+	int n = 1;
+	VectorAppend(&myIntVector, &n);
+	EXPECT_DEATH(VectorNth(&myIntVector, -1), "Index out of bounds.");
+	EXPECT_DEATH(VectorReplace(&myIntVector, &n, -1), "Index out of bounds.");
+	EXPECT_DEATH(VectorDelete(&myIntVector, -1), "Index out of bounds.");
+}
+
 TEST(VectorTests, VectorAppend_Add_element_to_end) {
 	vector myIntVector;
 	VectorNew(&myIntVector, sizeof(int), NULL, 10); 
@@ -353,3 +364,437 @@ TEST(VectorTest, Search_uses_binary_search){
 }
 //Test bineary search
 
+
+static void AppendInts(vector *v, const int *numbers, int count) {
+	for (int i = 0; i < count; i++) {
+	  VectorAppend(v, &numbers[i]);
+	}
+}
+
+static void ExpectInts(const vector *v, const int *expected, int count) {
+	ASSERT_EQ(VectorLength(v), count);
+	for (int i = 0; i < count; i++) {
+	  EXPECT_EQ(expected[i], *(int *)VectorNth(v, i));
+	}
+}
+
+TEST(VectorTest, Append_grows_past_double_initial_allocation) {
+	vector myVector;
+	VectorNew(&myVector, sizeof(int), NULL, 1);
+	int numbers[] = { 1, 2, 3, 4, 5, 6, 7 };
+	AppendInts(&myVector, numbers, 7);
+	ExpectInts(&myVector, numbers, 7);
+	EXPECT_GE(myVector.capacity, 7);
+}
+
+TEST(VectorTest, MergeSorted_interleaves_both_inputs) {
+	vector a, b, out;
+	VectorNew(&a, sizeof(int), NULL, 4);
+	VectorNew(&b, sizeof(int), NULL, 4);
+	VectorNew(&out, sizeof(int), NULL, 0);
+	int left[] = { 1, 3, 3, 8, 9 };
+	int right[] = { 2, 3, 4, 10, 11, 12 };
+	AppendInts(&a, left, 5);
+	AppendInts(&b, right, 6);
+	VectorMergeSorted(&a, &b, &out, CompareInts);
+	int expected[] = { 1, 2, 3, 3, 3, 4, 8, 9, 10, 11, 12 };
+	ExpectInts(&out, expected, 11);
+}
+
+TEST(VectorTest, MergeSorted_throws_on_mismatched_sizes) {
+	vector a, b, out;
+	VectorNew(&a, sizeof(int), NULL, 4);
+	VectorNew(&b, sizeof(char), NULL, 4);
+	VectorNew(&out, sizeof(int), NULL, 4);
+	EXPECT_DEATH(VectorMergeSorted(&a, &b, &out, CompareInts),
+	             "Failed set operation, element sizes differ.");
+}
+
+TEST(VectorTest, UnionSorted_keeps_one_copy_of_shared_elements) {
+	vector a, b, out;
+	VectorNew(&a, sizeof(int), NULL, 4);
+	VectorNew(&b, sizeof(int), NULL, 4);
+	VectorNew(&out, sizeof(int), NULL, 4);
+	int left[] = { 1, 2, 4, 7 };
+	int right[] = { 2, 3, 4, 5, 9 };
+	AppendInts(&a, left, 4);
+	AppendInts(&b, right, 5);
+	VectorUnionSorted(&a, &b, &out, CompareInts);
+	int expected[] = { 1, 2, 3, 4, 5, 7, 9 };
+	ExpectInts(&out, expected, 7);
+}
+
+TEST(VectorTest, IntersectSorted_gallops_through_long_input) {
+	vector a, b, out;
+	VectorNew(&a, sizeof(int), NULL, 4);
+	VectorNew(&b, sizeof(int), NULL, 1000);
+	VectorNew(&out, sizeof(int), NULL, 4);
+	int few[] = { 5, 500, 999, 2000 };
+	AppendInts(&a, few, 4);
+	for (int i = 0; i < 1000; i++) VectorAppend(&b, &i);
+	VectorIntersectSorted(&a, &b, &out, CompareInts);
+	int expected[] = { 5, 500, 999 };
+	ExpectInts(&out, expected, 3);
+}
+
+TEST(VectorTest, DifferenceSorted_drops_elements_of_second_input) {
+	vector a, b, out;
+	VectorNew(&a, sizeof(int), NULL, 4);
+	VectorNew(&b, sizeof(int), NULL, 4);
+	VectorNew(&out, sizeof(int), NULL, 4);
+	int left[] = { 1, 2, 3, 4, 5, 6 };
+	int right[] = { 0, 2, 4, 6, 8 };
+	AppendInts(&a, left, 6);
+	AppendInts(&b, right, 5);
+	VectorDifferenceSorted(&a, &b, &out, CompareInts);
+	int expected[] = { 1, 3, 5 };
+	ExpectInts(&out, expected, 3);
+}
+
+TEST(VectorTest, Unique_throws_when_no_cpr_fn) {
+	vector myVector;
+	VectorNew(&myVector, sizeof(int), NULL, 4);
+	EXPECT_DEATH(VectorUnique(&myVector, NULL), "Failed unique, no compare function provided.");
+}
+
+TEST(VectorTest, Unique_compacts_adjacent_duplicates) {
+	vector myVector;
+	VectorNew(&myVector, sizeof(int), NULL, 4);
+	int numbers[] = { 1, 1, 2, 3, 3, 3, 1, 4 };
+	AppendInts(&myVector, numbers, 8);
+	VectorUnique(&myVector, CompareInts);
+	int expected[] = { 1, 2, 3, 1, 4 };
+	ExpectInts(&myVector, expected, 5);
+}
+
+TEST(VectorTest, Unique_frees_dropped_elements) {
+	vector myVector;
+	mock_free_called = 0;
+	VectorNew(&myVector, sizeof(int), MockCharStringFree, 4);
+	int numbers[] = { 7, 7, 7, 8 };
+	AppendInts(&myVector, numbers, 4);
+	VectorUnique(&myVector, CompareInts);
+	EXPECT_EQ(mock_free_called, 2);
+	EXPECT_EQ(VectorLength(&myVector), 2);
+}
+
+TEST(VectorTest, SortUnique_leaves_distinct_sorted_values) {
+	vector myVector;
+	VectorNew(&myVector, sizeof(int), NULL, 4);
+	int numbers[] = { 5, 3, 5, 1, 3, 9, 1 };
+	AppendInts(&myVector, numbers, 7);
+	VectorSortUnique(&myVector, CompareInts);
+	int expected[] = { 1, 3, 5, 9 };
+	ExpectInts(&myVector, expected, 4);
+}
+
+TEST(VectorTest, NthElement_places_sorted_element_at_position) {
+	vector myVector;
+	VectorNew(&myVector, sizeof(int), NULL, 4);
+	for (int i = 0; i < 100; i++) {
+	  int n = (i * 37) % 100;
+	  VectorAppend(&myVector, &n);
+	}
+	VectorNthElement(&myVector, 42, CompareInts);
+	EXPECT_EQ(*(int *)VectorNth(&myVector, 42), 42);
+	for (int i = 0; i < 100; i++) {
+	  int n = *(int *)VectorNth(&myVector, i);
+	  if (i < 42) EXPECT_LT(n, 42);
+	  if (i > 42) EXPECT_GT(n, 42);
+	}
+}
+
+TEST(VectorTest, NthElement_throws_on_out_of_bounds) {
+	vector myVector;
+	VectorNew(&myVector, sizeof(int), NULL, 4);
+	EXPECT_DEATH(VectorNthElement(&myVector, 0, CompareInts), "Index out of bounds.");
+	int n = 1;
+	VectorAppend(&myVector, &n);
+	EXPECT_DEATH(VectorNthElement(&myVector, -1, CompareInts), "Index out of bounds.");
+}
+
+TEST(VectorTest, PartialSort_orders_the_k_smallest) {
+	vector myVector;
+	VectorNew(&myVector, sizeof(int), NULL, 4);
+	int numbers[] = { 9, 4, 7, 1, 8, 2, 6, 3, 5, 0 };
+	AppendInts(&myVector, numbers, 10);
+	VectorPartialSort(&myVector, 4, CompareInts);
+	int expected[] = { 0, 1, 2, 3 };
+	for (int i = 0; i < 4; i++) {
+	  EXPECT_EQ(expected[i], *(int *)VectorNth(&myVector, i));
+	}
+	EXPECT_EQ(VectorLength(&myVector), 10);
+}
+
+TEST(VectorTest, PartialSort_throws_when_k_too_large) {
+	vector myVector;
+	VectorNew(&myVector, sizeof(int), NULL, 4);
+	int n = 1;
+	VectorAppend(&myVector, &n);
+	EXPECT_DEATH(VectorPartialSort(&myVector, 2, CompareInts), "Failed partial sort, k out of bounds.");
+}
+
+TEST(VectorTest, Heap_pops_in_descending_order) {
+	vector myVector;
+	VectorNew(&myVector, sizeof(int), NULL, 4);
+	int numbers[] = { 5, 1, 9, 3, 7, 2, 8 };
+	AppendInts(&myVector, numbers, 7);
+	VectorHeapify(&myVector, CompareInts);
+	EXPECT_EQ(*(int *)VectorHeapTop(&myVector), 9);
+	int pushed = 6;
+	VectorHeapPush(&myVector, &pushed, CompareInts);
+	int expected[] = { 9, 8, 7, 6, 5, 3, 2, 1 };
+	for (int i = 0; i < 8; i++) {
+	  int top;
+	  VectorHeapPop(&myVector, &top, CompareInts);
+	  EXPECT_EQ(expected[i], top);
+	}
+	EXPECT_EQ(VectorLength(&myVector), 0);
+}
+
+TEST(VectorTest, Dary_heap_pops_in_descending_order) {
+	vector myVector;
+	VectorNew(&myVector, sizeof(int), NULL, 0);
+	for (int i = 0; i < 50; i++) {
+	  int n = (i * 31) % 50;
+	  VectorHeapPushDary(&myVector, &n, 4, CompareInts);
+	}
+	for (int i = 49; i >= 0; i--) {
+	  int top;
+	  VectorHeapPopDary(&myVector, &top, 4, CompareInts);
+	  EXPECT_EQ(i, top);
+	}
+}
+
+TEST(VectorTest, HeapPop_without_destination_frees_element) {
+	vector myVector;
+	mock_free_called = 0;
+	VectorNew(&myVector, sizeof(int), MockCharStringFree, 4);
+	int n = 3;
+	VectorHeapPush(&myVector, &n, CompareInts);
+	VectorHeapPop(&myVector, NULL, CompareInts);
+	EXPECT_EQ(mock_free_called, 1);
+}
+
+TEST(VectorTest, HeapTop_throws_on_empty_heap) {
+	vector myVector;
+	VectorNew(&myVector, sizeof(int), NULL, 4);
+	EXPECT_DEATH(VectorHeapTop(&myVector), "Failed heap operation, heap is empty.");
+}
+
+TEST(VectorTest, Plain_vector_reports_heap_backing) {
+	vector myVector;
+	VectorNew(&myVector, sizeof(int), NULL, 4);
+	VectorStats stats;
+	VectorGetStats(&myVector, &stats);
+	EXPECT_EQ(stats.backing, kVectorBackingHeap);
+	EXPECT_EQ(stats.capacity, 4);
+	EXPECT_EQ(stats.bytesAllocated, 4 * sizeof(int));
+	VectorDispose(&myVector);
+}
+
+TEST(VectorTest, Aligned_vector_stays_aligned_while_growing) {
+	vector myVector;
+	VectorNewAligned(&myVector, sizeof(int), NULL, 1, 64, FALSE);
+	for (int i = 0; i < 1000; i++) {
+	  VectorAppend(&myVector, &i);
+	  ASSERT_EQ((uintptr_t)VectorNth(&myVector, 0) % 64, 0u);
+	}
+	for (int i = 0; i < 1000; i++) {
+	  EXPECT_EQ(*(int *)VectorNth(&myVector, i), i);
+	}
+	VectorStats stats;
+	VectorGetStats(&myVector, &stats);
+	EXPECT_EQ(stats.backing, kVectorBackingAligned);
+	EXPECT_EQ(stats.alignment, 64u);
+	VectorDispose(&myVector);
+}
+
+TEST(VectorTest, Aligned_vector_throws_on_bad_alignment) {
+	vector myVector;
+	EXPECT_DEATH(VectorNewAligned(&myVector, sizeof(int), NULL, 4, 48, FALSE),
+	             "Alignment must be a power of two.");
+}
+
+TEST(VectorTest, Large_vector_maps_huge_pages_when_allowed) {
+	vector myVector;
+	VectorNewAligned(&myVector, sizeof(long), NULL, 1 << 19, 64, TRUE);
+	VectorStats stats;
+	VectorGetStats(&myVector, &stats);
+	EXPECT_NE(stats.backing, kVectorBackingHeap);
+	EXPECT_GE(stats.bytesAllocated, (size_t)(1 << 19) * sizeof(long));
+	for (long i = 0; i < (1 << 19) + 1; i++) VectorAppend(&myVector, &i);
+	EXPECT_EQ(*(long *)VectorNth(&myVector, 1 << 19), 1L << 19);
+	VectorDispose(&myVector);
+}
+
+static int CompareStrings(const void *lhs, const void *rhs) {
+	return strcmp(*(const char **)lhs, *(const char **)rhs);
+}
+
+TEST(VectorTest, SortStrings_matches_strcmp_order) {
+	const char *words[] = { "polar", "icy", "", "freezing", "frigid", "arctic",
+	                        "blustery", "icy", "freezingly", "nippy", "cold", "a",
+	                        "frigidaire", "ab", "\xc3\xa9t\xc3\xa9", "polaroid" };
+	const int count = sizeof(words) / sizeof(words[0]);
+	vector sorted, expected;
+	VectorNew(&sorted, sizeof(char *), NULL, 4);
+	VectorNew(&expected, sizeof(char *), NULL, 4);
+	for (int i = 0; i < count; i++) {
+	  VectorAppend(&sorted, &words[i]);
+	  VectorAppend(&expected, &words[i]);
+	}
+	VectorSortStrings(&sorted);
+	VectorSort(&expected, CompareStrings);
+	for (int i = 0; i < count; i++) {
+	  EXPECT_STREQ(*(char **)VectorNth(&expected, i), *(char **)VectorNth(&sorted, i));
+	}
+}
+
+TEST(VectorTest, SortStrings_moves_records_whole) {
+	typedef struct {
+	  const char *word;
+	  int rank;
+	} ranked;
+	const char *words[] = { "polar", "icy", "", "freezing", "arctic", "icy", "nippy" };
+	const int count = sizeof(words) / sizeof(words[0]);
+	vector records;
+	VectorNew(&records, sizeof(ranked), NULL, 4);
+	for (int i = 0; i < count; i++) {
+	  ranked r = { words[i], i };
+	  VectorAppend(&records, &r);
+	}
+	VectorSortStrings(&records);
+	const int expectedRanks[] = { 2, 4, 3, 1, 5, 6, 0 };   // "icy" twice, in either order
+	for (int i = 0; i < count; i++) {
+	  const ranked *r = (const ranked *)VectorNth(&records, i);
+	  EXPECT_STREQ(r->word, words[r->rank]);
+	  if (i != 3 && i != 4) EXPECT_EQ(r->rank, expectedRanks[i]);
+	}
+	VectorDispose(&records);
+}
+
+TEST(VectorTest, SortStrings_throws_on_non_pointer_elements) {
+	vector myVector;
+	VectorNew(&myVector, sizeof(char), NULL, 4);
+	EXPECT_DEATH(VectorSortStrings(&myVector), "Failed string sort, elements are not char \\*s.");
+}
+
+TEST(VectorTest, MarkDeleted_throws_without_tombstones) {
+	vector myVector;
+	VectorNew(&myVector, sizeof(int), NULL, 4);
+	int n = 1;
+	VectorAppend(&myVector, &n);
+	EXPECT_DEATH(VectorMarkDeleted(&myVector, 0), "Tombstones are not enabled for this vector.");
+}
+
+TEST(VectorTest, MarkDeleted_throws_on_negative_position) {
+	vector myVector;
+	VectorNew(&myVector, sizeof(int), NULL, 4);
+	VectorEnableTombstones(&myVector, 0);
+	int n = 1;
+	VectorAppend(&myVector, &n);
+	EXPECT_DEATH(VectorMarkDeleted(&myVector, -1), "Index out of bounds.");
+	EXPECT_DEATH(VectorIsDeleted(&myVector, -1), "Index out of bounds.");
+}
+
+TEST(VectorTest, Tombstoned_slots_are_skipped_by_map_and_search) {
+	vector myVector;
+	mapCounter = 0;
+	VectorNew(&myVector, sizeof(int), NULL, 3);
+	VectorEnableTombstones(&myVector, 0);
+	int numbers[] = { 1, 2, 3 };
+	AppendInts(&myVector, numbers, 3);
+	VectorMarkDeleted(&myVector, 1);
+	EXPECT_EQ(VectorLength(&myVector), 3);
+	EXPECT_EQ(VectorLiveLength(&myVector), 2);
+	EXPECT_TRUE(VectorIsDeleted(&myVector, 1));
+	VectorMap(&myVector, MockMapFn, NULL);
+	EXPECT_EQ(mapCounter, 2);
+	const int key = 2;
+	EXPECT_EQ(VectorSearch(&myVector, &key, CompareInts, 0, mybool::FALSE), -1);
+	EXPECT_EQ(VectorSearch(&myVector, &key, CompareInts, 0, mybool::TRUE), -1);
+}
+
+TEST(VectorTest, Sorted_search_finds_live_duplicate_next_to_tombstone) {
+	vector myVector;
+	VectorNew(&myVector, sizeof(int), NULL, 4);
+	VectorEnableTombstones(&myVector, 0);
+	int numbers[] = { 1, 4, 4, 9 };
+	AppendInts(&myVector, numbers, 4);
+	VectorMarkDeleted(&myVector, 1);
+	const int key = 4;
+	EXPECT_EQ(VectorSearch(&myVector, &key, CompareInts, 0, mybool::TRUE), 2);
+}
+
+TEST(VectorTest, Compact_frees_and_removes_dead_slots) {
+	vector myVector;
+	mock_free_called = 0;
+	VectorNew(&myVector, sizeof(int), MockCharStringFree, 4);
+	VectorEnableTombstones(&myVector, 0);
+	int numbers[] = { 1, 2, 3, 4, 5 };
+	AppendInts(&myVector, numbers, 5);
+	VectorMarkDeleted(&myVector, 0);
+	VectorMarkDeleted(&myVector, 3);
+	EXPECT_EQ(mock_free_called, 0);
+	VectorCompact(&myVector);
+	EXPECT_EQ(mock_free_called, 2);
+	int expected[] = { 2, 3, 5 };
+	ExpectInts(&myVector, expected, 3);
+	EXPECT_FALSE(VectorIsDeleted(&myVector, 0));
+}
+
+TEST(VectorTest, Compacts_automatically_past_dead_fraction) {
+	vector myVector;
+	VectorNew(&myVector, sizeof(int), NULL, 1);
+	VectorEnableTombstones(&myVector, 0.5);
+	int numbers[] = { 1, 2, 3, 4 };
+	AppendInts(&myVector, numbers, 4);
+	VectorMarkDeleted(&myVector, 0);
+	VectorMarkDeleted(&myVector, 1);
+	EXPECT_EQ(VectorLength(&myVector), 4);
+	VectorMarkDeleted(&myVector, 2);
+	int expected[] = { 4 };
+	ExpectInts(&myVector, expected, 1);
+}
+
+TEST(VectorTest, Insert_and_delete_keep_tombstones_with_their_elements) {
+	vector myVector;
+	VectorNew(&myVector, sizeof(int), NULL, 2);
+	VectorEnableTombstones(&myVector, 0);
+	int numbers[] = { 1, 2, 3 };
+	AppendInts(&myVector, numbers, 3);
+	VectorMarkDeleted(&myVector, 1);
+	int zero = 0;
+	VectorInsert(&myVector, &zero, 0);
+	EXPECT_TRUE(VectorIsDeleted(&myVector, 2));
+	VectorDelete(&myVector, 0);
+	EXPECT_TRUE(VectorIsDeleted(&myVector, 1));
+	VectorDelete(&myVector, 1);
+	EXPECT_EQ(VectorLiveLength(&myVector), 2);
+	VectorSort(&myVector, CompareInts);
+	int expected[] = { 1, 3 };
+	ExpectInts(&myVector, expected, 2);
+}
+
+TEST(VectorTest, Every_element_size_round_trips_through_append_insert_and_replace) {
+	const int sizes[] = { 1, 2, 3, 4, 8, 12, 16, 24, 32, 33 };
+	for (int elemSize : sizes) {
+	  vector myVector;
+	  VectorNew(&myVector, elemSize, NULL, 1);
+	  unsigned char elem[64];
+	  for (int i = 0; i < 20; i++) {
+	    memset(elem, i, elemSize);
+	    if (i % 2 == 0) VectorAppend(&myVector, elem);
+	    else VectorInsert(&myVector, elem, 0);
+	  }
+	  memset(elem, 0xab, elemSize);
+	  VectorReplace(&myVector, elem, 10);
+	  for (int i = 0; i < 20; i++) {
+	    int expected = i == 10 ? 0xab : i < 10 ? 19 - 2 * i : 2 * (i - 10);
+	    const unsigned char *stored = (const unsigned char *)VectorNth(&myVector, i);
+	    for (int b = 0; b < elemSize; b++) EXPECT_EQ(stored[b], expected) << "elemSize " << elemSize;
+	  }
+	  VectorDispose(&myVector);
+	}
+}
@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+
+extern "C" {
+  #include "vectorpipeline.h"
+}
+
+static void AppendRange(vector *v, int count) {
+	for (int i = 0; i < count; i++) VectorAppend(v, &i);
+}
+
+static void SquareToLong(void *destAddr, const void *srcAddr, void *auxData) {
+	long value = *(const int *)srcAddr;
+	*(long *)destAddr = value * value;
+}
+
+static void AddOffset(void *destAddr, const void *srcAddr, void *auxData) {
+	*(long *)destAddr = *(const long *)srcAddr + *(const long *)auxData;
+}
+
+static mybool IsOdd(const void *elemAddr, void *auxData) {
+	return *(const int *)elemAddr % 2 != 0 ? TRUE : FALSE;
+}
+
+static mybool IsMultipleOfThree(const void *elemAddr, void *auxData) {
+	return *(const long *)elemAddr % 3 == 0 ? TRUE : FALSE;
+}
+
+static void AddLong(void *accumulatorAddr, const void *elemAddr, void *auxData) {
+	*(long *)accumulatorAddr += *(const long *)elemAddr;
+}
+
+static void CountElements(void *accumulatorAddr, const void *elemAddr, void *auxData) {
+	(*(long *)accumulatorAddr)++;
+}
+
+TEST(VectorPipelineTests, Filter_transform_reduce_in_one_pass) {
+	vector numbers;
+	VectorNew(&numbers, sizeof(int), NULL, 4);
+	AppendRange(&numbers, 100);
+	vectorpipeline squares;
+	VectorPipelineNew(&squares, &numbers);
+	VectorPipelineFilter(&squares, IsOdd, NULL);
+	VectorPipelineTransform(&squares, SquareToLong, sizeof(long), NULL);
+	long sum = 0, expected = 0;
+	VectorPipelineReduce(&squares, &sum, AddLong, NULL);
+	for (long i = 1; i < 100; i += 2) expected += i * i;
+	EXPECT_EQ(sum, expected);
+	VectorPipelineDispose(&squares);
+	VectorDispose(&numbers);
+}
+
+TEST(VectorPipelineTests, Collect_chains_stages_in_order) {
+	vector numbers;
+	VectorNew(&numbers, sizeof(int), NULL, 4);
+	AppendRange(&numbers, 10);
+	long offset = 2;
+	vectorpipeline p;
+	VectorPipelineNew(&p, &numbers);
+	VectorPipelineTransform(&p, SquareToLong, sizeof(long), NULL);
+	VectorPipelineTransform(&p, AddOffset, sizeof(long), &offset);
+	VectorPipelineFilter(&p, IsMultipleOfThree, NULL);
+	vector out;
+	VectorNew(&out, sizeof(long), NULL, 4);
+	VectorPipelineCollect(&p, &out);
+	long expected[] = { 3, 6, 18, 27, 51, 66 };   // i * i + 2 for i = 1, 2, 4, 5, 7, 8
+	ASSERT_EQ(VectorLength(&out), 6);
+	for (int i = 0; i < 6; i++) EXPECT_EQ(*(long *)VectorNth(&out, i), expected[i]);
+	VectorDispose(&out);
+	VectorPipelineDispose(&p);
+	VectorDispose(&numbers);
+}
+
+typedef struct {
+  int a, b, c;
+} triple;
+
+static void ToTriple(void *destAddr, const void *srcAddr, void *auxData) {
+	int value = *(const int *)srcAddr;
+	triple t = { value, value + 1, value + 2 };
+	*(triple *)destAddr = t;
+}
+
+static void SumTriple(void *destAddr, const void *srcAddr, void *auxData) {
+	const triple *t = (const triple *)srcAddr;
+	*(long *)destAddr = (long)t->a + t->b + t->c;
+}
+
+static void LongToDouble(void *destAddr, const void *srcAddr, void *auxData) {
+	*(double *)destAddr = *(const long *)srcAddr / 2.0;
+}
+
+TEST(VectorPipelineTests, Mixed_size_stages_get_aligned_scratch) {
+	vector numbers;
+	VectorNew(&numbers, sizeof(int), NULL, 4);
+	AppendRange(&numbers, 100);
+	vectorpipeline p;
+	VectorPipelineNew(&p, &numbers);
+	VectorPipelineTransform(&p, ToTriple, sizeof(triple), NULL);
+	VectorPipelineTransform(&p, SumTriple, sizeof(long), NULL);
+	VectorPipelineTransform(&p, LongToDouble, sizeof(double), NULL);
+	EXPECT_EQ(p.maxElemSize % alignof(max_align_t), 0u);
+	vector out;
+	VectorNew(&out, sizeof(double), NULL, 4);
+	VectorPipelineCollect(&p, &out);
+	ASSERT_EQ(VectorLength(&out), 100);
+	for (int i = 0; i < 100; i++) EXPECT_EQ(*(double *)VectorNth(&out, i), (3 * i + 3) / 2.0);
+	VectorDispose(&out);
+	VectorPipelineDispose(&p);
+	VectorDispose(&numbers);
+}
+
+TEST(VectorPipelineTests, Empty_source_and_empty_pipeline) {
+	vector numbers;
+	VectorNew(&numbers, sizeof(int), NULL, 4);
+	vectorpipeline p;
+	VectorPipelineNew(&p, &numbers);
+	long count = 0;
+	VectorPipelineReduce(&p, &count, CountElements, NULL);
+	EXPECT_EQ(count, 0);
+	AppendRange(&numbers, 7);
+	VectorPipelineReduce(&p, &count, CountElements, NULL);
+	EXPECT_EQ(count, 7);
+	VectorPipelineDispose(&p);
+	VectorDispose(&numbers);
+}
+
+TEST(VectorPipelineTests, Tombstoned_elements_are_skipped) {
+	vector numbers;
+	VectorNew(&numbers, sizeof(int), NULL, 4);
+	VectorEnableTombstones(&numbers, 1);
+	AppendRange(&numbers, 10);
+	VectorMarkDeleted(&numbers, 1);
+	VectorMarkDeleted(&numbers, 3);
+	vectorpipeline p;
+	VectorPipelineNew(&p, &numbers);
+	VectorPipelineFilter(&p, IsOdd, NULL);
+	long count = 0;
+	VectorPipelineReduce(&p, &count, CountElements, NULL);
+	EXPECT_EQ(count, 3);
+	VectorPipelineDispose(&p);
+	VectorDispose(&numbers);
+}
+
+TEST(VectorPipelineTests, Parallel_reduce_matches_serial_reduce) {
+	vector numbers;
+	VectorNew(&numbers, sizeof(int), NULL, 1024);
+	AppendRange(&numbers, 100003);
+	vectorpipeline squares;
+	VectorPipelineNew(&squares, &numbers);
+	VectorPipelineFilter(&squares, IsOdd, NULL);
+	VectorPipelineTransform(&squares, SquareToLong, sizeof(long), NULL);
+	long serial = 0;
+	VectorPipelineReduce(&squares, &serial, AddLong, NULL);
+	for (int threads = 1; threads <= 8; threads++) {
+	  long parallel = 0;
+	  VectorPipelineReduceParallel(&squares, &parallel, sizeof(long), AddLong, AddLong, NULL, threads);
+	  EXPECT_EQ(parallel, serial) << threads << " threads";
+	}
+	VectorPipelineDispose(&squares);
+	VectorDispose(&numbers);
+}
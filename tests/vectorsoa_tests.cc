@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <cstddef>
+
+extern "C" {
+  #include "vectorsoa.h"
+}
+
+typedef struct {
+	char tag;
+	double price;
+	int quantity;
+} order;
+
+static const VectorSoAField kOrderFields[] = {
+	{ offsetof(order, tag), sizeof(char) },
+	{ offsetof(order, price), sizeof(double) },
+	{ offsetof(order, quantity), sizeof(int) },
+};
+
+static void NewOrderVector(vectorsoa *v, int initialAllocation) {
+	VectorSoANew(v, sizeof(order), kOrderFields, 3, initialAllocation);
+}
+
+TEST(VectorSoATests, VectorSoANew_0_Length) {
+	vectorsoa orders;
+	NewOrderVector(&orders, 4);
+	EXPECT_EQ(VectorSoALength(&orders), 0);
+	VectorSoADispose(&orders);
+}
+
+TEST(VectorSoATests, Throws_when_field_outside_record) {
+	vectorsoa orders;
+	VectorSoAField fields[] = { { 0, (int)sizeof(order) + 1 } };
+	EXPECT_DEATH(VectorSoANew(&orders, sizeof(order), fields, 1, 4),
+	             "Field does not fit within the record.");
+}
+
+TEST(VectorSoATests, Append_then_get_round_trips_records) {
+	vectorsoa orders;
+	NewOrderVector(&orders, 1);
+	for (int i = 0; i < 10; i++) {
+	  order o = { (char)('a' + i), i * 1.5, i * 10 };
+	  VectorSoAAppend(&orders, &o);
+	}
+	EXPECT_EQ(VectorSoALength(&orders), 10);
+	for (int i = 0; i < 10; i++) {
+	  order o;
+	  VectorSoAGet(&orders, i, &o);
+	  EXPECT_EQ(o.tag, 'a' + i);
+	  EXPECT_DOUBLE_EQ(o.price, i * 1.5);
+	  EXPECT_EQ(o.quantity, i * 10);
+	}
+	VectorSoADispose(&orders);
+}
+
+TEST(VectorSoATests, Columns_are_contiguous) {
+	vectorsoa orders;
+	NewOrderVector(&orders, 0);
+	for (int i = 0; i < 5; i++) {
+	  order o = { 'x', 0.0, i };
+	  VectorSoAAppend(&orders, &o);
+	}
+	int *quantities = (int *)VectorSoAColumn(&orders, 2);
+	for (int i = 0; i < 5; i++) {
+	  EXPECT_EQ(quantities[i], i);
+	}
+	EXPECT_EQ(VectorSoAFieldNth(&orders, 2, 3), &quantities[3]);
+	VectorSoADispose(&orders);
+}
+
+TEST(VectorSoATests, Set_overwrites_every_field) {
+	vectorsoa orders;
+	NewOrderVector(&orders, 2);
+	order a = { 'a', 1.0, 1 }, b = { 'b', 2.0, 2 };
+	VectorSoAAppend(&orders, &a);
+	VectorSoASet(&orders, &b, 0);
+	order out;
+	VectorSoAGet(&orders, 0, &out);
+	EXPECT_EQ(out.tag, 'b');
+	EXPECT_DOUBLE_EQ(out.price, 2.0);
+	EXPECT_EQ(out.quantity, 2);
+	VectorSoADispose(&orders);
+}
+
+TEST(VectorSoATests, Throws_get_out_of_bounds) {
+	vectorsoa orders;
+	NewOrderVector(&orders, 2);
+	order o;
+	EXPECT_DEATH(VectorSoAGet(&orders, 0, &o), "Index out of bounds.");
+}